@@ -3,7 +3,13 @@
 
 #include <stdint.h>
 
+#include <algorithm>
+#include <cmath>
+#include <iterator>
 #include <limits>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace Targoman {
@@ -24,10 +30,23 @@ std::vector<T> filter(const std::vector<T> &v, Functor_t f) {
   Result.reserve(v.size());
   for (const auto &Item : v)
     if (f(Item)) Result.push_back(Item);
-  Result.shrink_to_fit();
   return Result;
 }
 
+template <typename T, typename Functor_t>
+void filter_inplace(std::vector<T> &v, Functor_t f) {
+  v.erase(std::remove_if(v.begin(), v.end(),
+                         [&f](const T &_item) { return !f(_item); }),
+          v.end());
+}
+
+// Consumes a temporary instead of copying the kept items
+template <typename T, typename Functor_t>
+std::vector<T> filter(std::vector<T> &&v, Functor_t f) {
+  filter_inplace(v, f);
+  return std::move(v);
+}
+
 template <typename T, typename Functor_t>
 std::tuple<std::vector<T>, std::vector<T>> split(const std::vector<T> &v,
                                                  Functor_t f) {
@@ -37,7 +56,18 @@ std::tuple<std::vector<T>, std::vector<T>> split(const std::vector<T> &v,
       Conforms.push_back(Item);
     else
       DoesNotConform.push_back(Item);
-  return std::make_tuple(Conforms, DoesNotConform);
+  return std::make_tuple(std::move(Conforms), std::move(DoesNotConform));
+}
+
+// Consumes a temporary, keeping the conforming items in its storage
+template <typename T, typename Functor_t>
+std::tuple<std::vector<T>, std::vector<T>> split(std::vector<T> &&v,
+                                                 Functor_t f) {
+  auto Middle = std::stable_partition(v.begin(), v.end(), f);
+  std::vector<T> DoesNotConform(std::make_move_iterator(Middle),
+                                std::make_move_iterator(v.end()));
+  v.erase(Middle, v.end());
+  return std::make_tuple(std::move(v), std::move(DoesNotConform));
 }
 
 template <typename T, typename Functor_t>
@@ -105,37 +135,357 @@ auto mean(const std::vector<T0> &v, Functor_t f) {
   return Result;
 }
 
+/**
+ * Welford's running mean and (population) variance. Integral values are
+ * accumulated as double.
+ */
+template <typename T>
+struct stuRunningMoments {
+  typedef std::conditional_t<std::is_floating_point<T>::value, T, double>
+      Value_t;
+  size_t Count;
+  Value_t Mean;
+  Value_t M2;
+
+  stuRunningMoments() : Count(0), Mean(0), M2(0) {}
+
+  void add(T _value) {
+    ++this->Count;
+    Value_t Delta = static_cast<Value_t>(_value) - this->Mean;
+    this->Mean += Delta / static_cast<Value_t>(this->Count);
+    this->M2 += Delta * (static_cast<Value_t>(_value) - this->Mean);
+  }
+
+  // Chan et al.'s pairwise combination, for merging partial reductions
+  void merge(const stuRunningMoments &_other) {
+    if (_other.Count == 0) return;
+    if (this->Count == 0) {
+      *this = _other;
+      return;
+    }
+    auto Count = this->Count + _other.Count;
+    Value_t Delta = _other.Mean - this->Mean;
+    Value_t OtherWeight = static_cast<Value_t>(_other.Count) / Count;
+    this->Mean += Delta * OtherWeight;
+    this->M2 += _other.M2 + Delta * Delta * this->Count * OtherWeight;
+    this->Count = Count;
+  }
+
+  T variance() const {
+    return this->Count > 0
+               ? static_cast<T>(this->M2 / static_cast<Value_t>(this->Count))
+               : static_cast<T>(0);
+  }
+};
+
 template <typename T0, typename Functor_t>
 auto var(const std::vector<T0> &v, Functor_t f) {
   using T1 = decltype(std::declval<Functor_t>()(std::declval<T0>()));
-  T1 Mean = 0;
-  T1 MeanSquares = 0;
-  for (const auto &e : v) {
-    Mean += f(e);
-    MeanSquares += f(e) * f(e);
-  }
-  if (v.size() == 0) return static_cast<T1>(0);
-  T1 N = static_cast<T1>(v.size());
-  MeanSquares /= N;
-  Mean /= N;
-  return (MeanSquares - Mean * Mean);
+  stuRunningMoments<T1> Moments;
+  for (const auto &e : v) Moments.add(f(e));
+  return Moments.variance();
 }
 
 template <typename T0, typename Functor_t>
 auto std(const std::vector<T0> &v, Functor_t f) {
   using T1 = decltype(std::declval<Functor_t>()(std::declval<T0>()));
   auto Var = var(v, f);
-  if (Var > std::numeric_limits<T1>::epsilon()) return sqrt(Var);
-  return 0;
+  if (Var > std::numeric_limits<T1>::epsilon())
+    return static_cast<T1>(::std::sqrt(Var));
+  return static_cast<T1>(0);
+}
+
+inline void hashCombine(uint64_t &_seed, uint64_t _value) {
+  _seed ^= _value + 0x9e3779b97f4a7c15ULL + (_seed << 6) + (_seed >> 2);
+}
+
+// 64 bit FNV-1a
+inline uint64_t hashBytes(const uint8_t *_data, size_t _size,
+                          uint64_t _seed = 0xcbf29ce484222325ULL) {
+  for (size_t i = 0; i < _size; ++i) {
+    _seed ^= _data[i];
+    _seed *= 0x100000001b3ULL;
+  }
+  return _seed;
+}
+
+// Key ordering by the major coordinate, then the minor one, both quantized to
+// multiples of `_quantum` (and clamped to 2^31 of them either way)
+inline uint64_t packSortKey(float _major, float _minor, float _quantum) {
+  auto quantize = [_quantum](float _value) {
+    double Quanta = std::round(static_cast<double>(_value) / _quantum);
+    if (std::isnan(Quanta)) Quanta = 0;
+    Quanta = std::min(
+        std::max(Quanta, static_cast<double>(
+                             std::numeric_limits<int32_t>::min())),
+        static_cast<double>(std::numeric_limits<int32_t>::max()));
+    return static_cast<uint64_t>(static_cast<int64_t>(Quanta) +
+                                 (static_cast<int64_t>(1) << 31));
+  };
+  return (quantize(_major) << 32) | quantize(_minor);
+}
+
+/**
+ * Indices of the keys in ascending order, with equal keys kept in their
+ * order. This is an LSD radix sort over the bytes of the keys. Bytes shared
+ * by all keys are skipped, so coordinate keys take a few linear passes
+ * whatever their distribution.
+ */
+inline std::vector<uint32_t> radixSortIndices(
+    const std::vector<uint64_t> &_keys) {
+  constexpr size_t RADIX_BITS = 8;
+  constexpr size_t RADIX = static_cast<size_t>(1) << RADIX_BITS;
+  constexpr size_t DIGITS = sizeof(uint64_t) * 8 / RADIX_BITS;
+
+  size_t Size = _keys.size();
+  std::vector<uint64_t> Keys = _keys, KeysBuffer(Size);
+  std::vector<uint32_t> Indices(Size), IndicesBuffer(Size);
+  for (size_t i = 0; i < Size; ++i) Indices[i] = static_cast<uint32_t>(i);
+
+  //@NOTE: The counts of all digits are gathered in a single pass
+  std::vector<size_t> Counts(DIGITS * RADIX, 0);
+  for (auto Key : Keys)
+    for (size_t Digit = 0; Digit < DIGITS; ++Digit)
+      ++Counts[Digit * RADIX + ((Key >> (Digit * RADIX_BITS)) & (RADIX - 1))];
+
+  for (size_t Digit = 0; Digit < DIGITS; ++Digit) {
+    size_t *DigitCounts = &Counts[Digit * RADIX];
+    if (std::find(DigitCounts, DigitCounts + RADIX, Size) !=
+        DigitCounts + RADIX)
+      continue;
+    size_t Offset = 0;
+    for (size_t Bucket = 0; Bucket < RADIX; ++Bucket) {
+      size_t Count = DigitCounts[Bucket];
+      DigitCounts[Bucket] = Offset;
+      Offset += Count;
+    }
+    for (size_t i = 0; i < Size; ++i) {
+      size_t Position =
+          DigitCounts[(Keys[i] >> (Digit * RADIX_BITS)) & (RADIX - 1)]++;
+      KeysBuffer[Position] = Keys[i];
+      IndicesBuffer[Position] = Indices[i];
+    }
+    Keys.swap(KeysBuffer);
+    Indices.swap(IndicesBuffer);
+  }
+  return Indices;
+}
+
+// Stable sort of the items by the 64 bit keys `_key` gives them
+template <typename T, typename Functor_t>
+void radixSortBy(std::vector<T> &v, Functor_t _key) {
+  std::vector<uint64_t> Keys;
+  Keys.reserve(v.size());
+  for (const auto &Item : v) Keys.push_back(_key(Item));
+  std::vector<T> Sorted;
+  Sorted.reserve(v.size());
+  for (auto i : radixSortIndices(Keys)) Sorted.push_back(std::move(v[i]));
+  v.swap(Sorted);
 }
 
 template <typename T>
 std::vector<T> cat(const std::vector<T> &a, const std::vector<T> &b) {
-  std::vector<T> Result = a;
+  std::vector<T> Result;
+  Result.reserve(a.size() + b.size());
+  Result.insert(Result.end(), a.begin(), a.end());
   Result.insert(Result.end(), b.begin(), b.end());
   return Result;
 }
 
+/******************************************************************************/
+/**
+ * Lazy views: they compute their items while being iterated and never copy the
+ * viewed containers, so they must not outlive them. A view passed to another
+ * view (e.g. `filter_view(cat_view(a, b), f)`) is held by value.
+ */
+template <typename Range_t, typename Functor_t>
+class clsFilterView {
+ private:
+  typedef decltype(std::begin(
+      std::declval<const std::remove_reference_t<Range_t> &>()))
+      BaseIterator_t;
+  Range_t Range;
+  Functor_t Functor;
+
+ public:
+  class iterator {
+   private:
+    BaseIterator_t Current, End;
+    const Functor_t *Functor;
+
+    void skipRejected() {
+      while (this->Current != this->End && !(*this->Functor)(*this->Current))
+        ++this->Current;
+    }
+
+   public:
+    iterator(BaseIterator_t _current, BaseIterator_t _end,
+             const Functor_t *_functor)
+        : Current(_current), End(_end), Functor(_functor) {
+      this->skipRejected();
+    }
+    decltype(auto) operator*() const { return *this->Current; }
+    iterator &operator++() {
+      ++this->Current;
+      this->skipRejected();
+      return *this;
+    }
+    bool operator==(const iterator &_other) const {
+      return this->Current == _other.Current;
+    }
+    bool operator!=(const iterator &_other) const {
+      return this->Current != _other.Current;
+    }
+  };
+
+  clsFilterView(Range_t &&_range, Functor_t _functor)
+      : Range(std::forward<Range_t>(_range)), Functor(_functor) {}
+  iterator begin() const {
+    return iterator(std::begin(this->Range), std::end(this->Range),
+                    &this->Functor);
+  }
+  iterator end() const {
+    return iterator(std::end(this->Range), std::end(this->Range),
+                    &this->Functor);
+  }
+};
+
+template <typename Range_t, typename Functor_t>
+class clsMapView {
+ private:
+  typedef decltype(std::begin(
+      std::declval<const std::remove_reference_t<Range_t> &>()))
+      BaseIterator_t;
+  Range_t Range;
+  Functor_t Functor;
+
+ public:
+  class iterator {
+   private:
+    BaseIterator_t Current;
+    const Functor_t *Functor;
+
+   public:
+    iterator(BaseIterator_t _current, const Functor_t *_functor)
+        : Current(_current), Functor(_functor) {}
+    auto operator*() const { return (*this->Functor)(*this->Current); }
+    iterator &operator++() {
+      ++this->Current;
+      return *this;
+    }
+    bool operator==(const iterator &_other) const {
+      return this->Current == _other.Current;
+    }
+    bool operator!=(const iterator &_other) const {
+      return this->Current != _other.Current;
+    }
+  };
+
+  clsMapView(Range_t &&_range, Functor_t _functor)
+      : Range(std::forward<Range_t>(_range)), Functor(_functor) {}
+  size_t size() const { return std::size(this->Range); }
+  iterator begin() const {
+    return iterator(std::begin(this->Range), &this->Functor);
+  }
+  iterator end() const {
+    return iterator(std::end(this->Range), &this->Functor);
+  }
+};
+
+template <typename T>
+class clsConcatView {
+ private:
+  const std::vector<T> &First;
+  const std::vector<T> &Second;
+
+ public:
+  class iterator {
+   private:
+    const clsConcatView *View;
+    size_t Index;
+
+   public:
+    iterator(const clsConcatView *_view, size_t _index)
+        : View(_view), Index(_index) {}
+    const T &operator*() const { return (*this->View)[this->Index]; }
+    iterator &operator++() {
+      ++this->Index;
+      return *this;
+    }
+    bool operator==(const iterator &_other) const {
+      return this->Index == _other.Index;
+    }
+    bool operator!=(const iterator &_other) const {
+      return this->Index != _other.Index;
+    }
+  };
+
+  clsConcatView(const std::vector<T> &_first, const std::vector<T> &_second)
+      : First(_first), Second(_second) {}
+  size_t size() const { return this->First.size() + this->Second.size(); }
+  bool empty() const { return this->size() == 0; }
+  const T &operator[](size_t _index) const {
+    return _index < this->First.size()
+               ? this->First[_index]
+               : this->Second[_index - this->First.size()];
+  }
+  iterator begin() const { return iterator(this, 0); }
+  iterator end() const { return iterator(this, this->size()); }
+};
+
+template <typename Range_t, typename Functor_t>
+clsFilterView<Range_t, Functor_t> filter_view(Range_t &&v, Functor_t f) {
+  return clsFilterView<Range_t, Functor_t>(std::forward<Range_t>(v), f);
+}
+
+template <typename Range_t, typename Functor_t>
+clsMapView<Range_t, Functor_t> map_view(Range_t &&v, Functor_t f) {
+  return clsMapView<Range_t, Functor_t>(std::forward<Range_t>(v), f);
+}
+
+template <typename T>
+clsConcatView<T> cat_view(const std::vector<T> &a, const std::vector<T> &b) {
+  return clsConcatView<T>(a, b);
+}
+// A view over temporaries would dangle
+template <typename T>
+void cat_view(std::vector<T> &&a, const std::vector<T> &b) = delete;
+template <typename T>
+void cat_view(const std::vector<T> &a, std::vector<T> &&b) = delete;
+template <typename T>
+void cat_view(std::vector<T> &&a, std::vector<T> &&b) = delete;
+
+class clsUnionFind {
+ private:
+  std::vector<uint32_t> Parents;
+  std::vector<uint8_t> Ranks;
+
+ public:
+  clsUnionFind(size_t _size) : Parents(_size), Ranks(_size, 0) {
+    for (size_t i = 0; i < _size; ++i) Parents[i] = static_cast<uint32_t>(i);
+  }
+
+  size_t size() const { return this->Parents.size(); }
+
+  uint32_t find(uint32_t _item) {
+    while (this->Parents[_item] != _item) {
+      this->Parents[_item] = this->Parents[this->Parents[_item]];
+      _item = this->Parents[_item];
+    }
+    return _item;
+  }
+
+  bool merge(uint32_t _a, uint32_t _b) {
+    _a = this->find(_a);
+    _b = this->find(_b);
+    if (_a == _b) return false;
+    if (this->Ranks[_a] < this->Ranks[_b]) std::swap(_a, _b);
+    this->Parents[_b] = _a;
+    if (this->Ranks[_a] == this->Ranks[_b]) ++this->Ranks[_a];
+    return true;
+  }
+};
+
 }  // namespace Common
 }  // namespace Targoman
 
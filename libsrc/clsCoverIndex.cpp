@@ -0,0 +1,193 @@
+#include "clsCoverIndex.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "algorithm.hpp"
+
+namespace Targoman {
+namespace PDFLA {
+
+using namespace Targoman::DLA;
+using namespace Targoman::Common;
+
+constexpr float COVER_INDEX_KEY_QUANTUM = 1.f / 64;
+
+bool clsCoverIndex::stuNode::overlaps(float _left, float _right) const {
+  size_t Count = static_cast<size_t>(
+      std::lower_bound(this->Lefts.begin(), this->Lefts.end(), _right) -
+      this->Lefts.begin());
+  return Count > 0 && this->MaxRights[Count - 1] > _left;
+}
+
+bool clsCoverIndex::stuNode::overlaps(float _left, float _right,
+                                      float _maxTop) const {
+  for (size_t i = 0; i < this->Lefts.size() && this->Lefts[i] < _right; ++i)
+    if (this->Rights[i] > _left && this->Tops[i] < _maxTop) return true;
+  return false;
+}
+
+void clsCoverIndex::stuNode::add(const stuBoundingBox &_cover) {
+  this->Lefts.push_back(_cover.left());
+  this->Rights.push_back(_cover.right());
+  this->Tops.push_back(_cover.top());
+  this->MaxRights.push_back(_cover.right());
+}
+
+void clsCoverIndex::stuNode::finalize() {
+  for (size_t i = 1; i < this->MaxRights.size(); ++i)
+    this->MaxRights[i] = std::max(this->MaxRights[i], this->MaxRights[i - 1]);
+}
+
+clsCoverIndex::clsCoverIndex(const BoundingBoxPtrVector_t &_covers,
+                             float _minVerticalOverlap)
+    : MinVerticalOverlap(_minVerticalOverlap),
+      MinCoverWidth(std::numeric_limits<float>::max()) {
+  this->Covers = filter(_covers, [&](const BoundingBoxPtr_t &e) {
+    return e->height() > _minVerticalOverlap;
+  });
+  if (this->Covers.empty()) return;
+
+  //@NOTE: Nodes get their covers in left order, so their lists come out
+  //       sorted without sorting each of them
+  auto ByLeft =
+      radixSortIndices(map(this->Covers, [](const BoundingBoxPtr_t &e) {
+        return packSortKey(e->left(), e->right(), COVER_INDEX_KEY_QUANTUM);
+      }));
+
+  for (const auto &Cover : this->Covers) {
+    this->MinCoverWidth = std::min(this->MinCoverWidth, Cover->width());
+    this->Ys.push_back(Cover->top());
+    this->Ys.push_back(Cover->bottom());
+  }
+  std::sort(this->Ys.begin(), this->Ys.end());
+  this->Ys.erase(std::unique(this->Ys.begin(), this->Ys.end()),
+                 this->Ys.end());
+  size_t Leaves = this->Ys.size() - 1;
+  this->StabbingTree.resize(4 * std::max(Leaves, static_cast<size_t>(1)));
+  for (auto i : ByLeft) {
+    const auto &Cover = *this->Covers[i];
+    size_t From = static_cast<size_t>(
+        std::lower_bound(this->Ys.begin(), this->Ys.end(), Cover.top()) -
+        this->Ys.begin());
+    size_t To = static_cast<size_t>(
+        std::lower_bound(this->Ys.begin(), this->Ys.end(), Cover.bottom()) -
+        this->Ys.begin());
+    if (From < To) this->insert(1, 0, Leaves, From, To, Cover);
+  }
+  for (auto &Node : this->StabbingTree) Node.finalize();
+
+  std::vector<uint32_t> ByTop(ByLeft);
+  std::stable_sort(ByTop.begin(), ByTop.end(), [&](uint32_t a, uint32_t b) {
+    return this->Covers[a]->top() < this->Covers[b]->top();
+  });
+  for (auto i : ByTop) this->SortedTops.push_back(this->Covers[i]->top());
+  this->TopTree.resize(4 * this->Covers.size());
+  this->buildTopTree(1, 0, this->Covers.size(), ByTop);
+}
+
+void clsCoverIndex::insert(size_t _node, size_t _begin, size_t _end,
+                           size_t _from, size_t _to,
+                           const stuBoundingBox &_cover) {
+  if (_to <= _begin || _end <= _from) return;
+  auto &Node = this->StabbingTree[_node];
+  if (_from <= _begin && _end <= _to) {
+    Node.add(_cover);
+    return;
+  }
+  size_t Middle = (_begin + _end) / 2;
+  this->insert(2 * _node, _begin, Middle, _from, _to, _cover);
+  this->insert(2 * _node + 1, Middle, _end, _from, _to, _cover);
+}
+
+void clsCoverIndex::buildTopTree(size_t _node, size_t _begin, size_t _end,
+                                 const std::vector<uint32_t> &_byTop) {
+  //@NOTE: Each node takes the covers of its range in left order
+  std::vector<uint32_t> ByLeft(_byTop.begin() + static_cast<ptrdiff_t>(_begin),
+                               _byTop.begin() + static_cast<ptrdiff_t>(_end));
+  std::stable_sort(ByLeft.begin(), ByLeft.end(), [&](uint32_t a, uint32_t b) {
+    return this->Covers[a]->left() < this->Covers[b]->left();
+  });
+  auto &Node = this->TopTree[_node];
+  for (auto i : ByLeft) Node.add(*this->Covers[i]);
+  Node.finalize();
+  if (_end - _begin < 2) return;
+  size_t Middle = (_begin + _end) / 2;
+  this->buildTopTree(2 * _node, _begin, Middle, _byTop);
+  this->buildTopTree(2 * _node + 1, Middle, _end, _byTop);
+}
+
+bool clsCoverIndex::stabs(float _y, float _left, float _right,
+                          float _maxTop) const {
+  if (_y < this->Ys.front() || _y >= this->Ys.back()) return false;
+  size_t Leaf = static_cast<size_t>(
+      std::upper_bound(this->Ys.begin(), this->Ys.end(), _y) -
+      this->Ys.begin() - 1);
+  size_t Node = 1, Begin = 0, End = this->Ys.size() - 1;
+  bool CheckTops = _maxTop <= _y;
+  while (true) {
+    const auto &Covers = this->StabbingTree[Node];
+    if (CheckTops ? Covers.overlaps(_left, _right, _maxTop)
+                  : Covers.overlaps(_left, _right))
+      return true;
+    if (End - Begin < 2) return false;
+    size_t Middle = (Begin + End) / 2;
+    if (Leaf < Middle) {
+      Node = 2 * Node;
+      End = Middle;
+    } else {
+      Node = 2 * Node + 1;
+      Begin = Middle;
+    }
+  }
+}
+
+bool clsCoverIndex::startsWithin(size_t _node, size_t _begin, size_t _end,
+                                 size_t _from, size_t _to, float _left,
+                                 float _right) const {
+  if (_to <= _begin || _end <= _from) return false;
+  if (_from <= _begin && _end <= _to)
+    return this->TopTree[_node].overlaps(_left, _right);
+  size_t Middle = (_begin + _end) / 2;
+  return this->startsWithin(2 * _node, _begin, Middle, _from, _to, _left,
+                            _right) ||
+         this->startsWithin(2 * _node + 1, Middle, _end, _from, _to, _left,
+                            _right);
+}
+
+bool clsCoverIndex::crosses(const stuBoundingBox &_box) const {
+  if (this->Covers.empty() || _box.height() <= this->MinVerticalOverlap)
+    return false;
+  //@NOTE: The vertical overlap exceeds the margin exactly when the cover
+  //       starts above the box bottom less the margin and ends below its top
+  //       plus the margin. Covers starting at or above the latter contain it,
+  //       the others start in between. On short boxes the former bound is
+  //       the tighter one, so the covers containing the latter are filtered
+  //       by their tops, which is linear only in the covers around the box.
+  float Top = _box.top() + this->MinVerticalOverlap;
+  float Bottom = _box.bottom() - this->MinVerticalOverlap;
+  if (this->stabs(Top, _box.left(), _box.right(), Bottom)) return true;
+  size_t From = static_cast<size_t>(
+      std::upper_bound(this->SortedTops.begin(), this->SortedTops.end(), Top) -
+      this->SortedTops.begin());
+  size_t To = static_cast<size_t>(
+      std::lower_bound(this->SortedTops.begin(), this->SortedTops.end(),
+                       Bottom) -
+      this->SortedTops.begin());
+  return From < To && this->startsWithin(1, 0, this->Covers.size(), From, To,
+                                         _box.left(), _box.right());
+}
+
+std::vector<bool> clsCoverIndex::crosses(
+    const std::vector<stuBoundingBox> &_boxes) const {
+  std::vector<bool> Result(_boxes.size(), false);
+  if (this->Covers.empty()) return Result;
+  auto Order = radixSortIndices(map(_boxes, [](const stuBoundingBox &e) {
+    return packSortKey(e.top(), e.left(), COVER_INDEX_KEY_QUANTUM);
+  }));
+  for (auto i : Order) Result[i] = this->crosses(_boxes[i]);
+  return Result;
+}
+
+}  // namespace PDFLA
+}  // namespace Targoman
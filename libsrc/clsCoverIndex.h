@@ -0,0 +1,71 @@
+#ifndef __TARGOMAN_PDFLA_CLSCOVERINDEX__
+#define __TARGOMAN_PDFLA_CLSCOVERINDEX__
+
+#include <vector>
+
+#include "dla.h"
+
+namespace Targoman {
+namespace PDFLA {
+
+/**
+ * The whitespace cover of a page, indexed by vertical extent to find out
+ * whether any cover crosses a box: overlapping it horizontally and by more
+ * than a fixed margin vertically. A cover that crosses the box either spans
+ * its top (less the margin) or starts inside it. The first case is a segment
+ * tree stabbing query over the cover extents, the second a range query over
+ * the covers sorted by top. Every tree node keeps its covers sorted by left
+ * with the running maximum of their rights, so a query takes O(log^2 n).
+ * Boxes up to twice the margin tall are the exception, as the covers that
+ * span their top must also be checked to start high enough.
+ */
+class clsCoverIndex {
+ private:
+  struct stuNode {
+    std::vector<float> Lefts;
+    std::vector<float> Rights;
+    std::vector<float> Tops;
+    std::vector<float> MaxRights;
+    void add(const Targoman::DLA::stuBoundingBox &_cover);
+    bool overlaps(float _left, float _right) const;
+    bool overlaps(float _left, float _right, float _maxTop) const;
+    void finalize();
+  };
+
+  float MinVerticalOverlap;
+  float MinCoverWidth;
+  // Covers too thin to ever overlap a box by the margin are left out
+  Targoman::DLA::BoundingBoxPtrVector_t Covers;
+  // Elementary intervals [Ys[i], Ys[i + 1]) of the stabbing tree
+  std::vector<float> Ys;
+  std::vector<stuNode> StabbingTree;
+  std::vector<float> SortedTops;
+  std::vector<stuNode> TopTree;
+
+ private:
+  void insert(size_t _node, size_t _begin, size_t _end, size_t _from,
+              size_t _to, const Targoman::DLA::stuBoundingBox &_cover);
+  void buildTopTree(size_t _node, size_t _begin, size_t _end,
+                    const std::vector<uint32_t> &_byTop);
+  bool stabs(float _y, float _left, float _right, float _maxTop) const;
+  bool startsWithin(size_t _node, size_t _begin, size_t _end, size_t _from,
+                    size_t _to, float _left, float _right) const;
+
+ public:
+  clsCoverIndex(const Targoman::DLA::BoundingBoxPtrVector_t &_covers,
+                float _minVerticalOverlap);
+
+  // Gaps narrower than this can never hold a cover
+  float minCoverWidth() const { return this->MinCoverWidth; }
+
+  bool crosses(const Targoman::DLA::stuBoundingBox &_box) const;
+  // One result per box. The boxes are visited in vertical order, so
+  // neighbouring queries walk the same tree paths.
+  std::vector<bool> crosses(
+      const std::vector<Targoman::DLA::stuBoundingBox> &_boxes) const;
+};
+
+}  // namespace PDFLA
+}  // namespace Targoman
+
+#endif  // __TARGOMAN_PDFLA_CLSCOVERINDEX__
@@ -0,0 +1,77 @@
+#include "clsLayoutTemplateCache.h"
+
+#include <algorithm>
+
+namespace Targoman {
+namespace PDFLA {
+using namespace Targoman::DLA;
+
+constexpr size_t MAX_LAYOUT_TEMPLATES = 8;
+constexpr size_t MAX_OCCUPANCY_DIFFERENCE =
+    OCCUPANCY_GRID_SIZE * OCCUPANCY_GRID_SIZE / 50;
+
+clsLayoutTemplateCache::Occupancy_t clsLayoutTemplateCache::occupancyOf(
+    const stuBoundingBox &_bounds, const BoundingBoxPtrVector_t &_obstacles) {
+  Occupancy_t Occupancy;
+  if (_bounds.isEmpty()) return Occupancy;
+
+  float CellWidth = _bounds.width() / OCCUPANCY_GRID_SIZE;
+  float CellHeight = _bounds.height() / OCCUPANCY_GRID_SIZE;
+  auto cellOf = [](float _offset, float _cellSize) {
+    return static_cast<size_t>(std::min(
+        std::max(_offset / _cellSize, 0.f),
+        static_cast<float>(OCCUPANCY_GRID_SIZE - 1)));
+  };
+  for (const auto &Obstacle : _obstacles) {
+    size_t X0 = cellOf(Obstacle->left() - _bounds.left(), CellWidth);
+    size_t X1 = cellOf(Obstacle->right() - _bounds.left(), CellWidth);
+    size_t Y0 = cellOf(Obstacle->top() - _bounds.top(), CellHeight);
+    size_t Y1 = cellOf(Obstacle->bottom() - _bounds.top(), CellHeight);
+    for (size_t Y = Y0; Y <= Y1; ++Y)
+      for (size_t X = X0; X <= X1; ++X)
+        Occupancy.set(Y * OCCUPANCY_GRID_SIZE + X);
+  }
+  return Occupancy;
+}
+
+const std::vector<stuBoundingBox> *clsLayoutTemplateCache::findCovers(
+    const stuSize &_pageSize, const Occupancy_t &_occupancy) {
+  for (auto Template = this->Templates.begin();
+       Template != this->Templates.end(); ++Template) {
+    if (Template->PageSize != _pageSize ||
+        (Template->Occupancy ^ _occupancy).count() > MAX_OCCUPANCY_DIFFERENCE)
+      continue;
+    //@NOTE: Most recently matched templates are checked first
+    if (Template != this->Templates.begin()) {
+      auto Matched = std::move(*Template);
+      this->Templates.erase(Template);
+      this->Templates.push_front(std::move(Matched));
+    }
+    return &this->Templates.front().Covers;
+  }
+  return nullptr;
+}
+
+void clsLayoutTemplateCache::addCovers(const stuSize &_pageSize,
+                                       const Occupancy_t &_occupancy,
+                                       const BoundingBoxPtrVector_t &_covers) {
+  stuTemplate Template;
+  Template.PageSize = _pageSize;
+  Template.Occupancy = _occupancy;
+  for (const auto &Cover : _covers) Template.Covers.push_back(*Cover);
+  this->Templates.push_front(std::move(Template));
+  if (this->Templates.size() > MAX_LAYOUT_TEMPLATES) this->Templates.pop_back();
+}
+
+void clsLayoutTemplateCache::refreshCovers(
+    const Occupancy_t &_occupancy, const BoundingBoxPtrVector_t &_covers) {
+  if (this->Templates.empty()) return;
+  //@NOTE: findCovers moves the matched template to the front
+  auto &Template = this->Templates.front();
+  Template.Occupancy = _occupancy;
+  Template.Covers.clear();
+  for (const auto &Cover : _covers) Template.Covers.push_back(*Cover);
+}
+
+}  // namespace PDFLA
+}  // namespace Targoman
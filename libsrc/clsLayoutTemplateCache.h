@@ -0,0 +1,54 @@
+#ifndef __TARGOMAN_PDFLA_CLSLAYOUTTEMPLATECACHE__
+#define __TARGOMAN_PDFLA_CLSLAYOUTTEMPLATECACHE__
+
+#include <bitset>
+#include <deque>
+#include <vector>
+
+#include "dla.h"
+
+namespace Targoman {
+namespace PDFLA {
+
+constexpr size_t OCCUPANCY_GRID_SIZE = 32;
+
+/**
+ * Whitespace covers of recently analyzed pages, keyed by the occupancy of a
+ * coarse grid over their obstacles. Pages sharing a layout (as most pages of a
+ * journal or report do) have nearly the same occupancy, so the covers of one
+ * are a good seed for the other.
+ */
+class clsLayoutTemplateCache {
+ public:
+  typedef std::bitset<OCCUPANCY_GRID_SIZE * OCCUPANCY_GRID_SIZE> Occupancy_t;
+
+ private:
+  struct stuTemplate {
+    Targoman::DLA::stuSize PageSize;
+    Occupancy_t Occupancy;
+    std::vector<Targoman::DLA::stuBoundingBox> Covers;
+  };
+  std::deque<stuTemplate> Templates;
+
+ public:
+  static Occupancy_t occupancyOf(
+      const Targoman::DLA::stuBoundingBox &_bounds,
+      const Targoman::DLA::BoundingBoxPtrVector_t &_obstacles);
+
+  // Returns nullptr when no cached page has a similar enough layout,
+  // otherwise the covers of the matched template
+  const std::vector<Targoman::DLA::stuBoundingBox> *findCovers(
+      const Targoman::DLA::stuSize &_pageSize, const Occupancy_t &_occupancy);
+  void addCovers(const Targoman::DLA::stuSize &_pageSize,
+                 const Occupancy_t &_occupancy,
+                 const Targoman::DLA::BoundingBoxPtrVector_t &_covers);
+  // Replaces the template matched by the last findCovers with the covers
+  // found for the page it was matched to
+  void refreshCovers(const Occupancy_t &_occupancy,
+                     const Targoman::DLA::BoundingBoxPtrVector_t &_covers);
+};
+
+}  // namespace PDFLA
+}  // namespace Targoman
+
+#endif  // __TARGOMAN_PDFLA_CLSLAYOUTTEMPLATECACHE__
@@ -0,0 +1,214 @@
+#include "clsPageFurnitureIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cwctype>
+#include <string>
+
+#include "algorithm.hpp"
+
+namespace Targoman {
+namespace PDFLA {
+
+using namespace Targoman::DLA;
+using namespace Targoman::Common;
+
+constexpr float FURNITURE_QUANTUM = 2.f;
+constexpr float NUMBERED_FURNITURE_QUANTUM = 24.f;
+constexpr float MAX_RUN_GAP_TO_HEIGHT_RATIO = 2.f;
+constexpr float HEADER_ZONE_RATIO = 0.15f;
+constexpr float FOOTER_ZONE_RATIO = 0.15f;
+constexpr float SIDEBAR_ZONE_RATIO = 0.15f;
+constexpr size_t MIN_MARGIN_REPETITIONS = 2;
+constexpr size_t MIN_WATERMARK_REPETITIONS = 3;
+
+struct stuPageElement {
+  stuBoundingBox BoundingBox;
+  uint64_t ContentHash;
+  // The quantized coordinates, as pairs of value and quantum
+  std::vector<std::pair<float, float>> Coordinates;
+  DocItemPtrVector_t Items;
+};
+
+void computeFingerprintSource(stuPageElement &_element, enuDocItemType _type) {
+  _element.ContentHash = static_cast<uint64_t>(_type);
+  const auto &BBox = _element.BoundingBox;
+  _element.Coordinates = {{BBox.top(), FURNITURE_QUANTUM},
+                          {BBox.bottom(), FURNITURE_QUANTUM}};
+  if (_type != enuDocItemType::Char) {
+    _element.Coordinates.push_back({BBox.left(), FURNITURE_QUANTUM});
+    _element.Coordinates.push_back({BBox.right(), FURNITURE_QUANTUM});
+    return;
+  }
+
+  //@NOTE: Every digit sequence is folded into a single placeholder so running
+  //       page numbers ("Page 9", "Page 10") share the same fingerprint. Their
+  //       width changes from page to page, so only a coarse center is used.
+  std::wstring Text;
+  bool HasDigits = false;
+  for (const auto &Item : _element.Items) {
+    if (std::iswdigit(static_cast<wint_t>(Item->Char))) {
+      if (Text.empty() || Text.back() != L'#') Text.push_back(L'#');
+      HasDigits = true;
+    } else {
+      Text.push_back(Item->Char);
+    }
+  }
+  hashCombine(_element.ContentHash, std::hash<std::wstring>()(Text));
+  if (HasDigits) {
+    _element.Coordinates.push_back(
+        {BBox.centerX(), NUMBERED_FURNITURE_QUANTUM});
+  } else {
+    _element.Coordinates.push_back({BBox.left(), FURNITURE_QUANTUM});
+    _element.Coordinates.push_back({BBox.right(), FURNITURE_QUANTUM});
+  }
+}
+
+/**
+ * The fingerprint of an element hashes the grid cell of each coordinate. With
+ * _withNeighbours, each coordinate also takes the neighbouring cell it is
+ * nearest to, which yields the fingerprints of every element whose
+ * coordinates are all within half a quantum of these, even across a cell
+ * boundary.
+ */
+std::vector<uint64_t> computeFingerprints(const stuPageElement &_element,
+                                          bool _withNeighbours) {
+  std::vector<uint64_t> Result{_element.ContentHash};
+  for (const auto &[Value, Quantum] : _element.Coordinates) {
+    float Scaled = Value / Quantum;
+    auto Cell = static_cast<int64_t>(std::floor(Scaled));
+    size_t Count = Result.size();
+    if (_withNeighbours) {
+      auto Neighbour = Scaled - static_cast<float>(Cell) < 0.5f ? Cell - 1
+                                                                : Cell + 1;
+      for (size_t i = 0; i < Count; ++i) {
+        Result.push_back(Result[i]);
+        hashCombine(Result.back(), static_cast<uint64_t>(Neighbour));
+      }
+    }
+    for (size_t i = 0; i < Count; ++i)
+      hashCombine(Result[i], static_cast<uint64_t>(Cell));
+  }
+  return Result;
+}
+
+std::vector<stuPageElement> extractPageElements(
+    const DocItemPtrVector_t &_items) {
+  std::vector<stuPageElement> Result;
+  bool RunIsOpen = false;
+
+  auto closeRun = [&]() {
+    if (RunIsOpen)
+      computeFingerprintSource(Result.back(), enuDocItemType::Char);
+    RunIsOpen = false;
+  };
+
+  //@NOTE: Items are visited in content stream order, in which the running
+  //       furniture is emitted identically on every page
+  for (const auto &Item : _items) {
+    if (Item->Type != enuDocItemType::Char) {
+      closeRun();
+      Result.push_back(stuPageElement{Item->BoundingBox, 0, {}, {Item}});
+      computeFingerprintSource(Result.back(), Item->Type);
+      continue;
+    }
+    if (RunIsOpen) {
+      const auto &PrevItem = Result.back().Items.back();
+      float Height =
+          std::max(Item->BoundingBox.height(), PrevItem->BoundingBox.height());
+      float Gap = Item->BoundingBox.left() - PrevItem->BoundingBox.right();
+      if (Item->BoundingBox.verticalOverlapRatio(PrevItem->BoundingBox) >
+              0.5f &&
+          Gap > -Height && Gap < MAX_RUN_GAP_TO_HEIGHT_RATIO * Height) {
+        Result.back().BoundingBox.unionWith_(Item->BoundingBox);
+        Result.back().Items.push_back(Item);
+        continue;
+      }
+      closeRun();
+    }
+    Result.push_back(stuPageElement{Item->BoundingBox, 0, {}, {Item}});
+    RunIsOpen = true;
+  }
+  closeRun();
+  return Result;
+}
+
+enuDocArea findMarginArea(const stuBoundingBox &_bbox,
+                          const stuSize &_pageSize) {
+  if (_bbox.bottom() <= HEADER_ZONE_RATIO * _pageSize.Height)
+    return enuDocArea::Header;
+  if (_bbox.top() >= (1.f - FOOTER_ZONE_RATIO) * _pageSize.Height)
+    return enuDocArea::Footer;
+  if (_bbox.right() <= SIDEBAR_ZONE_RATIO * _pageSize.Width)
+    return enuDocArea::LeftSidebar;
+  if (_bbox.left() >= (1.f - SIDEBAR_ZONE_RATIO) * _pageSize.Width)
+    return enuDocArea::RightSidebar;
+  return enuDocArea::Body;
+}
+
+std::vector<uint64_t> clsPageFurnitureIndex::pageFingerprints(
+    const DocItemPtrVector_t &_items) {
+  return map(extractPageElements(_items), [](const stuPageElement &_element) {
+    return computeFingerprints(_element, false).front();
+  });
+}
+
+void clsPageFurnitureIndex::addPage(
+    size_t _pageIndex, const std::vector<uint64_t> &_fingerprints) {
+  auto PageIndex = static_cast<int32_t>(_pageIndex);
+  for (auto Fingerprint : _fingerprints) {
+    auto &Pages = this->PagesByFingerprint[Fingerprint];
+    auto Position = std::lower_bound(Pages.begin(), Pages.end(), PageIndex);
+    if (Position == Pages.end() || *Position != PageIndex)
+      Pages.insert(Position, PageIndex);
+  }
+}
+
+void clsPageFurnitureIndex::addPage(size_t _pageIndex,
+                                    const DocItemPtrVector_t &_items) {
+  this->addPage(_pageIndex, pageFingerprints(_items));
+}
+
+RepeatedElementVector_t clsPageFurnitureIndex::findRepeatedElements(
+    size_t _pageIndex, const DocItemPtrVector_t &_items,
+    const stuSize &_pageSize) const {
+  RepeatedElementVector_t Result;
+  auto PageIndex = static_cast<int32_t>(_pageIndex);
+  for (auto &Element : extractPageElements(_items)) {
+    //@NOTE: Jitter of a coordinate across a cell boundary moves an element to
+    //       a neighbouring cell, so the pages of those cells are merged in
+    std::vector<int32_t> Pages;
+    for (auto Fingerprint : computeFingerprints(Element, true)) {
+      auto PagesIterator = this->PagesByFingerprint.find(Fingerprint);
+      if (PagesIterator != this->PagesByFingerprint.end())
+        Pages.insert(Pages.end(), PagesIterator->second.begin(),
+                     PagesIterator->second.end());
+    }
+    if (Pages.empty()) continue;
+    std::sort(Pages.begin(), Pages.end());
+    Pages.erase(std::unique(Pages.begin(), Pages.end()), Pages.end());
+
+    auto Area = findMarginArea(Element.BoundingBox, _pageSize);
+    size_t MinRepetitions = Area == enuDocArea::Body ? MIN_WATERMARK_REPETITIONS
+                                                     : MIN_MARGIN_REPETITIONS;
+    if (Pages.size() < MinRepetitions) continue;
+    if (Area == enuDocArea::Body) Area = enuDocArea::Watermark;
+
+    auto Position = std::lower_bound(Pages.begin(), Pages.end(), PageIndex);
+    int32_t Offset = 0;
+    if (Position != Pages.begin()) Offset = *(Position - 1) - PageIndex;
+    if (Position != Pages.end() && *Position == PageIndex) ++Position;
+    if (Position != Pages.end() &&
+        (Offset == 0 || *Position - PageIndex < -Offset))
+      Offset = *Position - PageIndex;
+    if (Offset == 0) continue;
+
+    for (auto &Item : Element.Items) Item->RepetitionPageOffset = Offset;
+    Result.push_back(stuRepeatedElement{Element.BoundingBox, Area, Offset,
+                                        std::move(Element.Items)});
+  }
+  return Result;
+}
+
+}  // namespace PDFLA
+}  // namespace Targoman
@@ -0,0 +1,48 @@
+#ifndef __TARGOMAN_PDFLA_CLSPAGEFURNITUREINDEX__
+#define __TARGOMAN_PDFLA_CLSPAGEFURNITUREINDEX__
+
+#include <unordered_map>
+#include <vector>
+
+#include "dla.h"
+
+namespace Targoman {
+namespace PDFLA {
+
+struct stuRepeatedElement {
+  Targoman::DLA::stuBoundingBox BoundingBox;
+  Targoman::DLA::enuDocArea Area;
+  int32_t RepetitionPageOffset;
+  Targoman::DLA::DocItemPtrVector_t Items;
+};
+typedef std::vector<stuRepeatedElement> RepeatedElementVector_t;
+
+/**
+ * Document level index of the elements (text runs and figures) of all pages,
+ * keyed by a fingerprint of their quantized geometry and text. Elements found
+ * on more than one page are the running page furniture (headers, footers,
+ * sidebars and watermarks) and are looked up in O(1) per element instead of
+ * comparing pages pairwise. Lookups also probe the neighbouring grid cells, so
+ * elements that jitter across a cell boundary still match.
+ */
+class clsPageFurnitureIndex {
+ private:
+  std::unordered_map<uint64_t, std::vector<int32_t>> PagesByFingerprint;
+
+ public:
+  // Fingerprints of the elements of a page, to add the pages whose
+  // fingerprints were computed concurrently
+  static std::vector<uint64_t> pageFingerprints(
+      const Targoman::DLA::DocItemPtrVector_t &_items);
+  void addPage(size_t _pageIndex, const std::vector<uint64_t> &_fingerprints);
+  void addPage(size_t _pageIndex,
+               const Targoman::DLA::DocItemPtrVector_t &_items);
+  RepeatedElementVector_t findRepeatedElements(
+      size_t _pageIndex, const Targoman::DLA::DocItemPtrVector_t &_items,
+      const Targoman::DLA::stuSize &_pageSize) const;
+};
+
+}  // namespace PDFLA
+}  // namespace Targoman
+
+#endif  // __TARGOMAN_PDFLA_CLSPAGEFURNITUREINDEX__
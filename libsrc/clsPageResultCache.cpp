@@ -0,0 +1,311 @@
+#include "clsPageResultCache.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include "algorithm.hpp"
+#include "serialization.h"
+
+namespace Targoman {
+namespace PDFLA {
+using namespace Targoman::DLA;
+using namespace Targoman::Common;
+namespace fs = std::filesystem;
+
+constexpr char PAGE_RESULT_FILE_EXTENSION[] = ".pdfla";
+constexpr size_t PAGE_RESULT_FILE_STEM_LENGTH = 16;
+
+clsPageResultCache::clsPageResultCache()
+    : MaxMemoryBytes(0), MaxDiskBytes(0) {}
+
+clsPageResultCache &clsPageResultCache::instance() {
+  static clsPageResultCache Instance;
+  return Instance;
+}
+
+uint64_t hashPageResultKey(const PageResultKey_t &_key) {
+  return hashBytes(reinterpret_cast<const uint8_t *>(_key.data()),
+                   _key.size() * sizeof(uint64_t));
+}
+
+void removeFiles(const std::vector<std::string> &_paths) {
+  std::error_code Error;
+  for (const auto &Path : _paths)
+    if (Path.size()) fs::remove(Path, Error);
+}
+
+// Entry files hold the number of key words, the key and then the blocks
+size_t entryFileSize(const PageResultKey_t &_key, size_t _dataSize) {
+  return (_key.size() + 1) * sizeof(uint64_t) + _dataSize;
+}
+
+bool writeEntryFile(const std::string &_path, const PageResultKey_t &_key,
+                    const std::vector<uint8_t> &_data) {
+  //@NOTE: Written aside and renamed, so concurrent writers and processes
+  //       sharing the directory never read a partial entry
+  auto TemporaryPath =
+      _path + "." +
+      std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) +
+      ".tmp";
+  {
+    uint64_t KeySize = _key.size();
+    std::ofstream File(TemporaryPath, std::ios::binary | std::ios::trunc);
+    File.write(reinterpret_cast<const char *>(&KeySize), sizeof(KeySize));
+    File.write(reinterpret_cast<const char *>(_key.data()),
+               static_cast<std::streamsize>(KeySize * sizeof(uint64_t)));
+    File.write(reinterpret_cast<const char *>(_data.data()),
+               static_cast<std::streamsize>(_data.size()));
+    if (!File) {
+      File.close();
+      removeFiles({TemporaryPath});
+      return false;
+    }
+  }
+  std::error_code Error;
+  fs::rename(TemporaryPath, _path, Error);
+  if (Error) {
+    fs::remove(TemporaryPath, Error);
+    return false;
+  }
+  return true;
+}
+
+enum class enuEntryFileState { Matched, OtherKey, Unreadable };
+
+// Leaves the blocks part of a matching entry file in `_data`
+enuEntryFileState readEntryFile(const std::string &_path, size_t _size,
+                                const PageResultKey_t &_key,
+                                std::vector<uint8_t> &_data) {
+  size_t KeyBytes = (_key.size() + 1) * sizeof(uint64_t);
+  std::ifstream File(_path, std::ios::binary);
+  _data.resize(_size);
+  File.read(reinterpret_cast<char *>(_data.data()),
+            static_cast<std::streamsize>(_data.size()));
+  if (!File || _size < sizeof(uint64_t)) return enuEntryFileState::Unreadable;
+
+  uint64_t KeySize;
+  std::memcpy(&KeySize, _data.data(), sizeof(KeySize));
+  if (KeySize >= _size / sizeof(uint64_t)) return enuEntryFileState::Unreadable;
+  if (KeySize != _key.size() ||
+      std::memcmp(_data.data() + sizeof(KeySize), _key.data(),
+                  _key.size() * sizeof(uint64_t)) != 0)
+    return enuEntryFileState::OtherKey;
+  _data.erase(_data.begin(),
+              _data.begin() + static_cast<std::ptrdiff_t>(KeyBytes));
+  return enuEntryFileState::Matched;
+}
+
+std::string clsPageResultCache::entryPath(uint64_t _hash) const {
+  char Stem[PAGE_RESULT_FILE_STEM_LENGTH + 1];
+  std::snprintf(Stem, sizeof(Stem), "%016" PRIx64, _hash);
+  return (fs::path(this->DiskPath) / (Stem + std::string(
+                                                 PAGE_RESULT_FILE_EXTENSION)))
+      .string();
+}
+
+void clsPageResultCache::configure(size_t _maxMemoryBytes,
+                                   const std::string &_diskPath,
+                                   size_t _maxDiskBytes) {
+  std::vector<std::string> RemovedFiles;
+  {
+    std::lock_guard<std::mutex> Guard(this->Lock);
+    this->MaxMemoryBytes = _maxMemoryBytes;
+    while (this->Stats.MemoryBytes > this->MaxMemoryBytes) {
+      auto Entry = this->MemoryEntries.find(this->MemoryUsage.back());
+      this->Stats.MemoryBytes -= Entry->second.Data->size();
+      this->MemoryEntries.erase(Entry);
+      this->MemoryUsage.pop_back();
+    }
+    this->Stats.MemoryEntries = this->MemoryEntries.size();
+
+    this->DiskPath = _maxDiskBytes > 0 ? _diskPath : std::string();
+    this->MaxDiskBytes = _maxDiskBytes;
+    this->DiskUsage.clear();
+    this->DiskEntries.clear();
+    this->Stats.DiskBytes = 0;
+    this->Stats.DiskEntries = 0;
+    if (this->DiskPath.empty()) return;
+
+    //@NOTE: Entries left by earlier runs are picked up, oldest first in the
+    //       eviction order
+    std::error_code Error;
+    fs::create_directories(this->DiskPath, Error);
+    std::vector<std::tuple<fs::file_time_type, uint64_t, size_t>> Files;
+    for (const auto &File : fs::directory_iterator(this->DiskPath, Error)) {
+      auto Stem = File.path().stem().string();
+      if (File.path().extension() != PAGE_RESULT_FILE_EXTENSION ||
+          Stem.size() != PAGE_RESULT_FILE_STEM_LENGTH ||
+          Stem.find_first_not_of("0123456789abcdef") != std::string::npos)
+        continue;
+      Files.emplace_back(File.last_write_time(Error),
+                         std::stoull(Stem, nullptr, 16),
+                         static_cast<size_t>(File.file_size(Error)));
+    }
+    std::sort(Files.begin(), Files.end());
+    for (const auto &[Time, Hash, Size] : Files) {
+      this->DiskUsage.push_front(Hash);
+      this->DiskEntries[Hash] = {Size, this->DiskUsage.begin()};
+      this->Stats.DiskBytes += Size;
+    }
+    this->Stats.DiskEntries = this->DiskEntries.size();
+    this->forgetDiskEntriesOverLimit(RemovedFiles);
+  }
+  removeFiles(RemovedFiles);
+}
+
+bool clsPageResultCache::isEnabled() {
+  std::lock_guard<std::mutex> Guard(this->Lock);
+  return this->MaxMemoryBytes > 0 || this->DiskPath.size() > 0;
+}
+
+void clsPageResultCache::storeInMemory(
+    uint64_t _hash, const PageResultKey_t &_key,
+    std::shared_ptr<const std::vector<uint8_t>> _data) {
+  if (_data->size() > this->MaxMemoryBytes) return;
+  auto Existing = this->MemoryEntries.find(_hash);
+  if (Existing != this->MemoryEntries.end()) {
+    this->Stats.MemoryBytes -= Existing->second.Data->size();
+    this->MemoryUsage.erase(Existing->second.Position);
+    this->MemoryEntries.erase(Existing);
+  }
+  while (this->Stats.MemoryBytes + _data->size() > this->MaxMemoryBytes) {
+    auto Entry = this->MemoryEntries.find(this->MemoryUsage.back());
+    this->Stats.MemoryBytes -= Entry->second.Data->size();
+    this->MemoryEntries.erase(Entry);
+    this->MemoryUsage.pop_back();
+  }
+  this->MemoryUsage.push_front(_hash);
+  this->Stats.MemoryBytes += _data->size();
+  this->MemoryEntries[_hash] = {_key, std::move(_data),
+                                this->MemoryUsage.begin()};
+  this->Stats.MemoryEntries = this->MemoryEntries.size();
+}
+
+std::string clsPageResultCache::forgetDiskEntry(uint64_t _hash) {
+  auto Entry = this->DiskEntries.find(_hash);
+  if (Entry == this->DiskEntries.end()) return std::string();
+  this->Stats.DiskBytes -= Entry->second.Size;
+  this->DiskUsage.erase(Entry->second.Position);
+  this->DiskEntries.erase(Entry);
+  this->Stats.DiskEntries = this->DiskEntries.size();
+  return this->entryPath(_hash);
+}
+
+void clsPageResultCache::forgetDiskEntriesOverLimit(
+    std::vector<std::string> &_removedFiles) {
+  while (this->Stats.DiskBytes > this->MaxDiskBytes)
+    _removedFiles.push_back(this->forgetDiskEntry(this->DiskUsage.back()));
+}
+
+bool clsPageResultCache::find(const PageResultKey_t &_key,
+                              DocBlockPtrVector_t &_blocks) {
+  uint64_t Hash = hashPageResultKey(_key);
+  std::shared_ptr<const std::vector<uint8_t>> MemoryData;
+  std::string Path;
+  size_t Size = 0;
+  {
+    std::lock_guard<std::mutex> Guard(this->Lock);
+    auto Entry = this->MemoryEntries.find(Hash);
+    if (Entry != this->MemoryEntries.end() && Entry->second.Key == _key) {
+      this->MemoryUsage.splice(this->MemoryUsage.begin(), this->MemoryUsage,
+                               Entry->second.Position);
+      MemoryData = Entry->second.Data;
+    }
+    auto DiskEntry = this->DiskEntries.find(Hash);
+    if (DiskEntry != this->DiskEntries.end()) {
+      Path = this->entryPath(Hash);
+      Size = DiskEntry->second.Size;
+    }
+  }
+
+  if (MemoryData &&
+      deserializeBlocks(MemoryData->data(), MemoryData->size(), _blocks)) {
+    std::lock_guard<std::mutex> Guard(this->Lock);
+    ++this->Stats.Hits;
+    return true;
+  }
+
+  auto State = enuEntryFileState::Unreadable;
+  auto Data = std::make_shared<std::vector<uint8_t>>();
+  if (Path.size()) {
+    State = readEntryFile(Path, Size, _key, *Data);
+    if (State == enuEntryFileState::Matched &&
+        !deserializeBlocks(Data->data(), Data->size(), _blocks))
+      State = enuEntryFileState::Unreadable;
+  }
+
+  std::vector<std::string> RemovedFiles;
+  {
+    std::lock_guard<std::mutex> Guard(this->Lock);
+    auto DiskEntry = this->DiskEntries.find(Hash);
+    //@NOTE: Only the entry that was read, as others may have replaced it
+    bool SameEntry = DiskEntry != this->DiskEntries.end() &&
+                     DiskEntry->second.Size == Size &&
+                     this->entryPath(Hash) == Path;
+    if (State == enuEntryFileState::Matched) {
+      ++this->Stats.Hits;
+      if (SameEntry)
+        this->DiskUsage.splice(this->DiskUsage.begin(), this->DiskUsage,
+                               DiskEntry->second.Position);
+      if (this->MaxMemoryBytes > 0)
+        this->storeInMemory(Hash, _key, std::move(Data));
+      return true;
+    }
+    //@NOTE: Missing, short or corrupt files are dropped, while entries of
+    //       other keys with the same hash are kept
+    if (Path.size() && State == enuEntryFileState::Unreadable && SameEntry)
+      RemovedFiles.push_back(this->forgetDiskEntry(Hash));
+    ++this->Stats.Misses;
+  }
+  removeFiles(RemovedFiles);
+  return false;
+}
+
+void clsPageResultCache::add(const PageResultKey_t &_key,
+                             const DocBlockPtrVector_t &_blocks) {
+  uint64_t Hash = hashPageResultKey(_key);
+  auto Data = std::make_shared<std::vector<uint8_t>>();
+  serializeBlocks(_blocks, *Data);
+  size_t Size = entryFileSize(_key, Data->size());
+
+  std::string Path;
+  {
+    std::lock_guard<std::mutex> Guard(this->Lock);
+    if (this->MaxMemoryBytes > 0) this->storeInMemory(Hash, _key, Data);
+    if (this->DiskPath.empty() || Size > this->MaxDiskBytes ||
+        this->DiskEntries.count(Hash))
+      return;
+    Path = this->entryPath(Hash);
+  }
+
+  if (!writeEntryFile(Path, _key, *Data)) return;
+
+  std::vector<std::string> RemovedFiles;
+  {
+    std::lock_guard<std::mutex> Guard(this->Lock);
+    if (this->DiskPath.empty() || this->entryPath(Hash) != Path) {
+      //@NOTE: The cache was moved elsewhere while writing
+      RemovedFiles.push_back(Path);
+    } else if (this->DiskEntries.count(Hash) == 0) {
+      this->DiskUsage.push_front(Hash);
+      this->DiskEntries[Hash] = {Size, this->DiskUsage.begin()};
+      this->Stats.DiskBytes += Size;
+      this->Stats.DiskEntries = this->DiskEntries.size();
+      this->forgetDiskEntriesOverLimit(RemovedFiles);
+    }
+  }
+  removeFiles(RemovedFiles);
+}
+
+stuPageResultCacheStats clsPageResultCache::stats() {
+  std::lock_guard<std::mutex> Guard(this->Lock);
+  return this->Stats;
+}
+
+}  // namespace PDFLA
+}  // namespace Targoman
@@ -0,0 +1,75 @@
+#ifndef __TARGOMAN_PDFLA_CLSPAGERESULTCACHE__
+#define __TARGOMAN_PDFLA_CLSPAGERESULTCACHE__
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "pdfla.h"
+
+namespace Targoman {
+namespace PDFLA {
+
+// The words the key of a page result is made of. Entries are indexed by its
+// hash but keep the whole key, which is compared on every hit.
+typedef std::vector<uint64_t> PageResultKey_t;
+
+/**
+ * Process wide cache of analyzed page layouts (as serialized blocks) keyed by
+ * a hash of the page content and the analysis options, so duplicate pages of
+ * re-uploaded or re-published documents are analyzed only once. It has a
+ * memory level and an optional directory level, each evicted least recently
+ * used first once over its size limit. Files are read, written and removed
+ * and blocks (de)serialized without holding the lock.
+ */
+class clsPageResultCache {
+ private:
+  struct stuMemoryEntry {
+    PageResultKey_t Key;
+    std::shared_ptr<const std::vector<uint8_t>> Data;
+    std::list<uint64_t>::iterator Position;
+  };
+  struct stuDiskEntry {
+    size_t Size;
+    std::list<uint64_t>::iterator Position;
+  };
+
+  std::mutex Lock;
+  size_t MaxMemoryBytes;
+  std::string DiskPath;
+  size_t MaxDiskBytes;
+  std::list<uint64_t> MemoryUsage;
+  std::unordered_map<uint64_t, stuMemoryEntry> MemoryEntries;
+  std::list<uint64_t> DiskUsage;
+  std::unordered_map<uint64_t, stuDiskEntry> DiskEntries;
+  stuPageResultCacheStats Stats;
+
+ private:
+  clsPageResultCache();
+  std::string entryPath(uint64_t _hash) const;
+  void storeInMemory(uint64_t _hash, const PageResultKey_t &_key,
+                     std::shared_ptr<const std::vector<uint8_t>> _data);
+  // Drop disk entries from the books, returning the files to remove
+  std::string forgetDiskEntry(uint64_t _hash);
+  void forgetDiskEntriesOverLimit(std::vector<std::string> &_removedFiles);
+
+ public:
+  static clsPageResultCache &instance();
+
+  void configure(size_t _maxMemoryBytes, const std::string &_diskPath,
+                 size_t _maxDiskBytes);
+  bool isEnabled();
+  bool find(const PageResultKey_t &_key,
+            Targoman::DLA::DocBlockPtrVector_t &_blocks);
+  void add(const PageResultKey_t &_key,
+           const Targoman::DLA::DocBlockPtrVector_t &_blocks);
+  stuPageResultCacheStats stats();
+};
+
+}  // namespace PDFLA
+}  // namespace Targoman
+
+#endif  // __TARGOMAN_PDFLA_CLSPAGERESULTCACHE__
@@ -0,0 +1,536 @@
+#include "clsPdfLaWorkerPool.h"
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+#include "clsSharedRingBuffer.h"
+#include "serialization.h"
+
+namespace Targoman {
+namespace PDFLA {
+using namespace Targoman::DLA;
+
+constexpr size_t WORKER_RING_BUFFER_SIZE = 4 << 20;
+constexpr uint32_t PAGE_COUNT_REQUEST = std::numeric_limits<uint32_t>::max();
+constexpr auto FULL_RING_BACKOFF = std::chrono::microseconds(100);
+// Every response is [uint32 payload size][uint8 status][payload]
+constexpr size_t RESPONSE_HEADER_SIZE = sizeof(uint32_t) + sizeof(uint8_t);
+
+enum class enuSpawnerCommand : uint8_t {
+  Start,  // Forks the worker on the socket sent along, replies its pid
+  Stop,   // Kills and reaps the worker, replies zero
+  Exit    // Stops all workers and exits, without a reply
+};
+
+struct stuSpawnerRequest {
+  enuSpawnerCommand Command;
+  uint32_t WorkerIndex;
+};
+
+struct stuWorker {
+  pid_t Pid;
+  int Socket;
+  std::unique_ptr<clsSharedRingBuffer> Ring;
+  std::vector<uint8_t> Response;
+  bool IsBusy;
+  size_t JobIndex;
+  std::chrono::steady_clock::time_point Deadline;
+  stuWorker() : Pid(-1), Socket(-1), IsBusy(false), JobIndex(0) {}
+};
+
+struct stuResponse {
+  enuPageJobStatus Status;
+  std::vector<uint8_t> Payload;
+};
+
+bool sendAll(int _socket, const void *_data, size_t _size) {
+  auto Data = static_cast<const uint8_t *>(_data);
+  while (_size > 0) {
+    auto Sent = send(_socket, Data, _size, MSG_NOSIGNAL);
+    if (Sent < 0 && errno == EINTR) continue;
+    if (Sent <= 0) return false;
+    Data += Sent;
+    _size -= static_cast<size_t>(Sent);
+  }
+  return true;
+}
+
+bool receiveAll(int _socket, void *_data, size_t _size) {
+  auto Data = static_cast<uint8_t *>(_data);
+  while (_size > 0) {
+    auto Received = recv(_socket, Data, _size, 0);
+    if (Received < 0 && errno == EINTR) continue;
+    if (Received <= 0) return false;
+    Data += Received;
+    _size -= static_cast<size_t>(Received);
+  }
+  return true;
+}
+
+// Sends the request, with `_socket` attached when it is not negative
+bool sendSpawnerRequest(int _spawnerSocket, const stuSpawnerRequest &_request,
+                        int _socket) {
+  iovec Buffer{const_cast<stuSpawnerRequest *>(&_request), sizeof(_request)};
+  msghdr Message{};
+  Message.msg_iov = &Buffer;
+  Message.msg_iovlen = 1;
+  alignas(cmsghdr) char Control[CMSG_SPACE(sizeof(int))];
+  if (_socket >= 0) {
+    std::memset(Control, 0, sizeof(Control));
+    Message.msg_control = Control;
+    Message.msg_controllen = sizeof(Control);
+    auto Header = CMSG_FIRSTHDR(&Message);
+    Header->cmsg_level = SOL_SOCKET;
+    Header->cmsg_type = SCM_RIGHTS;
+    Header->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(Header), &_socket, sizeof(int));
+  }
+  while (true) {
+    auto Sent = sendmsg(_spawnerSocket, &Message, MSG_NOSIGNAL);
+    if (Sent < 0 && errno == EINTR) continue;
+    return Sent == static_cast<ssize_t>(sizeof(_request));
+  }
+}
+
+// `_socket` is set to the attached socket, or -1 when there is none
+bool receiveSpawnerRequest(int _spawnerSocket, stuSpawnerRequest &_request,
+                           int &_socket) {
+  _socket = -1;
+  iovec Buffer{&_request, sizeof(_request)};
+  msghdr Message{};
+  Message.msg_iov = &Buffer;
+  Message.msg_iovlen = 1;
+  alignas(cmsghdr) char Control[CMSG_SPACE(sizeof(int))];
+  Message.msg_control = Control;
+  Message.msg_controllen = sizeof(Control);
+  ssize_t Received;
+  do {
+    Received = recvmsg(_spawnerSocket, &Message, 0);
+  } while (Received < 0 && errno == EINTR);
+  for (auto Header = CMSG_FIRSTHDR(&Message); Header != nullptr;
+       Header = CMSG_NXTHDR(&Message, Header))
+    if (Header->cmsg_level == SOL_SOCKET && Header->cmsg_type == SCM_RIGHTS)
+      std::memcpy(&_socket, CMSG_DATA(Header), sizeof(int));
+  if (Received == static_cast<ssize_t>(sizeof(_request))) return true;
+  if (_socket >= 0) close(_socket);
+  _socket = -1;
+  return false;
+}
+
+void killAndReap(pid_t _pid) {
+  kill(_pid, SIGKILL);
+  while (waitpid(_pid, nullptr, 0) < 0 && errno == EINTR) {
+  }
+}
+
+class clsPdfLaWorkerPoolInternals {
+ private:
+  std::vector<uint8_t> Data;
+  std::chrono::milliseconds PageTimeout;
+  std::function<void(clsPdfLa &)> Configure;
+  std::vector<stuWorker> Workers;
+  pid_t SpawnerPid;
+  int SpawnerSocket;
+  size_t RestartCount;
+  size_t PageCount;
+  bool PageCountIsKnown;
+
+ private:
+  [[noreturn]] void runSpawner(int _socket);
+  [[noreturn]] void runWorker(stuWorker &_worker, int _socket);
+  void startSpawner();
+  bool startWorker(stuWorker &_worker);
+  void stopWorker(stuWorker &_worker);
+  void restartWorker(stuWorker &_worker);
+  bool dispatch(stuWorker &_worker, size_t _jobIndex, uint32_t _request);
+  bool drainSignals(stuWorker &_worker);
+  bool pullResponse(stuWorker &_worker);
+  std::vector<stuResponse> run(const std::vector<uint32_t> &_requests);
+
+ public:
+  clsPdfLaWorkerPoolInternals(const uint8_t *_data, size_t _size,
+                              size_t _numberOfWorkers,
+                              std::chrono::milliseconds _pageTimeout,
+                              std::function<void(clsPdfLa &)> _configure);
+  ~clsPdfLaWorkerPoolInternals();
+
+  size_t pageCount();
+  size_t restartCount() const { return this->RestartCount; }
+  std::vector<stuPageJobResult> getPageBlocks(
+      const std::vector<size_t> &_pageIndices);
+};
+
+clsPdfLaWorkerPool::clsPdfLaWorkerPool(
+    const uint8_t *_data, size_t _size, size_t _numberOfWorkers,
+    std::chrono::milliseconds _pageTimeout,
+    std::function<void(clsPdfLa &)> _configure)
+    : Internals(new clsPdfLaWorkerPoolInternals(
+          _data, _size, _numberOfWorkers, _pageTimeout, _configure)) {}
+
+clsPdfLaWorkerPool::~clsPdfLaWorkerPool() {}
+
+size_t clsPdfLaWorkerPool::pageCount() { return this->Internals->pageCount(); }
+
+size_t clsPdfLaWorkerPool::restartCount() {
+  return this->Internals->restartCount();
+}
+
+stuPageJobResult clsPdfLaWorkerPool::getPageBlocks(size_t _pageIndex) {
+  return this->Internals->getPageBlocks({_pageIndex}).front();
+}
+
+std::vector<stuPageJobResult> clsPdfLaWorkerPool::getPageBlocks(
+    const std::vector<size_t> &_pageIndices) {
+  return this->Internals->getPageBlocks(_pageIndices);
+}
+
+/******************************************************************************/
+clsPdfLaWorkerPoolInternals::clsPdfLaWorkerPoolInternals(
+    const uint8_t *_data, size_t _size, size_t _numberOfWorkers,
+    std::chrono::milliseconds _pageTimeout,
+    std::function<void(clsPdfLa &)> _configure)
+    : Data(_data, _data + _size),
+      PageTimeout(_pageTimeout),
+      Configure(_configure),
+      SpawnerPid(-1),
+      SpawnerSocket(-1),
+      RestartCount(0),
+      PageCount(0),
+      PageCountIsKnown(false) {
+  if (_numberOfWorkers == 0)
+    _numberOfWorkers =
+        std::max(static_cast<size_t>(std::thread::hardware_concurrency()),
+                 static_cast<size_t>(1));
+  this->Workers.resize(_numberOfWorkers);
+  //@NOTE: The rings are mapped before the spawner is forked, so they are
+  //       shared with every worker it starts
+  for (auto &Worker : this->Workers)
+    Worker.Ring.reset(new clsSharedRingBuffer(WORKER_RING_BUFFER_SIZE));
+  this->startSpawner();
+}
+
+clsPdfLaWorkerPoolInternals::~clsPdfLaWorkerPoolInternals() {
+  for (auto &Worker : this->Workers) this->stopWorker(Worker);
+  if (this->SpawnerPid > 0) {
+    //@NOTE: Processes forked later (e.g. the spawners of other pools) share
+    //       the socket, so the spawner is told to exit instead of waiting for
+    //       it to be hung up
+    sendSpawnerRequest(this->SpawnerSocket,
+                       {enuSpawnerCommand::Exit, 0}, -1);
+    close(this->SpawnerSocket);
+    while (waitpid(this->SpawnerPid, nullptr, 0) < 0 && errno == EINTR) {
+    }
+  }
+}
+
+void clsPdfLaWorkerPoolInternals::startSpawner() {
+  int Sockets[2];
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, Sockets) != 0)
+    return;
+  pid_t Pid = fork();
+  if (Pid < 0) {
+    close(Sockets[0]);
+    close(Sockets[1]);
+    return;
+  }
+  if (Pid == 0) {
+    close(Sockets[0]);
+    this->runSpawner(Sockets[1]);
+  }
+  close(Sockets[1]);
+  this->SpawnerPid = Pid;
+  this->SpawnerSocket = Sockets[0];
+}
+
+//@NOTE: The spawner only ever runs this thread, so the workers it forks never
+//       inherit locks or PDFium state held by other threads of the host
+void clsPdfLaWorkerPoolInternals::runSpawner(int _socket) {
+  std::vector<pid_t> Pids(this->Workers.size(), -1);
+  stuSpawnerRequest Request;
+  int WorkerSocket;
+  while (receiveSpawnerRequest(_socket, Request, WorkerSocket)) {
+    if (Request.Command == enuSpawnerCommand::Exit) break;
+    pid_t Reply = -1;
+    if (Request.WorkerIndex < Pids.size()) {
+      auto &Pid = Pids[Request.WorkerIndex];
+      if (Pid > 0) killAndReap(Pid);
+      Pid = -1;
+      if (Request.Command == enuSpawnerCommand::Stop) {
+        Reply = 0;
+      } else if (WorkerSocket >= 0) {
+        Pid = fork();
+        if (Pid == 0) {
+          close(_socket);
+          this->runWorker(this->Workers[Request.WorkerIndex], WorkerSocket);
+        }
+        Reply = Pid;
+      }
+    }
+    if (WorkerSocket >= 0) close(WorkerSocket);
+    if (sendAll(_socket, &Reply, sizeof(Reply)) == false) break;
+  }
+  for (auto Pid : Pids)
+    if (Pid > 0) killAndReap(Pid);
+  _exit(0);
+}
+
+void clsPdfLaWorkerPoolInternals::runWorker(stuWorker &_worker, int _socket) {
+  clsPdfLa Document(this->Data.data(), this->Data.size());
+  if (this->Configure) this->Configure(Document);
+
+  std::vector<uint8_t> Message;
+  std::vector<uint8_t> Payload;
+  uint32_t Request;
+  while (receiveAll(_socket, &Request, sizeof(Request))) {
+    auto Status = enuPageJobStatus::Done;
+    Payload.clear();
+    if (Request == PAGE_COUNT_REQUEST) {
+      auto PageCount = static_cast<uint32_t>(Document.pageCount());
+      auto Bytes = reinterpret_cast<const uint8_t *>(&PageCount);
+      Payload.assign(Bytes, Bytes + sizeof(PageCount));
+    } else if (Request < Document.pageCount()) {
+      serializeBlocks(Document.getPageBlocks(Request), Payload);
+    } else {
+      Status = enuPageJobStatus::Failed;
+    }
+
+    auto PayloadSize = static_cast<uint32_t>(Payload.size());
+    auto StatusByte = static_cast<uint8_t>(Status);
+    Message.resize(RESPONSE_HEADER_SIZE);
+    std::memcpy(Message.data(), &PayloadSize, sizeof(PayloadSize));
+    std::memcpy(Message.data() + sizeof(PayloadSize), &StatusByte, 1);
+    Message.insert(Message.end(), Payload.begin(), Payload.end());
+
+    size_t Offset = 0;
+    while (Offset < Message.size()) {
+      auto Written = _worker.Ring->write(Message.data() + Offset,
+                                         Message.size() - Offset);
+      if (Written == 0) {
+        std::this_thread::sleep_for(FULL_RING_BACKOFF);
+        continue;
+      }
+      Offset += Written;
+      uint8_t Signal = 0;
+      if (sendAll(_socket, &Signal, sizeof(Signal)) == false) _exit(1);
+    }
+  }
+  _exit(0);
+}
+
+bool clsPdfLaWorkerPoolInternals::startWorker(stuWorker &_worker) {
+  if (this->SpawnerPid < 0 || _worker.Ring->isValid() == false) return false;
+  _worker.Ring->reset();
+
+  int Sockets[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, Sockets) != 0)
+    return false;
+  stuSpawnerRequest Request{
+      enuSpawnerCommand::Start,
+      static_cast<uint32_t>(&_worker - this->Workers.data())};
+  pid_t Pid = -1;
+  bool IsSent = sendSpawnerRequest(this->SpawnerSocket, Request, Sockets[1]);
+  //@NOTE: Only the worker may keep its end open, otherwise the supervisor
+  //       never sees it hang up when it crashes
+  close(Sockets[1]);
+  if (IsSent == false ||
+      receiveAll(this->SpawnerSocket, &Pid, sizeof(Pid)) == false ||
+      Pid <= 0) {
+    close(Sockets[0]);
+    return false;
+  }
+
+  _worker.Pid = Pid;
+  _worker.Socket = Sockets[0];
+  _worker.Response.clear();
+  _worker.IsBusy = false;
+  return true;
+}
+
+//@NOTE: Returns once the worker is reaped, so it no longer writes to its ring
+void clsPdfLaWorkerPoolInternals::stopWorker(stuWorker &_worker) {
+  if (_worker.Socket >= 0) close(_worker.Socket);
+  if (_worker.Pid > 0) {
+    stuSpawnerRequest Request{
+        enuSpawnerCommand::Stop,
+        static_cast<uint32_t>(&_worker - this->Workers.data())};
+    pid_t Reply;
+    if (sendSpawnerRequest(this->SpawnerSocket, Request, -1) == false ||
+        receiveAll(this->SpawnerSocket, &Reply, sizeof(Reply)) == false)
+      kill(_worker.Pid, SIGKILL);
+  }
+  _worker.Pid = -1;
+  _worker.Socket = -1;
+  _worker.IsBusy = false;
+}
+
+void clsPdfLaWorkerPoolInternals::restartWorker(stuWorker &_worker) {
+  this->stopWorker(_worker);
+  ++this->RestartCount;
+  this->startWorker(_worker);
+}
+
+bool clsPdfLaWorkerPoolInternals::dispatch(stuWorker &_worker,
+                                           size_t _jobIndex,
+                                           uint32_t _request) {
+  if (sendAll(_worker.Socket, &_request, sizeof(_request)) == false)
+    return false;
+  _worker.IsBusy = true;
+  _worker.JobIndex = _jobIndex;
+  _worker.Deadline = std::chrono::steady_clock::now() + this->PageTimeout;
+  return true;
+}
+
+// Returns false once the worker has hung up
+bool clsPdfLaWorkerPoolInternals::drainSignals(stuWorker &_worker) {
+  uint8_t Signals[256];
+  while (true) {
+    auto Received =
+        recv(_worker.Socket, Signals, sizeof(Signals), MSG_DONTWAIT);
+    if (Received > 0) continue;
+    if (Received < 0 && errno == EINTR) continue;
+    return Received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+  }
+}
+
+// Returns true when the whole response of the current job has arrived
+bool clsPdfLaWorkerPoolInternals::pullResponse(stuWorker &_worker) {
+  auto &Response = _worker.Response;
+  //@NOTE: Grown by what is readable only, as zero filling a whole ring
+  //       capacity on every wake up costs more than the copy itself
+  while (size_t Readable = _worker.Ring->readable()) {
+    size_t Size = Response.size();
+    Response.resize(Size + Readable);
+    auto Read = _worker.Ring->read(Response.data() + Size, Readable);
+    Response.resize(Size + Read);
+  }
+  if (Response.size() < RESPONSE_HEADER_SIZE) return false;
+  uint32_t PayloadSize;
+  std::memcpy(&PayloadSize, Response.data(), sizeof(PayloadSize));
+  return Response.size() >= RESPONSE_HEADER_SIZE + PayloadSize;
+}
+
+std::vector<stuResponse> clsPdfLaWorkerPoolInternals::run(
+    const std::vector<uint32_t> &_requests) {
+  std::vector<stuResponse> Responses(_requests.size(),
+                                     {enuPageJobStatus::Crashed, {}});
+  std::vector<pollfd> PollFds;
+  std::vector<stuWorker *> PolledWorkers;
+  size_t NextJob = 0;
+  size_t FinishedJobs = 0;
+
+  auto finishJob = [&](stuWorker &_worker, enuPageJobStatus _status) {
+    auto &Response = Responses[_worker.JobIndex];
+    Response.Status = _status;
+    if (_status == enuPageJobStatus::Done) {
+      uint8_t StatusByte = _worker.Response[sizeof(uint32_t)];
+      Response.Status = StatusByte <= static_cast<uint8_t>(
+                                          enuPageJobStatus::TimedOut)
+                            ? static_cast<enuPageJobStatus>(StatusByte)
+                            : enuPageJobStatus::Failed;
+      Response.Payload.assign(_worker.Response.begin() + RESPONSE_HEADER_SIZE,
+                              _worker.Response.end());
+    }
+    _worker.Response.clear();
+    _worker.IsBusy = false;
+    ++FinishedJobs;
+  };
+
+  while (FinishedJobs < _requests.size()) {
+    for (auto &Worker : this->Workers) {
+      if (Worker.IsBusy || NextJob >= _requests.size()) continue;
+      if (Worker.Pid < 0 && this->startWorker(Worker) == false) continue;
+      if (this->dispatch(Worker, NextJob, _requests[NextJob]) == false) {
+        // An idle worker died in between, so retry on a fresh one
+        this->restartWorker(Worker);
+        if (Worker.Pid < 0 ||
+            this->dispatch(Worker, NextJob, _requests[NextJob]) == false)
+          continue;
+      }
+      ++NextJob;
+    }
+
+    PollFds.clear();
+    PolledWorkers.clear();
+    auto Now = std::chrono::steady_clock::now();
+    auto Timeout = this->PageTimeout;
+    for (auto &Worker : this->Workers) {
+      if (Worker.IsBusy == false) continue;
+      PollFds.push_back({Worker.Socket, POLLIN, 0});
+      PolledWorkers.push_back(&Worker);
+      Timeout = std::min(
+          Timeout, std::chrono::duration_cast<std::chrono::milliseconds>(
+                       Worker.Deadline - Now));
+    }
+    // No worker could be started, so the remaining jobs are left as crashed
+    if (PolledWorkers.empty()) break;
+
+    poll(PollFds.data(), PollFds.size(),
+         static_cast<int>(std::max<int64_t>(Timeout.count(), 0) + 1));
+
+    Now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < PolledWorkers.size(); ++i) {
+      auto &Worker = *PolledWorkers[i];
+      bool HungUp = (PollFds[i].revents & (POLLHUP | POLLERR)) ||
+                    this->drainSignals(Worker) == false;
+      if (this->pullResponse(Worker)) {
+        finishJob(Worker, enuPageJobStatus::Done);
+      } else if (HungUp) {
+        finishJob(Worker, enuPageJobStatus::Crashed);
+        this->restartWorker(Worker);
+      } else if (Now >= Worker.Deadline) {
+        finishJob(Worker, enuPageJobStatus::TimedOut);
+        this->restartWorker(Worker);
+      }
+    }
+  }
+  return Responses;
+}
+
+size_t clsPdfLaWorkerPoolInternals::pageCount() {
+  if (this->PageCountIsKnown == false) {
+    auto Responses = this->run({PAGE_COUNT_REQUEST});
+    if (Responses.front().Status == enuPageJobStatus::Done &&
+        Responses.front().Payload.size() == sizeof(uint32_t)) {
+      uint32_t PageCount;
+      std::memcpy(&PageCount, Responses.front().Payload.data(),
+                  sizeof(PageCount));
+      this->PageCount = PageCount;
+      this->PageCountIsKnown = true;
+    }
+  }
+  return this->PageCount;
+}
+
+std::vector<stuPageJobResult> clsPdfLaWorkerPoolInternals::getPageBlocks(
+    const std::vector<size_t> &_pageIndices) {
+  std::vector<uint32_t> Requests;
+  Requests.reserve(_pageIndices.size());
+  for (auto PageIndex : _pageIndices)
+    Requests.push_back(static_cast<uint32_t>(
+        std::min(PageIndex, static_cast<size_t>(PAGE_COUNT_REQUEST - 1))));
+
+  auto Responses = this->run(Requests);
+  std::vector<stuPageJobResult> Result(_pageIndices.size());
+  for (size_t i = 0; i < Responses.size(); ++i) {
+    Result[i].PageIndex = _pageIndices[i];
+    Result[i].Status = Responses[i].Status;
+    if (Result[i].Status == enuPageJobStatus::Done &&
+        deserializeBlocks(Responses[i].Payload.data(),
+                          Responses[i].Payload.size(),
+                          Result[i].Blocks) == false)
+      Result[i].Status = enuPageJobStatus::Failed;
+  }
+  return Result;
+}
+
+}  // namespace PDFLA
+}  // namespace Targoman
@@ -0,0 +1,63 @@
+#ifndef __TARGOMAN_PDFLA_CLSPDFLAWORKERPOOL__
+#define __TARGOMAN_PDFLA_CLSPDFLAWORKERPOOL__
+
+#include <chrono>
+#include <functional>
+
+#include "pdfla.h"
+
+namespace Targoman {
+namespace PDFLA {
+
+enum class enuPageJobStatus {
+  Done,
+  Failed,    // The worker rejected the request, e.g. page index out of range
+  Crashed,   // The worker died while analyzing the page
+  TimedOut   // The worker was killed after exceeding the page timeout
+};
+
+struct stuPageJobResult {
+  size_t PageIndex;
+  enuPageJobStatus Status;
+  Targoman::DLA::DocBlockPtrVector_t Blocks;
+};
+
+class clsPdfLaWorkerPoolInternals;
+/**
+ * Runs the layout analysis of a document in forked worker processes, each with
+ * its own PDFium state, so pages are analyzed on all cores and a malformed
+ * page that crashes or hangs PDFium only costs that page. Workers stream the
+ * serialized blocks back through shared memory and are restarted after a
+ * crash or timeout.
+ *
+ * Workers are forked by a single threaded spawner process, which is itself
+ * forked when the pool is created. The pool must therefore be created while
+ * the process has no other threads running that the workers may depend on,
+ * but workers are safely restarted later on, whatever the host runs by then.
+ */
+class clsPdfLaWorkerPool {
+ private:
+  std::unique_ptr<clsPdfLaWorkerPoolInternals> Internals;
+
+ public:
+  // Zero workers means one per hardware thread. `_configure` is called on the
+  // document of every (re)started worker, e.g. to enable optional analyses.
+  clsPdfLaWorkerPool(
+      const uint8_t *_data, size_t _size, size_t _numberOfWorkers = 0,
+      std::chrono::milliseconds _pageTimeout = std::chrono::seconds(60),
+      std::function<void(clsPdfLa &)> _configure = nullptr);
+  ~clsPdfLaWorkerPool();
+
+  size_t pageCount();
+  size_t restartCount();
+
+  stuPageJobResult getPageBlocks(size_t _pageIndex);
+  // Results are in the order of `_pageIndices`
+  std::vector<stuPageJobResult> getPageBlocks(
+      const std::vector<size_t> &_pageIndices);
+};
+
+}  // namespace PDFLA
+}  // namespace Targoman
+
+#endif  // __TARGOMAN_PDFLA_CLSPDFLAWORKERPOOL__
@@ -1,11 +1,24 @@
 #include "clsPdfiumWrapper.h"
 
+#include <mutex>
+
+#include "algorithm.hpp"
+
 namespace Targoman {
 namespace PDFLA {
 
 using namespace Targoman::DLA;
+using Targoman::Common::hashBytes;
+using Targoman::Common::hashCombine;
 
-static bool __pdfiumModulesInitialized = false;
+constexpr uint64_t CYCLIC_OBJECT_HASH = 0x6a09e667f3bcc909ULL;
+constexpr size_t MAX_PAGE_TREE_DEPTH = 64;
+
+static std::once_flag __pdfiumModulesInitialized;
+//@NOTE: PDFium keeps process wide state (module managers, font and codec
+//       caches), so the calls of all documents into it are serialized.
+//       Recursive, as some public methods are built on the others.
+static std::recursive_mutex __pdfiumLock;
 void initializePdfiumModules() {
   CPDF_ModuleMgr::Create();
   CFX_GEModule::Create();
@@ -156,23 +169,124 @@ std::shared_ptr<clsPdfFont> clsPdfiumWrapper::getFont(CPDF_Font *_rawPdfFont) {
 }
 
 clsPdfiumWrapper::clsPdfiumWrapper(uint8_t *_data, size_t _size) {
-  if (!__glibc_likely(__pdfiumModulesInitialized)) {
-    initializePdfiumModules();
-    __pdfiumModulesInitialized = true;
-  }
+  std::lock_guard<std::recursive_mutex> Guard(__pdfiumLock);
+  std::call_once(__pdfiumModulesInitialized, initializePdfiumModules);
   this->Parser.reset(new CPDF_Parser);
-  this->Parser->StartParse(FX_CreateMemoryStream(_data, _size));
+  this->IsLoaded =
+      this->Parser->StartParse(FX_CreateMemoryStream(_data, _size)) ==
+          PDFPARSE_ERROR_SUCCESS &&
+      this->Parser->GetDocument() != nullptr;
+}
+
+clsPdfiumWrapper::~clsPdfiumWrapper() {
+  std::lock_guard<std::recursive_mutex> Guard(__pdfiumLock);
+  this->LoadedFonts.clear();
+  this->LoadedPages.clear();
+  this->Parser.reset();
 }
 
 size_t clsPdfiumWrapper::pageCount() const {
+  std::lock_guard<std::recursive_mutex> Guard(__pdfiumLock);
+  if (this->IsLoaded == false) return 0;
   return static_cast<size_t>(this->Parser->GetDocument()->GetPageCount());
 }
 
 stuSize clsPdfiumWrapper::getPageSize(size_t _pageIndex) {
+  std::lock_guard<std::recursive_mutex> Guard(__pdfiumLock);
   auto Page = this->getPage(_pageIndex);
   return stuSize(Page->GetPageWidth(), Page->GetPageHeight());
 }
 
+uint64_t clsPdfiumWrapper::hashDictionary(CPDF_Dictionary *_dictionary,
+                                          bool _isStreamDictionary) {
+  uint64_t Hash = 0;
+  if (_dictionary == nullptr) return Hash;
+  FX_POSITION Position = _dictionary->GetStartPos();
+  while (Position) {
+    CFX_ByteString Key;
+    auto Value = _dictionary->GetNextElement(Position, Key);
+    // Back links into the page tree would pull in the whole document
+    if (Key == "Parent" || Key == "P") continue;
+    // Only the decoded stream data matters, not how it was encoded
+    if (_isStreamDictionary &&
+        (Key == "Filter" || Key == "DecodeParms" || Key == "Length"))
+      continue;
+    uint64_t EntryHash = hashBytes(Key.GetPtr(), Key.GetLength());
+    hashCombine(EntryHash, this->hashObject(Value));
+    //@NOTE: Summed since the order of dictionary entries is meaningless
+    Hash += EntryHash;
+  }
+  return Hash;
+}
+
+uint64_t clsPdfiumWrapper::hashObject(CPDF_Object *_object) {
+  if (_object == nullptr) return 0;
+  if (_object->GetType() == PDFOBJ_REFERENCE)
+    return this->hashObject(_object->GetDirect());
+
+  //@NOTE: Indirect objects (fonts, images, shared resources) are hashed once
+  //       per document. The placeholder makes reference cycles terminate.
+  FX_DWORD ObjectNumber = _object->GetObjNum();
+  if (ObjectNumber != 0) {
+    auto Cached = this->ObjectHashes.find(ObjectNumber);
+    if (Cached != this->ObjectHashes.end()) return Cached->second;
+    this->ObjectHashes[ObjectNumber] = CYCLIC_OBJECT_HASH;
+  }
+
+  uint64_t Hash = static_cast<uint64_t>(_object->GetType());
+  switch (_object->GetType()) {
+    case PDFOBJ_ARRAY: {
+      auto Array = static_cast<CPDF_Array *>(_object);
+      for (FX_DWORD i = 0; i < Array->GetCount(); ++i)
+        hashCombine(Hash, this->hashObject(Array->GetElement(i)));
+      break;
+    }
+    case PDFOBJ_DICTIONARY:
+      hashCombine(Hash, this->hashDictionary(
+                            static_cast<CPDF_Dictionary *>(_object), false));
+      break;
+    case PDFOBJ_STREAM: {
+      auto Stream = static_cast<CPDF_Stream *>(_object);
+      hashCombine(Hash, this->hashDictionary(Stream->GetDict(), true));
+      CPDF_StreamAcc StreamData;
+      StreamData.LoadAllData(Stream, FALSE);
+      hashCombine(Hash, hashBytes(StreamData.GetData(), StreamData.GetSize()));
+      break;
+    }
+    case PDFOBJ_NULL:
+      break;
+    default: {
+      auto Value = _object->GetString();
+      hashCombine(Hash, hashBytes(Value.GetPtr(), Value.GetLength()));
+      break;
+    }
+  }
+
+  if (ObjectNumber != 0) this->ObjectHashes[ObjectNumber] = Hash;
+  return Hash;
+}
+
+uint64_t clsPdfiumWrapper::getPageContentHash(size_t _pageIndex) {
+  std::lock_guard<std::recursive_mutex> Guard(__pdfiumLock);
+  auto PageDictionary = this->Parser->GetDocument()->GetPage(_pageIndex);
+  if (PageDictionary == nullptr) return 0;
+
+  auto getInheritedValue = [&](const char *_key) -> CPDF_Object * {
+    auto Dictionary = PageDictionary;
+    for (size_t Depth = 0; Dictionary != nullptr && Depth < MAX_PAGE_TREE_DEPTH;
+         ++Depth, Dictionary = Dictionary->GetDict("Parent"))
+      if (auto Value = Dictionary->GetElementValue(_key)) return Value;
+    return nullptr;
+  };
+
+  uint64_t Hash = 0;
+  for (auto Key : {"MediaBox", "CropBox", "Rotate", "Resources"})
+    hashCombine(Hash, this->hashObject(getInheritedValue(Key)));
+  hashCombine(Hash,
+              this->hashObject(PageDictionary->GetElementValue("Contents")));
+  return Hash;
+}
+
 template <typename VisitText_t, typename VisitPath_t, typename VisitImage_t,
           typename Enter_t, typename Exit_t>
 void traverseObjects(CPDF_FormObject *_pdfFormObject,
@@ -187,43 +301,9 @@ void traverseObjects(CPDF_FormObject *_pdfFormObject,
       case PDFPAGE_TEXT:
         _visitText(static_cast<CPDF_TextObject *>(Object));
         break;
-      case PDFPAGE_PATH: {
-        /* auto PathObject = static_cast<CPDF_PathObject *>(Object->Clone());
-        auto OriginalPathData = PathObject->m_Path.GetObject();
-
-        auto PointCount = OriginalPathData->GetPointCount();
-        auto PointVector = OriginalPathData->GetPoints();
-
-        auto CurrentPathData = PathObject->m_Path.New();
-        CurrentPathData->SetPointCount(PointCount);
-
-        int j = 0;
-        for (int i = 0; i < PointCount; ++i)
-        {
-            if ((PointVector[i].m_Flag & FXPT_TYPE) == FXPT_MOVETO)
-            {
-                if (j > 0)
-                {
-                    CurrentPathData->SetPointCount(j);
-                    _visitPath(PathObject);
-                    auto Clone = static_cast<CPDF_PathObject
-        *>(PathObject->Clone()); CurrentPathData = Clone->m_Path.New();
-                    CurrentPathData->SetPointCount(PointCount - i);
-                    j = 0;
-                    delete PathObject;
-                    PathObject = Clone;
-                }
-            }
-            CurrentPathData->SetPoint(j, PointVector[i].m_PointX,
-        PointVector[i].m_PointY, PointVector[i].m_Flag);
-            ++j;
-        }
-        CurrentPathData->SetPointCount(j);
-        _visitPath(PathObject);
-        delete PathObject;
-        */
+      case PDFPAGE_PATH:
         _visitPath(static_cast<CPDF_PathObject *>(Object));
-      } break;
+        break;
       case PDFPAGE_IMAGE:
         _visitImage(static_cast<CPDF_ImageObject *>(Object));
         break;
@@ -242,6 +322,7 @@ void traverseObjects(CPDF_FormObject *_pdfFormObject,
 CPDF_PageObjects clsPdfiumWrapper::getPdfPageObjects(size_t _pageIndex)
 
 {
+  std::lock_guard<std::recursive_mutex> Guard(__pdfiumLock);
   CPDF_PageObjects Result;
 
   class clsPageObjectsWrapper {
@@ -293,63 +374,108 @@ CPDF_PageObjects clsPdfiumWrapper::getPdfPageObjects(size_t _pageIndex)
   return Result;
 }
 
-bool isVerticalLine(const CPDF_PathObject *_pathObject, CFX_Matrix *_matrix) {
-  auto BBox = _pathObject->GetBBox(_matrix);
-  if (BBox.Width() < 4 && BBox.Height() > 4 * BBox.Width()) return true;
-  return false;
-}
+constexpr float MAX_LINE_THICKNESS = 4.f;
+constexpr float MIN_LINE_ASPECT_RATIO = 4.f;
 
-bool isHorizontalLine(const CPDF_PathObject *_pathObject, CFX_Matrix *_matrix) {
-  auto BBox = _pathObject->GetBBox(_matrix);
-  if (BBox.Height() < 4 && BBox.Width() > 4 * BBox.Height()) return true;
-  return false;
-}
-
-bool isSolidRectangle(const CPDF_PathObject *_pathObject, CFX_Matrix *_matrix) {
-  auto PathData = _pathObject->m_Path.GetObject();
-  auto N = PathData->GetPointCount();
-  auto Points = PathData->GetPoints();
+struct stuPathShape {
+  CFX_FloatRect BoundingRect;
+  enuDocItemType Type;
+};
 
-  auto NumberOfLegs = 1;
-  auto PrevDX = 0, PrevDY = 0;
+/**
+ * Classifies the path made of `_points` in a single walk over them: the
+ * points are transformed by `_matrix` to build the bounding box while the
+ * legs of the path are checked for being an axis aligned rectangle.
+ */
+stuPathShape classifyPath(const FX_PATHPOINT *_points, int _count,
+                          const CFX_Matrix &_matrix, float _halfLineWidth) {
+  stuPathShape Result{CFX_FloatRect(0, 0, 0, 0), enuDocItemType::Path};
+  if (_count <= 0) return Result;
+
+  float X0 = INFINITY, Y0 = INFINITY, X1 = -INFINITY, Y1 = -INFINITY;
+  bool CanBeRectangle = (_points[0].m_Flag & FXPT_TYPE) == FXPT_MOVETO;
+  int NumberOfLegs = 1;
+  float OriginX = 0, OriginY = 0, PrevX = 0, PrevY = 0;
+  float PrevDX = 0, PrevDY = 0;
+
+  auto addLeg = [&](float _x, float _y) {
+    auto DX = std::abs(_x - PrevX);
+    auto DY = std::abs(_y - PrevY);
+    if (DX > MIN_ITEM_SIZE && DY > MIN_ITEM_SIZE) return false;
+    if (DX <= MIN_ITEM_SIZE && DY <= MIN_ITEM_SIZE) return true;
+    if ((DX <= MIN_ITEM_SIZE && PrevDX > MIN_ITEM_SIZE) ||
+        (DY <= MIN_ITEM_SIZE && PrevDY > MIN_ITEM_SIZE))
+      ++NumberOfLegs;
+    PrevX = _x;
+    PrevY = _y;
+    PrevDX = DX;
+    PrevDY = DY;
+    return NumberOfLegs <= 4;
+  };
 
-  FX_PATHPOINT *Origin = nullptr;
-  FX_PATHPOINT *PrevPoint = nullptr;
-  for (int i = 0; i < N; ++i) {
-    if (PrevPoint == nullptr) {
-      if ((Points[i].m_Flag & FXPT_TYPE) != FXPT_MOVETO) return false;
-      PrevPoint = Points + i;
-      Origin = PrevPoint;
+  for (int i = 0; i < _count; ++i) {
+    const auto &Point = _points[i];
+    float X = _matrix.a * Point.m_PointX + _matrix.c * Point.m_PointY +
+              _matrix.e;
+    float Y = _matrix.b * Point.m_PointX + _matrix.d * Point.m_PointY +
+              _matrix.f;
+    X0 = std::min(X0, X);
+    Y0 = std::min(Y0, Y);
+    X1 = std::max(X1, X);
+    Y1 = std::max(Y1, Y);
+
+    if (!CanBeRectangle) continue;
+    if (i == 0) {
+      OriginX = PrevX = X;
+      OriginY = PrevY = Y;
       continue;
     }
-    if ((Points[i].m_Flag & FXPT_TYPE) != FXPT_LINETO) return false;
-    std::vector<FX_PATHPOINT *> CurrentPoints{Points + i};
-    if ((Points[i].m_Flag & FXPT_CLOSEFIGURE) == FXPT_CLOSEFIGURE)
-      CurrentPoints.push_back(Origin);
-    for (auto &Point : CurrentPoints) {
-      auto DX = std::abs(Points[i].m_PointX - PrevPoint->m_PointX);
-      auto DY = std::abs(Points[i].m_PointY - PrevPoint->m_PointY);
-      if (DX > MIN_ITEM_SIZE && DY > MIN_ITEM_SIZE) return false;
-      if (DX <= MIN_ITEM_SIZE && DY <= MIN_ITEM_SIZE) continue;
-      if ((DX <= MIN_ITEM_SIZE && PrevDX > MIN_ITEM_SIZE) ||
-          (DY <= MIN_ITEM_SIZE && PrevDY > MIN_ITEM_SIZE))
-        ++NumberOfLegs;
-      if (NumberOfLegs > 4) return false;
-      PrevPoint = Point;
-      PrevDX = DX;
-      PrevDY = DY;
+    if ((Point.m_Flag & FXPT_TYPE) != FXPT_LINETO) {
+      CanBeRectangle = false;
+      continue;
     }
+    CanBeRectangle = addLeg(X, Y);
+    if (CanBeRectangle &&
+        (Point.m_Flag & FXPT_CLOSEFIGURE) == FXPT_CLOSEFIGURE)
+      CanBeRectangle = addLeg(OriginX, OriginY);
   }
-  return NumberOfLegs == 4;
+
+  Result.BoundingRect = CFX_FloatRect(X0 - _halfLineWidth, Y0 - _halfLineWidth,
+                                      X1 + _halfLineWidth, Y1 + _halfLineWidth);
+  float Width = Result.BoundingRect.Width();
+  float Height = Result.BoundingRect.Height();
+  if (Width < MAX_LINE_THICKNESS && Height > MIN_LINE_ASPECT_RATIO * Width)
+    Result.Type = enuDocItemType::VerticalLine;
+  else if (Height < MAX_LINE_THICKNESS &&
+           Width > MIN_LINE_ASPECT_RATIO * Height)
+    Result.Type = enuDocItemType::HorizontalLine;
+  else if (CanBeRectangle && NumberOfLegs == 4)
+    Result.Type = enuDocItemType::SolidRectangle;
+  return Result;
 }
 
-DocItemPtrVector_t clsPdfiumWrapper::getPageItems(size_t _pageIndex)
+/**
+ * Calls `_visit` on each subpath of `_pathData`, i.e. every run of points
+ * starting at a MOVETO, as a view over the original point array.
+ */
+template <typename Visit_t>
+void forEachSubpath(const CFX_PathData *_pathData, Visit_t _visit) {
+  auto Points = _pathData->GetPoints();
+  int N = _pathData->GetPointCount();
+  int Start = 0;
+  for (int i = 1; i <= N; ++i)
+    if (i == N || (Points[i].m_Flag & FXPT_TYPE) == FXPT_MOVETO) {
+      _visit(Points + Start, i - Start);
+      Start = i;
+    }
+}
 
-{
-  auto Page = this->getPage(_pageIndex);
+// Maps PDF user space to the layout coordinates (origin at the top left of
+// the page as displayed)
+CFX_Matrix pageSpaceMatrix(CPDF_Page *_page) {
 
-  auto PageBBox = Page->GetPageBBox();
-  auto PdfiumPageMatrix = Page->GetPageMatrix();
+  auto PageBBox = _page->GetPageBBox();
+  auto PdfiumPageMatrix = _page->GetPageMatrix();
 
   int PageRotation = 0;
   if (std::abs(PdfiumPageMatrix.a - 1.0f) > MIN_ITEM_SIZE) {
@@ -361,63 +487,170 @@ DocItemPtrVector_t clsPdfiumWrapper::getPageItems(size_t _pageIndex)
       PageRotation = 270;
   }
 
-  std::vector<std::shared_ptr<CFX_Matrix>> MatrixHierarchy;
-
   switch (PageRotation) {
     case 90:
-      MatrixHierarchy.push_back(std::make_shared<CFX_Matrix>(
-          0.f, 1.f, 1.f, 0.f, -PageBBox.bottom, -PageBBox.left));
-      break;
+      return CFX_Matrix(0.f, 1.f, 1.f, 0.f, -PageBBox.bottom,
+                        -PageBBox.left);
     case 180:
-      MatrixHierarchy.push_back(std::make_shared<CFX_Matrix>(
-          -1.f, 0.f, 0.f, 1.f, PageBBox.right, -PageBBox.bottom));
-      break;
+      return CFX_Matrix(-1.f, 0.f, 0.f, 1.f, PageBBox.right,
+                        -PageBBox.bottom);
     case 270:
-      MatrixHierarchy.push_back(std::make_shared<CFX_Matrix>(
-          0.f, -1.f, -1.f, 0.f, PageBBox.top, PageBBox.right));
-      break;
+      return CFX_Matrix(0.f, -1.f, -1.f, 0.f, PageBBox.top,
+                        PageBBox.right);
     case 0:
     default:
-      MatrixHierarchy.push_back(std::make_shared<CFX_Matrix>(
-          1.f, 0.f, 0.f, -1.f, -PageBBox.left, PageBBox.top));
-      break;
+      return CFX_Matrix(1.f, 0.f, 0.f, -1.f, -PageBBox.left,
+                        PageBBox.top);
+  }
+}
+
+/**
+ * Geometry of the glyphs of a text object as parallel arrays. The boxes are
+ * gathered in text space and transformed to page space in one pass, along
+ * with the vertical position of each glyph's ascent, descent and baseline.
+ */
+struct stuGlyphBatch {
+  std::vector<FX_DWORD> CharCodes;
+  std::vector<float> Left, Bottom, Right, Top;
+  std::vector<float> PosX;
+  std::vector<float> Ascent, Descent, Baseline;
+
+  size_t size() const { return this->CharCodes.size(); }
+
+  void clear() {
+    for (auto Array : {&this->Left, &this->Bottom, &this->Right, &this->Top,
+                       &this->PosX, &this->Ascent, &this->Descent,
+                       &this->Baseline})
+      Array->clear();
+    this->CharCodes.clear();
+  }
+
+  void add(FX_DWORD _charCode, const CFX_FloatRect &_box, float _posX) {
+    this->CharCodes.push_back(_charCode);
+    this->Left.push_back(_box.left + _posX);
+    this->Bottom.push_back(_box.bottom);
+    this->Right.push_back(_box.right + _posX);
+    this->Top.push_back(_box.top);
+    this->PosX.push_back(_posX);
+  }
+
+  //@NOTE: Same arithmetic as CFX_Matrix::TransformRect and TransformPoint (so
+  //       results are identical), but branch free over plain arrays so the
+  //       compiler vectorizes it
+  void transform(const CFX_AffineMatrix &_matrix, float _ascent,
+                 float _descent) {
+    const float A = _matrix.a, B = _matrix.b, C = _matrix.c, D = _matrix.d,
+                E = _matrix.e, F = _matrix.f;
+    size_t Size = this->size();
+    this->Ascent.resize(Size);
+    this->Descent.resize(Size);
+    this->Baseline.resize(Size);
+    float *__restrict LeftPtr = this->Left.data();
+    float *__restrict BottomPtr = this->Bottom.data();
+    float *__restrict RightPtr = this->Right.data();
+    float *__restrict TopPtr = this->Top.data();
+    const float *__restrict PosXPtr = this->PosX.data();
+    float *__restrict AscentPtr = this->Ascent.data();
+    float *__restrict DescentPtr = this->Descent.data();
+    float *__restrict BaselinePtr = this->Baseline.data();
+    for (size_t i = 0; i < Size; ++i) {
+      float X0 = LeftPtr[i], X1 = RightPtr[i];
+      float Y0 = TopPtr[i], Y1 = BottomPtr[i];
+      float LeftTopX = A * X0 + C * Y0 + E, LeftTopY = B * X0 + D * Y0 + F;
+      float LeftBottomX = A * X0 + C * Y1 + E,
+            LeftBottomY = B * X0 + D * Y1 + F;
+      float RightTopX = A * X1 + C * Y0 + E, RightTopY = B * X1 + D * Y0 + F;
+      float RightBottomX = A * X1 + C * Y1 + E,
+            RightBottomY = B * X1 + D * Y1 + F;
+      LeftPtr[i] = std::min(std::min(LeftTopX, LeftBottomX),
+                            std::min(RightTopX, RightBottomX));
+      RightPtr[i] = std::max(std::max(LeftTopX, LeftBottomX),
+                             std::max(RightTopX, RightBottomX));
+      BottomPtr[i] = std::min(std::min(LeftTopY, LeftBottomY),
+                              std::min(RightTopY, RightBottomY));
+      TopPtr[i] = std::max(std::max(LeftTopY, LeftBottomY),
+                           std::max(RightTopY, RightBottomY));
+      float X = PosXPtr[i];
+      AscentPtr[i] = B * X + D * _ascent + F;
+      DescentPtr[i] = B * X + D * _descent + F;
+      BaselinePtr[i] = B * X + D * 0.f + F;
+    }
   }
+};
+
+DocItemPtrVector_t clsPdfiumWrapper::getPageItems(size_t _pageIndex)
+
+{
+  std::lock_guard<std::recursive_mutex> Guard(__pdfiumLock);
+  auto Page = this->getPage(_pageIndex);
+  std::vector<CFX_Matrix> MatrixHierarchy{pageSpaceMatrix(Page.get())};
 
   stuSize PageSize(Page->GetPageWidth(), Page->GetPageHeight());
   CFX_FloatRect PageRect(0, 0, PageSize.Width, PageSize.Height);
   DocItemPtrVector_t Result;
 
-  auto appendFigureObject = [&](CPDF_PageObject *_object) {
-    CFX_Matrix *TransformMatrix = MatrixHierarchy.back().get();
+  auto appendFigureItem = [&](CFX_FloatRect _boundingRect,
+                              enuDocItemType _type,
+                              const CFX_FloatRect *_clipRect) {
+    if (_clipRect != nullptr) _boundingRect.Intersect(*_clipRect);
+    _boundingRect.Intersect(PageRect);
+    stuBoundingBox BBox(_boundingRect.left, _boundingRect.bottom,
+                        _boundingRect.right, _boundingRect.top);
+    Result.push_back(
+        std::make_shared<stuDocItem>(BBox, _type, NAN, NAN, NAN, 0));
+  };
+
+  auto appendFigureObject = [&](CPDF_PageObject *_object,
+                                enuDocItemType _type) {
     CFX_FloatRect BoundingRect(_object->m_Left, _object->m_Bottom,
                                _object->m_Right, _object->m_Top);
 
     if (!_object->m_ClipPath.IsNull())
       BoundingRect.Intersect(_object->m_ClipPath.GetClipBox());
 
-    if (TransformMatrix) TransformMatrix->TransformRect(BoundingRect);
-
-    auto Type = enuDocItemType::Image;
-    if (_object->m_Type == PDFPAGE_PATH) {
-      Type = enuDocItemType::Path;
-      auto PathObject = static_cast<CPDF_PathObject *>(_object);
-      if (isVerticalLine(PathObject, TransformMatrix))
-        Type = enuDocItemType::VerticalLine;
-      else if (isHorizontalLine(PathObject, TransformMatrix))
-        Type = enuDocItemType::HorizontalLine;
-      else if (isSolidRectangle(PathObject, TransformMatrix))
-        Type = enuDocItemType::SolidRectangle;
+    MatrixHierarchy.back().TransformRect(BoundingRect);
+    appendFigureItem(BoundingRect, _type, nullptr);
+  };
+
+  auto appendImageObject = [&](CPDF_ImageObject *_imageObject) {
+    appendFigureObject(_imageObject, enuDocItemType::Image);
+  };
+
+  //@NOTE: Compound paths are split at each MOVETO, so a grid drawn as a single
+  //       path object turns into separate rulers instead of one huge item
+  auto appendPathObject = [&](CPDF_PathObject *_pathObject) {
+    auto PathData = _pathObject->m_Path.GetObject();
+    if (PathData == nullptr || PathData->GetPointCount() == 0)
+      return appendFigureObject(_pathObject, enuDocItemType::Path);
+
+    const CFX_Matrix &TransformMatrix = MatrixHierarchy.back();
+    CFX_Matrix PathMatrix = _pathObject->m_Matrix;
+    PathMatrix.Concat(TransformMatrix);
+    auto GraphState = _pathObject->m_GraphState.GetObject();
+    float HalfLineWidth =
+        _pathObject->m_bStroke && GraphState != nullptr
+            ? GraphState->m_LineWidth / 2 *
+                  std::sqrt(std::abs(PathMatrix.a * PathMatrix.d -
+                                     PathMatrix.b * PathMatrix.c))
+            : 0.f;
+
+    CFX_FloatRect ClipRect;
+    bool HasClipRect = !_pathObject->m_ClipPath.IsNull();
+    if (HasClipRect) {
+      ClipRect = _pathObject->m_ClipPath.GetClipBox();
+      TransformMatrix.TransformRect(ClipRect);
     }
 
-    BoundingRect.Intersect(PageRect);
-    stuBoundingBox BBox(BoundingRect.left, BoundingRect.bottom,
-                        BoundingRect.right, BoundingRect.top);
-    Result.push_back(
-        std::make_shared<stuDocItem>(BBox, Type, NAN, NAN, NAN, 0));
+    forEachSubpath(PathData, [&](const FX_PATHPOINT *_points, int _count) {
+      if (_count < 2) return;
+      auto Shape = classifyPath(_points, _count, PathMatrix, HalfLineWidth);
+      appendFigureItem(Shape.BoundingRect, Shape.Type,
+                       HasClipRect ? &ClipRect : nullptr);
+    });
   };
 
+  stuGlyphBatch Glyphs;
   auto appendTextObject = [&](CPDF_TextObject *_textObject) {
-    CFX_Matrix *TransformMatrix = MatrixHierarchy.back().get();
     CFX_FloatRect WholeTextBoundRect(_textObject->m_Left, _textObject->m_Bottom,
                                      _textObject->m_Right, _textObject->m_Top);
 
@@ -450,7 +683,7 @@ DocItemPtrVector_t clsPdfiumWrapper::getPageItems(size_t _pageIndex)
 
     CFX_AffineMatrix AffineMatrix;
     _textObject->GetTextMatrix(&AffineMatrix);
-    if (TransformMatrix != nullptr) AffineMatrix.Concat(*TransformMatrix);
+    AffineMatrix.Concat(MatrixHierarchy.back());
 
     float Angle = atan2(AffineMatrix.GetB(), AffineMatrix.GetA());
     auto Font = this->getFont(_textObject->GetFont());
@@ -496,47 +729,36 @@ DocItemPtrVector_t clsPdfiumWrapper::getPageItems(size_t _pageIndex)
       --maxIndex;
     }
 
+    Glyphs.clear();
     for (int i = minIndex; i < maxIndex; ++i) {
-      FX_DWORD CharCode = CharCodes[i];
-      if (CharCode == static_cast<FX_DWORD>(-1)) continue;
-
-      CFX_FloatRect BoundingRect, AdvanceRect;
-
-      std::tie(BoundingRect, AdvanceRect) =
-          Font->getGlyphBoxInfoForCode(CharCode, FontSize);
-      BoundingRect.left += i == 0 ? 0 : CharPoses[i - 1];
-      BoundingRect.right += i == 0 ? 0 : CharPoses[i - 1];
-      AdvanceRect.left += i == 0 ? 0 : CharPoses[i - 1];
-      AdvanceRect.right += i == 0 ? 0 : CharPoses[i - 1];
+      if (CharCodes[i] == static_cast<FX_DWORD>(-1)) continue;
+      Glyphs.add(CharCodes[i],
+                 std::get<0>(Font->getGlyphBoxInfoForCode(CharCodes[i],
+                                                          FontSize)),
+                 i == 0 ? 0 : CharPoses[i - 1]);
+    }
+    Glyphs.transform(AffineMatrix, BaseAscent, BaseDescent);
 
-      AffineMatrix.TransformRect(BoundingRect);
-      AffineMatrix.TransformRect(AdvanceRect);
+    for (size_t i = 0; i < Glyphs.size(); ++i) {
+      CFX_FloatRect BoundingRect(Glyphs.Left[i], Glyphs.Bottom[i],
+                                 Glyphs.Right[i], Glyphs.Top[i]);
 
       if (BoundingRect.left >= PageSize.Width - MIN_ITEM_SIZE) continue;
       if (BoundingRect.bottom >= PageSize.Height - MIN_ITEM_SIZE) continue;
       if (BoundingRect.right < MIN_ITEM_SIZE) continue;
       if (BoundingRect.top < MIN_ITEM_SIZE) continue;
 
-      float PosX;
-      float Ascent = BaseAscent, Descent = BaseDescent, Baseline = 0;
-
-      PosX = i == 0 ? 0 : CharPoses[i - 1];
-      AffineMatrix.TransformPoint(PosX, Ascent);
-      PosX = i == 0 ? 0 : CharPoses[i - 1];
-      AffineMatrix.TransformPoint(PosX, Descent);
-      PosX = i == 0 ? 0 : CharPoses[i - 1];
-      AffineMatrix.TransformPoint(PosX, Baseline);
+      float Ascent = Glyphs.Ascent[i], Descent = Glyphs.Descent[i],
+            Baseline = Glyphs.Baseline[i];
 
-      auto Unicode = Font->getUnicodeFromCharCode(CharCode);
+      auto Unicode = Font->getUnicodeFromCharCode(Glyphs.CharCodes[i]);
       if (Unicode.GetLength() == 0)
-        Unicode.Insert(0, static_cast<wchar_t>(CharCode));
+        Unicode.Insert(0, static_cast<wchar_t>(Glyphs.CharCodes[i]));
 
       BoundingRect.Intersect(PageRect);
 
       float X0 = BoundingRect.left;
       float WidthPerItem = BoundingRect.Width() / Unicode.GetLength();
-      float O0 = AdvanceRect.left;
-      float AdvancePerItem = AdvanceRect.Width() / Unicode.GetLength();
 
       for (int j = 0; j < Unicode.GetLength(); ++j) {
         if (allowedToHaveZeroSize(Unicode.GetAt(j)) ||
@@ -558,13 +780,174 @@ DocItemPtrVector_t clsPdfiumWrapper::getPageItems(size_t _pageIndex)
       nullptr, Page.get(),
       [&](CPDF_FormObject *_formObject, CPDF_PageObjects *_pageObjects) {
         if (_formObject == nullptr) return;
-        auto NewMatrix =
-            std::make_shared<CFX_Matrix>(_formObject->m_FormMatrix);
-        NewMatrix->Concat(*MatrixHierarchy.back());
+        CFX_Matrix NewMatrix = _formObject->m_FormMatrix;
+        NewMatrix.Concat(MatrixHierarchy.back());
+        MatrixHierarchy.push_back(NewMatrix);
+      },
+      [&]() { MatrixHierarchy.pop_back(); }, appendImageObject,
+      appendPathObject, appendTextObject);
+
+  return Result;
+}
+
+// Name of the object, or of the first element of arrays (as in color spaces)
+std::string nameOf(CPDF_Object *_object) {
+  if (_object != nullptr && _object->GetType() == PDFOBJ_ARRAY)
+    _object = static_cast<CPDF_Array *>(_object)->GetElementValue(0);
+  if (_object == nullptr || _object->GetType() != PDFOBJ_NAME)
+    return std::string();
+  auto Name = _object->GetString();
+  return std::string(Name.c_str(), Name.GetLength());
+}
+
+std::map<std::string, int32_t> decodeParamsOf(CPDF_Object *_object) {
+  std::map<std::string, int32_t> Result;
+  if (_object == nullptr || _object->GetType() != PDFOBJ_DICTIONARY)
+    return Result;
+  auto Dictionary = static_cast<CPDF_Dictionary *>(_object);
+  FX_POSITION Position = Dictionary->GetStartPos();
+  while (Position) {
+    CFX_ByteString Key;
+    auto Value = Dictionary->GetNextElement(Position, Key);
+    if (Value != nullptr) Value = Value->GetDirect();
+    if (Value == nullptr) continue;
+    if (Value->GetType() == PDFOBJ_NUMBER || Value->GetType() == PDFOBJ_BOOLEAN)
+      Result[std::string(Key.c_str(), Key.GetLength())] = Value->GetInteger();
+  }
+  return Result;
+}
+
+std::vector<uint8_t> streamBytes(CPDF_Stream *_stream, bool _raw) {
+  CPDF_StreamAcc StreamData;
+  StreamData.LoadAllData(_stream, _raw ? TRUE : FALSE);
+  return std::vector<uint8_t>(StreamData.GetData(),
+                              StreamData.GetData() + StreamData.GetSize());
+}
+
+CPDF_Stream *streamOf(CPDF_Object *_object) {
+  if (_object != nullptr) _object = _object->GetDirect();
+  if (_object == nullptr || _object->GetType() != PDFOBJ_STREAM)
+    return nullptr;
+  return static_cast<CPDF_Stream *>(_object);
+}
+
+// Fills the fields of the image which come from its stream
+void readImageStream(CPDF_Stream *_stream, stuEmbeddedImage &_image,
+                     bool _withMasks) {
+  auto Dictionary = _stream->GetDict();
+  _image.BitsPerComponent = Dictionary->GetInteger("BitsPerComponent");
+  _image.ColorSpace = nameOf(Dictionary->GetElementValue("ColorSpace"));
+  _image.IsImageMask = Dictionary->GetInteger("ImageMask") != 0;
+
+  auto addFilter = [&](CPDF_Object *_filter, CPDF_Object *_params) {
+    _image.Filters.push_back(nameOf(_filter));
+    _image.DecodeParams.push_back(decodeParamsOf(_params));
+    //@NOTE: The globals are a stream, so they are not among the params
+    if (_image.Filters.back() == "JBIG2Decode" && _params != nullptr &&
+        _params->GetType() == PDFOBJ_DICTIONARY)
+      if (auto Globals = streamOf(static_cast<CPDF_Dictionary *>(_params)
+                                      ->GetElementValue("JBIG2Globals")))
+        _image.JBIG2Globals = streamBytes(Globals, false);
+  };
+  auto Filter = Dictionary->GetElementValue("Filter");
+  auto DecodeParams = Dictionary->GetElementValue("DecodeParms");
+  if (Filter != nullptr && Filter->GetType() == PDFOBJ_ARRAY) {
+    auto Filters = static_cast<CPDF_Array *>(Filter);
+    auto Params =
+        DecodeParams != nullptr && DecodeParams->GetType() == PDFOBJ_ARRAY
+            ? static_cast<CPDF_Array *>(DecodeParams)
+            : nullptr;
+    for (FX_DWORD i = 0; i < Filters->GetCount(); ++i)
+      addFilter(Filters->GetElementValue(i),
+                Params != nullptr && i < Params->GetCount()
+                    ? Params->GetElementValue(i)
+                    : nullptr);
+  } else if (Filter != nullptr) {
+    addFilter(Filter, DecodeParams);
+  }
+
+  if (auto Decode = Dictionary->GetArray("Decode"))
+    for (FX_DWORD i = 0; i < Decode->GetCount(); ++i)
+      if (auto Value = Decode->GetElementValue(i))
+        _image.Decode.push_back(Value->GetNumber());
+
+  _image.Data = streamBytes(_stream, true);
+  //@NOTE: Masks can not be masked themselves, which also stops reference loops
+  if (_withMasks == false) return;
+  auto readMask = [&](CPDF_Stream *_maskStream) {
+    auto Mask = std::make_shared<stuEmbeddedImage>();
+    Mask->Placement = _image.Placement;
+    Mask->BoundingBox = _image.BoundingBox;
+    Mask->Width = _maskStream->GetDict()->GetInteger("Width");
+    Mask->Height = _maskStream->GetDict()->GetInteger("Height");
+    readImageStream(_maskStream, *Mask, false);
+    return Mask;
+  };
+  auto SoftMask = streamOf(Dictionary->GetElementValue("SMask"));
+  if (SoftMask != nullptr && SoftMask->GetDict() != nullptr)
+    _image.SoftMask = readMask(SoftMask);
+  auto Mask = Dictionary->GetElementValue("Mask");
+  if (auto MaskStream = streamOf(Mask)) {
+    if (MaskStream->GetDict() != nullptr) _image.Mask = readMask(MaskStream);
+  } else if (Mask != nullptr && Mask->GetDirect() != nullptr &&
+             Mask->GetDirect()->GetType() == PDFOBJ_ARRAY) {
+    auto Ranges = static_cast<CPDF_Array *>(Mask->GetDirect());
+    for (FX_DWORD i = 0; i < Ranges->GetCount(); ++i)
+      if (auto Value = Ranges->GetElementValue(i))
+        _image.ColorKeyMask.push_back(Value->GetInteger());
+  }
+}
+
+std::vector<stuEmbeddedImage> clsPdfiumWrapper::getPageImages(
+    size_t _pageIndex, const stuBoundingBox &_region)
+
+{
+  std::lock_guard<std::recursive_mutex> Guard(__pdfiumLock);
+  auto Page = this->getPage(_pageIndex);
+  std::vector<CFX_Matrix> MatrixHierarchy{pageSpaceMatrix(Page.get())};
+
+  CFX_FloatRect PageRect(0, 0, Page->GetPageWidth(), Page->GetPageHeight());
+  std::vector<stuEmbeddedImage> Result;
+
+  auto appendImageObject = [&](CPDF_ImageObject *_imageObject) {
+    auto Stream = _imageObject->m_pImage != nullptr
+                      ? _imageObject->m_pImage->GetStream()
+                      : nullptr;
+    if (Stream == nullptr || Stream->GetDict() == nullptr) return;
+
+    CFX_FloatRect BoundingRect(_imageObject->m_Left, _imageObject->m_Bottom,
+                               _imageObject->m_Right, _imageObject->m_Top);
+    if (!_imageObject->m_ClipPath.IsNull())
+      BoundingRect.Intersect(_imageObject->m_ClipPath.GetClipBox());
+    MatrixHierarchy.back().TransformRect(BoundingRect);
+    BoundingRect.Intersect(PageRect);
+    stuBoundingBox BBox(BoundingRect.left, BoundingRect.bottom,
+                        BoundingRect.right, BoundingRect.top);
+    //@NOTE: Checked before reading the stream, which may be large
+    if (BBox.hasIntersectionWith(_region) == false) return;
+
+    stuEmbeddedImage Image;
+    CFX_Matrix Placement = _imageObject->m_Matrix;
+    Placement.Concat(MatrixHierarchy.back());
+    Image.Placement = {Placement.a, Placement.b, Placement.c,
+                       Placement.d, Placement.e, Placement.f};
+    Image.BoundingBox = BBox;
+    Image.Width = _imageObject->m_pImage->GetPixelWidth();
+    Image.Height = _imageObject->m_pImage->GetPixelHeight();
+    readImageStream(Stream, Image, true);
+    Result.push_back(std::move(Image));
+  };
+
+  traverseObjects(
+      nullptr, Page.get(),
+      [&](CPDF_FormObject *_formObject, CPDF_PageObjects *_pageObjects) {
+        if (_formObject == nullptr) return;
+        CFX_Matrix NewMatrix = _formObject->m_FormMatrix;
+        NewMatrix.Concat(MatrixHierarchy.back());
         MatrixHierarchy.push_back(NewMatrix);
       },
-      [&]() { MatrixHierarchy.pop_back(); }, appendFigureObject,
-      appendFigureObject, appendTextObject);
+      [&]() { MatrixHierarchy.pop_back(); }, appendImageObject,
+      [](CPDF_PathObject *) {}, [](CPDF_TextObject *) {});
 
   return Result;
 }
@@ -573,6 +956,7 @@ std::vector<uint8_t> clsPdfiumWrapper::renderPageImage(
     size_t _pageIndex, uint32_t _backgroundColor, const stuSize &_renderSize)
 
 {
+  std::lock_guard<std::recursive_mutex> Guard(__pdfiumLock);
   std::vector<uint8_t> Buffer;
   auto Page = this->getPage(_pageIndex);
 
@@ -5,6 +5,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 // Ignore PDFium warnings to stay vigilant about our own codes warnings
@@ -20,6 +21,7 @@
 #pragma GCC diagnostic pop
 
 #include "dla.h"
+#include "pdfla.h"
 
 namespace Targoman {
 namespace PDFLA {
@@ -45,24 +47,42 @@ class clsPdfFont {
   std::string familyName() const;
 };
 
+/**
+ * The PDFium state of a document. Calls into PDFium are serialized across all
+ * documents of the process, so only the layout analysis of the returned items
+ * runs concurrently.
+ */
 class clsPdfiumWrapper {
  private:
   std::shared_ptr<CPDF_Parser> Parser;
   std::map<size_t, std::shared_ptr<CPDF_Page>> LoadedPages;
   std::map<CPDF_Font *, std::shared_ptr<clsPdfFont>> LoadedFonts;
+  std::unordered_map<FX_DWORD, uint64_t> ObjectHashes;
+  bool IsLoaded;
 
   std::shared_ptr<CPDF_Page> getPage(size_t _pageIndex);
   std::shared_ptr<clsPdfFont> getFont(CPDF_Font *_rawPdfFont);
+  uint64_t hashObject(CPDF_Object *_object);
+  uint64_t hashDictionary(CPDF_Dictionary *_dictionary,
+                          bool _isStreamDictionary);
 
  public:
   clsPdfiumWrapper(uint8_t *_data, size_t _size);
+  ~clsPdfiumWrapper();
 
+  // False when the data could not be parsed as a PDF, leaving no pages
+  bool isLoaded() const { return this->IsLoaded; }
   size_t pageCount() const;
   Targoman::DLA::stuSize getPageSize(size_t _pageIndex);
+  // Hash of the page's decoded content streams, resources and geometry, which
+  // does not depend on how (or in which file) the page was written
+  uint64_t getPageContentHash(size_t _pageIndex);
   void populatePageObjects(CPDF_PageObjects *_source,
                            CPDF_PageObjects *_target);
   CPDF_PageObjects getPdfPageObjects(size_t _pageIndex);
   Targoman::DLA::DocItemPtrVector_t getPageItems(size_t _pageIndex);
+  std::vector<stuEmbeddedImage> getPageImages(
+      size_t _pageIndex, const Targoman::DLA::stuBoundingBox &_region);
   std::vector<uint8_t> renderPageImage(
       size_t _pageIndex, uint32_t _backgroundColor,
       const Targoman::DLA::stuSize &_renderSize);
@@ -0,0 +1,71 @@
+#include "clsSharedRingBuffer.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace Targoman {
+namespace PDFLA {
+
+clsSharedRingBuffer::clsSharedRingBuffer(size_t _capacity)
+    : Header(nullptr), Data(nullptr), Capacity(1), MappedSize(0) {
+  while (this->Capacity < _capacity) this->Capacity <<= 1;
+  this->MappedSize = sizeof(stuHeader) + this->Capacity;
+
+  void *Memory = mmap(nullptr, this->MappedSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (Memory == MAP_FAILED) {
+    this->MappedSize = 0;
+    return;
+  }
+  this->Header = new (Memory) stuHeader;
+  this->Data = static_cast<uint8_t *>(Memory) + sizeof(stuHeader);
+  this->reset();
+}
+
+clsSharedRingBuffer::~clsSharedRingBuffer() {
+  if (this->Header == nullptr) return;
+  this->Header->~stuHeader();
+  munmap(this->Header, this->MappedSize);
+}
+
+void clsSharedRingBuffer::reset() {
+  this->Header->Head.store(0, std::memory_order_relaxed);
+  this->Header->Tail.store(0, std::memory_order_release);
+}
+
+size_t clsSharedRingBuffer::write(const uint8_t *_data, size_t _size) {
+  auto Head = this->Header->Head.load(std::memory_order_relaxed);
+  auto Tail = this->Header->Tail.load(std::memory_order_acquire);
+  size_t Size =
+      std::min(_size, this->Capacity - static_cast<size_t>(Head - Tail));
+  size_t Offset = static_cast<size_t>(Head) & (this->Capacity - 1);
+  size_t FirstPart = std::min(Size, this->Capacity - Offset);
+  std::memcpy(this->Data + Offset, _data, FirstPart);
+  std::memcpy(this->Data, _data + FirstPart, Size - FirstPart);
+  this->Header->Head.store(Head + Size, std::memory_order_release);
+  return Size;
+}
+
+size_t clsSharedRingBuffer::read(uint8_t *_data, size_t _size) {
+  auto Tail = this->Header->Tail.load(std::memory_order_relaxed);
+  auto Head = this->Header->Head.load(std::memory_order_acquire);
+  size_t Size = std::min(_size, static_cast<size_t>(Head - Tail));
+  size_t Offset = static_cast<size_t>(Tail) & (this->Capacity - 1);
+  size_t FirstPart = std::min(Size, this->Capacity - Offset);
+  std::memcpy(_data, this->Data + Offset, FirstPart);
+  std::memcpy(_data + FirstPart, this->Data, Size - FirstPart);
+  this->Header->Tail.store(Tail + Size, std::memory_order_release);
+  return Size;
+}
+
+size_t clsSharedRingBuffer::readable() const {
+  return static_cast<size_t>(
+      this->Header->Head.load(std::memory_order_acquire) -
+      this->Header->Tail.load(std::memory_order_relaxed));
+}
+
+}  // namespace PDFLA
+}  // namespace Targoman
@@ -0,0 +1,56 @@
+#ifndef __TARGOMAN_PDFLA_CLSSHAREDRINGBUFFER__
+#define __TARGOMAN_PDFLA_CLSSHAREDRINGBUFFER__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Targoman {
+namespace PDFLA {
+
+/**
+ * Single producer, single consumer byte ring in anonymous shared memory. The
+ * mapping is inherited by forked children, so a child process can stream its
+ * results to the parent without copying them through a pipe. Writes and reads
+ * are partial: they move as many bytes as currently fit or are available.
+ */
+class clsSharedRingBuffer {
+ private:
+  struct stuHeader {
+    // Total number of bytes ever written and read, so the ring is empty when
+    // they are equal and the offsets never need to wrap separately
+    alignas(64) std::atomic<uint64_t> Head;
+    alignas(64) std::atomic<uint64_t> Tail;
+  };
+  static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+                "Atomics shared between processes must be lock free");
+
+  stuHeader *Header;
+  uint8_t *Data;
+  size_t Capacity;
+  size_t MappedSize;
+
+ public:
+  // The capacity is rounded up to a power of two
+  explicit clsSharedRingBuffer(size_t _capacity);
+  ~clsSharedRingBuffer();
+  clsSharedRingBuffer(const clsSharedRingBuffer &) = delete;
+  clsSharedRingBuffer &operator=(const clsSharedRingBuffer &) = delete;
+
+  bool isValid() const { return this->Header != nullptr; }
+  size_t capacity() const { return this->Capacity; }
+
+  // Only allowed while no producer or consumer is active, e.g. after the
+  // producing process has died
+  void reset();
+
+  size_t write(const uint8_t *_data, size_t _size);
+  size_t read(uint8_t *_data, size_t _size);
+  // Bytes a read would return now, to be called by the consumer only
+  size_t readable() const;
+};
+
+}  // namespace PDFLA
+}  // namespace Targoman
+
+#endif  // __TARGOMAN_PDFLA_CLSSHAREDRINGBUFFER__
@@ -0,0 +1,49 @@
+#include "clsStrand.h"
+
+namespace Targoman {
+namespace Common {
+
+clsStrand::clsStrand(clsThreadPool &_threadPool)
+    : ThreadPool(_threadPool), IsScheduled(false) {}
+
+clsStrand::~clsStrand() {
+  std::unique_lock<std::mutex> Guard(this->Lock);
+  this->IsIdle.wait(Guard, [this]() { return !this->IsScheduled; });
+}
+
+void clsStrand::post(std::function<void()> _task) {
+  {
+    std::lock_guard<std::mutex> Guard(this->Lock);
+    this->Tasks.push_back(std::move(_task));
+    if (this->IsScheduled) return;
+    this->IsScheduled = true;
+  }
+  this->ThreadPool.post([this]() { this->runNextTask(); });
+}
+
+void clsStrand::runNextTask() {
+  std::function<void()> Task;
+  {
+    std::lock_guard<std::mutex> Guard(this->Lock);
+    Task = std::move(this->Tasks.front());
+    this->Tasks.pop_front();
+  }
+  //@NOTE: An exception escaping a pool thread terminates the process, and
+  //       one caught past this point would leave the strand scheduled for
+  //       good. Submitted tasks keep theirs in the future, posted ones lose it.
+  try {
+    Task();
+  } catch (...) {
+  }
+
+  std::lock_guard<std::mutex> Guard(this->Lock);
+  if (this->Tasks.empty()) {
+    this->IsScheduled = false;
+    this->IsIdle.notify_all();
+    return;
+  }
+  this->ThreadPool.post([this]() { this->runNextTask(); });
+}
+
+}  // namespace Common
+}  // namespace Targoman
@@ -0,0 +1,48 @@
+#ifndef __TARGOMAN_COMMON_CLSSTRAND__
+#define __TARGOMAN_COMMON_CLSSTRAND__
+
+#include "clsThreadPool.h"
+
+namespace Targoman {
+namespace Common {
+
+/**
+ * Runs the posted tasks one at a time and in order on a shared thread pool,
+ * without holding a pool thread between them. Each task is posted to the pool
+ * on its own, so the strands sharing a pool take turns fairly.
+ */
+class clsStrand {
+ private:
+  clsThreadPool &ThreadPool;
+  std::deque<std::function<void()>> Tasks;
+  std::mutex Lock;
+  std::condition_variable IsIdle;
+  bool IsScheduled;
+
+ private:
+  void runNextTask();
+
+ public:
+  explicit clsStrand(clsThreadPool &_threadPool);
+  // Waits for the queued tasks, so they may use the owner of the strand
+  ~clsStrand();
+
+  // Exceptions thrown by the task are discarded and the strand moves on to
+  // the next one. Use submit() to get them.
+  void post(std::function<void()> _task);
+
+  template <typename Functor_t>
+  auto submit(Functor_t _functor) -> std::future<decltype(_functor())> {
+    typedef decltype(_functor()) Result_t;
+    auto Task =
+        std::make_shared<std::packaged_task<Result_t()>>(std::move(_functor));
+    auto Future = Task->get_future();
+    this->post([Task]() { (*Task)(); });
+    return Future;
+  }
+};
+
+}  // namespace Common
+}  // namespace Targoman
+
+#endif  // __TARGOMAN_COMMON_CLSSTRAND__
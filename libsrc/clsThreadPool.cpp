@@ -0,0 +1,64 @@
+#include "clsThreadPool.h"
+
+#include <algorithm>
+
+namespace Targoman {
+namespace Common {
+
+clsThreadPool::clsThreadPool(size_t _numberOfThreads) : IsStopping(false) {
+  if (_numberOfThreads == 0)
+    _numberOfThreads =
+        std::max(static_cast<size_t>(std::thread::hardware_concurrency()),
+                 static_cast<size_t>(1));
+  this->Workers.reserve(_numberOfThreads);
+  for (size_t i = 0; i < _numberOfThreads; ++i)
+    this->Workers.emplace_back(&clsThreadPool::workerLoop, this);
+}
+
+clsThreadPool::~clsThreadPool() {
+  {
+    std::lock_guard<std::mutex> Guard(this->Lock);
+    this->IsStopping = true;
+  }
+  this->TaskIsAvailable.notify_all();
+  for (auto &Worker : this->Workers) Worker.join();
+}
+
+void clsThreadPool::post(std::function<void()> _task) {
+  {
+    std::lock_guard<std::mutex> Guard(this->Lock);
+    this->Tasks.push_back(std::move(_task));
+  }
+  this->TaskIsAvailable.notify_one();
+}
+
+bool clsThreadPool::runPendingTask() {
+  std::function<void()> Task;
+  {
+    std::lock_guard<std::mutex> Guard(this->Lock);
+    if (this->Tasks.empty()) return false;
+    Task = std::move(this->Tasks.front());
+    this->Tasks.pop_front();
+  }
+  Task();
+  return true;
+}
+
+void clsThreadPool::workerLoop() {
+  while (true) {
+    std::function<void()> Task;
+    {
+      std::unique_lock<std::mutex> Guard(this->Lock);
+      this->TaskIsAvailable.wait(Guard, [this]() {
+        return this->IsStopping || !this->Tasks.empty();
+      });
+      if (this->Tasks.empty()) return;
+      Task = std::move(this->Tasks.front());
+      this->Tasks.pop_front();
+    }
+    Task();
+  }
+}
+
+}  // namespace Common
+}  // namespace Targoman
@@ -0,0 +1,62 @@
+#ifndef __TARGOMAN_COMMON_CLSTHREADPOOL__
+#define __TARGOMAN_COMMON_CLSTHREADPOOL__
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Targoman {
+namespace Common {
+
+class clsThreadPool {
+ private:
+  std::vector<std::thread> Workers;
+  std::deque<std::function<void()>> Tasks;
+  std::mutex Lock;
+  std::condition_variable TaskIsAvailable;
+  bool IsStopping;
+
+ private:
+  void workerLoop();
+
+ public:
+  // Zero threads means one per hardware thread
+  explicit clsThreadPool(size_t _numberOfThreads = 0);
+  ~clsThreadPool();
+
+  size_t size() const { return this->Workers.size(); }
+
+  void post(std::function<void()> _task);
+  bool runPendingTask();
+
+  template <typename Functor_t>
+  auto submit(Functor_t _functor) -> std::future<decltype(_functor())> {
+    typedef decltype(_functor()) Result_t;
+    auto Task =
+        std::make_shared<std::packaged_task<Result_t()>>(std::move(_functor));
+    auto Future = Task->get_future();
+    this->post([Task]() { (*Task)(); });
+    return Future;
+  }
+
+  //@NOTE: Waiting threads run queued tasks meanwhile, so tasks may safely wait
+  //       for the sub-tasks they submit to the same pool
+  template <typename T>
+  T wait(std::future<T> &_future) {
+    while (_future.wait_for(std::chrono::seconds(0)) !=
+           std::future_status::ready)
+      if (!this->runPendingTask())
+        _future.wait_for(std::chrono::milliseconds(1));
+    return _future.get();
+  }
+};
+
+}  // namespace Common
+}  // namespace Targoman
+
+#endif  // __TARGOMAN_COMMON_CLSTHREADPOOL__
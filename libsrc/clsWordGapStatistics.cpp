@@ -0,0 +1,104 @@
+#include "clsWordGapStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "algorithm.hpp"
+
+namespace Targoman {
+namespace PDFLA {
+
+using namespace Targoman::DLA;
+using namespace Targoman::Common;
+
+constexpr size_t MAX_FONT_SIZE_BUCKET = 96;
+constexpr int32_t MAX_WORD_GAP = 64;
+constexpr int32_t MIN_ACKNOWLEDGABLE_DISTANCE = 3;
+constexpr int32_t MIN_SAMPLES_PER_FONT_SIZE = 32;
+
+clsWordGapStatistics::clsWordGapStatistics(float _thresholdMultiplier)
+    : GapHistograms(MAX_FONT_SIZE_BUCKET + 1),
+      NumberOfSamples(MAX_FONT_SIZE_BUCKET + 1, 0),
+      WordSeparationThresholds(MAX_FONT_SIZE_BUCKET + 1, 0.f),
+      ThresholdMultiplier(_thresholdMultiplier),
+      PerFontSize(true),
+      MaxGap(MAX_WORD_GAP) {}
+
+clsWordGapStatistics::clsWordGapStatistics(float _thresholdMultiplier,
+                                           float _pageWidth)
+    : GapHistograms(1),
+      NumberOfSamples(1, 0),
+      WordSeparationThresholds(MAX_FONT_SIZE_BUCKET + 1, 0.f),
+      ThresholdMultiplier(_thresholdMultiplier),
+      PerFontSize(false),
+      MaxGap(std::max(static_cast<int32_t>(std::ceil(_pageWidth)) - 1,
+                      MIN_ACKNOWLEDGABLE_DISTANCE)) {}
+
+size_t clsWordGapStatistics::fontSizeBucket(const DocItemPtr_t &_item) {
+  float FontSize = _item->Descent - _item->Ascent;
+  if (!(FontSize > MIN_ITEM_SIZE)) FontSize = _item->BoundingBox.height();
+  return std::min(MAX_FONT_SIZE_BUCKET,
+                  static_cast<size_t>(std::max(0.f, FontSize) + 0.5f));
+}
+
+void clsWordGapStatistics::addGaps(const DocItemPtrVector_t &_chars) {
+  for (size_t i = 1; i < _chars.size(); ++i) {
+    const auto &ThisItem = _chars.at(i);
+    const auto &PrevItem = _chars.at(i - 1);
+    if (ThisItem->BoundingBox.verticalOverlap(PrevItem->BoundingBox) <=
+        MIN_ITEM_SIZE)
+      continue;
+    auto dx = static_cast<int32_t>(ThisItem->BoundingBox.left() -
+                                   PrevItem->BoundingBox.right() + 0.5);
+    if (dx < MIN_ACKNOWLEDGABLE_DISTANCE || dx > this->MaxGap) continue;
+
+    auto Bucket = this->PerFontSize ? fontSizeBucket(ThisItem) : 0;
+    auto &Histogram = this->GapHistograms[Bucket];
+    if (Histogram.empty())
+      Histogram.resize(static_cast<size_t>(this->MaxGap) + 1, 0);
+    ++Histogram[dx];
+    if (dx > 1) ++Histogram[dx - 1];
+    if (dx < this->MaxGap) ++Histogram[dx + 1];
+    ++this->NumberOfSamples[Bucket];
+  }
+}
+
+void clsWordGapStatistics::finalize() {
+  auto Identity = [](int32_t a) { return a; };
+  if (this->PerFontSize == false) {
+    const auto &Histogram = this->GapHistograms.front();
+    std::fill(this->WordSeparationThresholds.begin(),
+              this->WordSeparationThresholds.end(),
+              Histogram.empty()
+                  ? 0.f
+                  : this->ThresholdMultiplier * argmax(Histogram, Identity));
+    return;
+  }
+
+  std::vector<int32_t> OverallHistogram(MAX_WORD_GAP + 1, 0);
+  for (const auto &Histogram : this->GapHistograms)
+    for (size_t i = 0; i < Histogram.size(); ++i)
+      OverallHistogram[i] += Histogram[i];
+
+  float DefaultThreshold =
+      this->ThresholdMultiplier * argmax(OverallHistogram, Identity);
+  auto DominantBucket = argmax(this->NumberOfSamples, Identity);
+
+  //@NOTE: Font sizes without enough samples of their own scale the threshold
+  //       of the dominant font size, as word spacing grows with the font
+  for (size_t Bucket = 0; Bucket <= MAX_FONT_SIZE_BUCKET; ++Bucket) {
+    if (this->NumberOfSamples[Bucket] >= MIN_SAMPLES_PER_FONT_SIZE)
+      this->WordSeparationThresholds[Bucket] =
+          this->ThresholdMultiplier *
+          argmax(this->GapHistograms[Bucket], Identity);
+    else if (DominantBucket > 0 && Bucket > 0)
+      this->WordSeparationThresholds[Bucket] =
+          DefaultThreshold * static_cast<float>(Bucket) /
+          static_cast<float>(DominantBucket);
+    else
+      this->WordSeparationThresholds[Bucket] = DefaultThreshold;
+  }
+}
+
+}  // namespace PDFLA
+}  // namespace Targoman
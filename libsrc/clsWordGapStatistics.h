@@ -0,0 +1,52 @@
+#ifndef __TARGOMAN_PDFLA_CLSWORDGAPSTATISTICS__
+#define __TARGOMAN_PDFLA_CLSWORDGAPSTATISTICS__
+
+#include <vector>
+
+#include "dla.h"
+
+namespace Targoman {
+namespace PDFLA {
+
+/**
+ * Histograms of the horizontal gaps between neighbouring chars, kept per
+ * (rounded) font size. They can be filled from a single page or from a sample
+ * of the document's pages. After `finalize()` the word separation threshold
+ * of every font size is a table lookup.
+ *
+ * Page statistics instead keep a single histogram of the gaps up to the page
+ * width, so all the chars of the page share its threshold.
+ */
+class clsWordGapStatistics {
+ private:
+  std::vector<std::vector<int32_t>> GapHistograms;
+  std::vector<int32_t> NumberOfSamples;
+  std::vector<float> WordSeparationThresholds;
+  float ThresholdMultiplier;
+  bool PerFontSize;
+  int32_t MaxGap;
+
+ public:
+  // Per font size statistics, thresholds are this multiple of the most common
+  // gap of each font size
+  explicit clsWordGapStatistics(float _thresholdMultiplier);
+  // Statistics of a single page of the given width
+  clsWordGapStatistics(float _thresholdMultiplier, float _pageWidth);
+
+  static size_t fontSizeBucket(const Targoman::DLA::DocItemPtr_t &_item);
+
+  void addGaps(const Targoman::DLA::DocItemPtrVector_t &_chars);
+  void finalize();
+
+  float thresholdMultiplier() const { return this->ThresholdMultiplier; }
+
+  float wordSeparationThreshold(
+      const Targoman::DLA::DocItemPtr_t &_item) const {
+    return this->WordSeparationThresholds[fontSizeBucket(_item)];
+  }
+};
+
+}  // namespace PDFLA
+}  // namespace Targoman
+
+#endif  // __TARGOMAN_PDFLA_CLSWORDGAPSTATISTICS__
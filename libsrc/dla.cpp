@@ -2,6 +2,8 @@
 
 #include <assert.h>
 
+#include <algorithm>
+#include <cmath>
 #include <set>
 #include <sstream>
 
@@ -11,6 +13,11 @@ namespace DLA {
 constexpr float MAX_RULER_THIN_SIZE = 4.f;
 constexpr float MIN_RULER_THICK_SIZE = 8.f;
 constexpr float MIN_RULER_ASPECT_RATIO = 4.f;
+constexpr float COMPACT_COORDINATE_SCALE = 8.f;
+constexpr float COMPACT_COORDINATE_ORIGIN = -512.f;
+// Stands for the non finite values, e.g. the baselines of figure items
+constexpr uint16_t COMPACT_NON_FINITE = std::numeric_limits<uint16_t>::max();
+constexpr uint16_t MAX_COMPACT_COORDINATE = COMPACT_NON_FINITE - 1;
 
 void stuBoundingBox::unionWith_(const stuBoundingBox &_other) {
   float X0 = std::min(this->left(), _other.left());
@@ -168,5 +175,57 @@ bool stuBoundingBox::contains(const BoundingBoxPtr_t &_other) const {
   return this->contains(*_other);
 }
 
+uint16_t toCompactCoordinate(float _value) {
+  //@NOTE: Casting NaN to an integer is undefined, so it never gets there
+  if (!std::isfinite(_value)) return COMPACT_NON_FINITE;
+  float Value = std::round((_value - COMPACT_COORDINATE_ORIGIN) *
+                           COMPACT_COORDINATE_SCALE);
+  return static_cast<uint16_t>(std::min(
+      std::max(Value, 0.f), static_cast<float>(MAX_COMPACT_COORDINATE)));
+}
+
+float fromCompactCoordinate(uint16_t _value) {
+  if (_value == COMPACT_NON_FINITE) return NAN;
+  return _value / COMPACT_COORDINATE_SCALE + COMPACT_COORDINATE_ORIGIN;
+}
+
+stuCompactDocItem stuCompactDocItem::fromDocItem(const stuDocItem &_item) {
+  stuCompactDocItem Result;
+  //@NOTE: Items are never allowed to collapse, as empty items are dropped,
+  //       and their far edges never reach the non finite value
+  Result.Left = std::min(toCompactCoordinate(_item.BoundingBox.left()),
+                         static_cast<uint16_t>(MAX_COMPACT_COORDINATE - 1));
+  Result.Top = std::min(toCompactCoordinate(_item.BoundingBox.top()),
+                        static_cast<uint16_t>(MAX_COMPACT_COORDINATE - 1));
+  Result.Right = std::max(toCompactCoordinate(_item.BoundingBox.right()),
+                          static_cast<uint16_t>(Result.Left + 1));
+  Result.Bottom = std::max(toCompactCoordinate(_item.BoundingBox.bottom()),
+                           static_cast<uint16_t>(Result.Top + 1));
+  Result.Baseline = toCompactCoordinate(_item.Baseline);
+  Result.Ascent = toCompactCoordinate(_item.Ascent);
+  Result.Descent = toCompactCoordinate(_item.Descent);
+  Result.Type = static_cast<uint8_t>(_item.Type);
+  Result.RepetitionPageOffset = static_cast<int8_t>(std::min(
+      std::max(_item.RepetitionPageOffset,
+               static_cast<int32_t>(std::numeric_limits<int8_t>::min())),
+      static_cast<int32_t>(std::numeric_limits<int8_t>::max())));
+  Result.Char = static_cast<char32_t>(_item.Char);
+  return Result;
+}
+
+DocItemPtr_t stuCompactDocItem::toDocItem() const {
+  auto Item = std::make_shared<stuDocItem>(
+      stuBoundingBox(fromCompactCoordinate(this->Left),
+                     fromCompactCoordinate(this->Top),
+                     fromCompactCoordinate(this->Right),
+                     fromCompactCoordinate(this->Bottom)),
+      static_cast<enuDocItemType>(this->Type),
+      fromCompactCoordinate(this->Baseline),
+      fromCompactCoordinate(this->Ascent),
+      fromCompactCoordinate(this->Descent), static_cast<wchar_t>(this->Char));
+  Item->RepetitionPageOffset = this->RepetitionPageOffset;
+  return Item;
+}
+
 }  // namespace DLA
 }  // namespace Targoman
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef __TARGOMAN_DLA__
 #define __TARGOMAN_DLA__
 
+#include <cstdint>
 #include <limits>
 #include <memory>
 #include <string>
@@ -146,6 +147,8 @@ enum class enuDocArea {
 struct stuDocItem {
   stuBoundingBox BoundingBox;
   enuDocItemType Type;
+  // Offset to the nearest other page holding the same item at the same place
+  // (negative when that page comes first), zero for non-repeated items
   int32_t RepetitionPageOffset;
   float Baseline, Ascent, Descent;
   wchar_t Char;
@@ -153,6 +156,7 @@ struct stuDocItem {
              float _baseline, float _ascent, float _descent, wchar_t _char)
       : BoundingBox(_boundingBox),
         Type(_type),
+        RepetitionPageOffset(0),
         Baseline(_baseline),
         Ascent(_ascent),
         Descent(_descent),
@@ -161,14 +165,39 @@ struct stuDocItem {
 typedef std::shared_ptr<stuDocItem> DocItemPtr_t;
 typedef std::vector<DocItemPtr_t> DocItemPtrVector_t;
 
+/**
+ * 20 byte value encoding of a page item, used to keep the items of whole
+ * documents in memory. Coordinates are 1/8 pt fixed point from 512 pt above
+ * and left of the page origin, covering pages up to 7680 pt with an error
+ * below 0.07 pt. Non finite values (like the baselines of figure items) are
+ * kept as such. `RepetitionPageOffset` saturates at +-127 pages.
+ */
+struct stuCompactDocItem {
+  uint16_t Left, Top, Right, Bottom;
+  uint16_t Baseline, Ascent, Descent;
+  uint8_t Type;
+  int8_t RepetitionPageOffset;
+  char32_t Char;
+
+  static stuCompactDocItem fromDocItem(const stuDocItem &_item);
+  DocItemPtr_t toDocItem() const;
+};
+static_assert(sizeof(stuCompactDocItem) == 20,
+              "stuCompactDocItem must stay packed");
+typedef std::vector<stuCompactDocItem> CompactDocItemVector_t;
+
 enum class enuDocBlockType { Text, Figure, Table, Formulae };
 
 struct stuDocBlock {
   stuBoundingBox BoundingBox;
   enuDocArea Area;
   enuDocBlockType Type;
+  // Position in the reading order of the page, -1 for the blocks which are
+  // only reachable through other blocks (captions, table cells)
+  int32_t ReadingOrder;
   DocItemPtrVector_t Elements;
-  stuDocBlock(enuDocBlockType _type) : Type(_type) {}
+  stuDocBlock(enuDocBlockType _type)
+      : Area(enuDocArea::Body), Type(_type), ReadingOrder(-1) {}
 };
 
 struct stuDocTextBlock;
@@ -203,7 +232,9 @@ struct stuDocTextBlock : public stuDocBlock {
   DocLinePtrVector_t Lines;
   enuDocTextBlockAssociation Association;
   clsDocBlockPtr AssociatedBlock;
-  stuDocTextBlock() : stuDocBlock(enuDocBlockType::Text) {}
+  stuDocTextBlock()
+      : stuDocBlock(enuDocBlockType::Text),
+        Association(enuDocTextBlockAssociation::None) {}
 };
 
 struct stuDocFigureBlock : public stuDocBlock {
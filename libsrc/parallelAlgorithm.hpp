@@ -0,0 +1,240 @@
+#ifndef __TARGOMAN_COMMON_PARALLELALGORITHMS__
+#define __TARGOMAN_COMMON_PARALLELALGORITHMS__
+
+#include <exception>
+
+#include "algorithm.hpp"
+#include "clsThreadPool.h"
+
+namespace Targoman {
+namespace Common {
+
+constexpr size_t DEFAULT_MIN_PARALLEL_SIZE = 1 << 16;
+constexpr size_t MIN_PARALLEL_CHUNK_SIZE = 1 << 12;
+constexpr size_t CHUNKS_PER_THREAD = 4;
+constexpr size_t REDUCTION_LANES = 8;
+
+/**
+ * Execution policy of the parallel overloads below. Inputs shorter than
+ * `MinParallelSize` take the serial path, longer ones are cut into chunks of
+ * at least `MinChunkSize` items that are reduced on `ThreadPool`. Functors
+ * must be safe to call concurrently. Costly items (e.g. whole pages) are
+ * worth a chunk of their own, with both sizes lowered.
+ */
+struct stuParallelPolicy {
+  clsThreadPool &ThreadPool;
+  size_t MinParallelSize;
+  size_t MinChunkSize;
+
+  stuParallelPolicy(clsThreadPool &_threadPool,
+                    size_t _minParallelSize = DEFAULT_MIN_PARALLEL_SIZE,
+                    size_t _minChunkSize = MIN_PARALLEL_CHUNK_SIZE)
+      : ThreadPool(_threadPool), MinParallelSize(_minParallelSize),
+        MinChunkSize(std::max(_minChunkSize, static_cast<size_t>(1))) {}
+};
+
+namespace Private {
+
+// Returns the results of `_reduceChunk(Begin, End)` over all chunks, in order
+template <typename Functor_t>
+auto reduceChunks(const stuParallelPolicy &_policy, size_t _size,
+                  Functor_t _reduceChunk) {
+  using Result_t = decltype(_reduceChunk(size_t(0), size_t(0)));
+  size_t NumberOfChunks = std::max(
+      std::min(_policy.ThreadPool.size() * CHUNKS_PER_THREAD,
+               _size / _policy.MinChunkSize),
+      static_cast<size_t>(1));
+  size_t ChunkSize = (_size + NumberOfChunks - 1) / NumberOfChunks;
+
+  std::vector<std::future<Result_t>> Futures;
+  std::vector<Result_t> Results;
+  std::exception_ptr Error;
+  try {
+    for (size_t Begin = ChunkSize; Begin < _size; Begin += ChunkSize) {
+      size_t End = std::min(Begin + ChunkSize, _size);
+      Futures.push_back(_policy.ThreadPool.submit(
+          [&_reduceChunk, Begin, End]() { return _reduceChunk(Begin, End); }));
+    }
+    Results.reserve(Futures.size() + 1);
+    Results.push_back(_reduceChunk(0, std::min(ChunkSize, _size)));
+  } catch (...) {
+    Error = std::current_exception();
+  }
+  //@NOTE: The chunks reference the frame of the caller, so all of them are
+  //       waited for before the first error is rethrown
+  for (auto &Future : Futures) {
+    try {
+      Results.push_back(_policy.ThreadPool.wait(Future));
+    } catch (...) {
+      if (!Error) Error = std::current_exception();
+    }
+  }
+  if (Error) std::rethrow_exception(Error);
+  return Results;
+}
+
+//@NOTE: Independent lanes break the loop-carried dependency of a single
+//       accumulator, which lets the compiler vectorize arithmetic functors
+template <typename T1, typename T0, typename Functor_t>
+T1 sumRange(const std::vector<T0> &v, size_t _begin, size_t _end,
+            const Functor_t &f) {
+  T1 Sum = 0;
+  size_t i = _begin;
+  if constexpr (std::is_arithmetic<T1>::value) {
+    T1 Lanes[REDUCTION_LANES] = {};
+    for (; i + REDUCTION_LANES <= _end; i += REDUCTION_LANES)
+      for (size_t Lane = 0; Lane < REDUCTION_LANES; ++Lane)
+        Lanes[Lane] += f(v[i + Lane]);
+    for (size_t Lane = 0; Lane < REDUCTION_LANES; ++Lane) Sum += Lanes[Lane];
+  }
+  for (; i < _end; ++i) Sum += f(v[i]);
+  return Sum;
+}
+
+template <typename T1, typename T0, typename Functor_t>
+stuRunningMoments<T1> momentsOfRange(const std::vector<T0> &v, size_t _begin,
+                                     size_t _end, const Functor_t &f) {
+  stuRunningMoments<T1> Lanes[REDUCTION_LANES];
+  size_t i = _begin;
+  for (; i + REDUCTION_LANES <= _end; i += REDUCTION_LANES)
+    for (size_t Lane = 0; Lane < REDUCTION_LANES; ++Lane)
+      Lanes[Lane].add(f(v[i + Lane]));
+  for (; i < _end; ++i) Lanes[0].add(f(v[i]));
+  for (size_t Lane = 1; Lane < REDUCTION_LANES; ++Lane)
+    Lanes[0].merge(Lanes[Lane]);
+  return Lanes[0];
+}
+
+// Index of the first best item, as the serial argmax/argmin
+template <typename T0, typename Functor_t, typename Compare_t>
+int32_t argbest(const stuParallelPolicy &_policy, const std::vector<T0> &v,
+                Functor_t f, Compare_t _isBetter) {
+  using T1 = decltype(std::declval<Functor_t>()(std::declval<T0>()));
+  auto Partials = reduceChunks(_policy, v.size(), [&](size_t _begin,
+                                                      size_t _end) {
+    size_t Best = _begin;
+    T1 BestValue = f(v[_begin]);
+    for (size_t i = _begin + 1; i < _end; ++i) {
+      T1 Value = f(v[i]);
+      if (_isBetter(Value, BestValue)) {
+        Best = i;
+        BestValue = Value;
+      }
+    }
+    return std::make_pair(Best, BestValue);
+  });
+  auto Best = Partials.front();
+  for (const auto &Partial : Partials)
+    if (_isBetter(Partial.second, Best.second)) Best = Partial;
+  return static_cast<int32_t>(Best.first);
+}
+
+}  // namespace Private
+
+template <typename T0, typename Functor_t>
+auto mean(const stuParallelPolicy &_policy, const std::vector<T0> &v,
+          Functor_t f) {
+  using T1 = decltype(std::declval<Functor_t>()(std::declval<T0>()));
+  if (v.size() < _policy.MinParallelSize) return mean(v, f);
+
+  auto Partials = Private::reduceChunks(
+      _policy, v.size(), [&](size_t _begin, size_t _end) {
+        return Private::sumRange<T1>(v, _begin, _end, f);
+      });
+  T1 Result = 0;
+  for (const auto &Partial : Partials) Result += Partial;
+  return static_cast<T1>(Result / static_cast<T1>(v.size()));
+}
+
+template <typename T0, typename Functor_t>
+auto var(const stuParallelPolicy &_policy, const std::vector<T0> &v,
+         Functor_t f) {
+  using T1 = decltype(std::declval<Functor_t>()(std::declval<T0>()));
+  if (v.size() < _policy.MinParallelSize) return var(v, f);
+
+  auto Partials = Private::reduceChunks(
+      _policy, v.size(), [&](size_t _begin, size_t _end) {
+        return Private::momentsOfRange<T1>(v, _begin, _end, f);
+      });
+  stuRunningMoments<T1> Moments;
+  for (const auto &Partial : Partials) Moments.merge(Partial);
+  return Moments.variance();
+}
+
+template <typename T0, typename Functor_t>
+auto std(const stuParallelPolicy &_policy, const std::vector<T0> &v,
+         Functor_t f) {
+  using T1 = decltype(std::declval<Functor_t>()(std::declval<T0>()));
+  auto Var = var(_policy, v, f);
+  if (Var > std::numeric_limits<T1>::epsilon())
+    return static_cast<T1>(::std::sqrt(Var));
+  return static_cast<T1>(0);
+}
+
+template <typename T, typename Functor_t>
+int32_t argmax(const stuParallelPolicy &_policy, const std::vector<T> &v,
+               Functor_t f) {
+  if (v.size() < _policy.MinParallelSize) return argmax(v, f);
+  return Private::argbest(_policy, v, f, [](const auto &a, const auto &b) {
+    return a > b;
+  });
+}
+
+template <typename T, typename Functor_t>
+int32_t argmin(const stuParallelPolicy &_policy, const std::vector<T> &v,
+               Functor_t f) {
+  if (v.size() < _policy.MinParallelSize) return argmin(v, f);
+  return Private::argbest(_policy, v, f, [](const auto &a, const auto &b) {
+    return a < b;
+  });
+}
+
+template <typename T0, typename Functor_t>
+auto map(const stuParallelPolicy &_policy, const std::vector<T0> &v,
+         Functor_t f) {
+  using T1 = decltype(std::declval<Functor_t>()(std::declval<T0>()));
+  if (v.size() < _policy.MinParallelSize) return map(v, f);
+
+  //@NOTE: Chunks fill vectors of their own, as neighbouring elements of a
+  //       shared one may share a word (vector<bool>)
+  auto Partials = Private::reduceChunks(
+      _policy, v.size(), [&](size_t _begin, size_t _end) {
+        std::vector<T1> Mapped;
+        Mapped.reserve(_end - _begin);
+        for (size_t i = _begin; i < _end; ++i) Mapped.push_back(f(v[i]));
+        return Mapped;
+      });
+  std::vector<T1> Result;
+  Result.reserve(v.size());
+  for (auto &Partial : Partials)
+    Result.insert(Result.end(), std::make_move_iterator(Partial.begin()),
+                  std::make_move_iterator(Partial.end()));
+  return Result;
+}
+
+template <typename T, typename Functor_t>
+std::vector<T> filter(const stuParallelPolicy &_policy,
+                      const std::vector<T> &v, Functor_t f) {
+  if (v.size() < _policy.MinParallelSize) return filter(v, f);
+
+  auto Partials = Private::reduceChunks(
+      _policy, v.size(), [&](size_t _begin, size_t _end) {
+        std::vector<T> Kept;
+        for (size_t i = _begin; i < _end; ++i)
+          if (f(v[i])) Kept.push_back(v[i]);
+        return Kept;
+      });
+  size_t Size = 0;
+  for (const auto &Partial : Partials) Size += Partial.size();
+  std::vector<T> Result;
+  Result.reserve(Size);
+  for (auto &Partial : Partials)
+    Result.insert(Result.end(), std::make_move_iterator(Partial.begin()),
+                  std::make_move_iterator(Partial.end()));
+  return Result;
+}
+
+}  // namespace Common
+}  // namespace Targoman
+
+#endif  // __TARGOMAN_COMMON_PARALLELALGORITHMS__
@@ -1,11 +1,27 @@
 #include "pdfla.h"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include <iostream>
+#include <mutex>
+#include <numeric>
+#include <unordered_map>
 
 #include "algorithm.hpp"
+#include "clsCoverIndex.h"
+#include "clsLayoutTemplateCache.h"
+#include "clsPageFurnitureIndex.h"
+#include "clsPageResultCache.h"
 #include "clsPdfiumWrapper.h"
+#include "clsStrand.h"
+#include "clsThreadPool.h"
+#include "clsWordGapStatistics.h"
 #include "debug.h"
+#include "parallelAlgorithm.hpp"
+#include "readingOrder.h"
+#include "tables.h"
 
 namespace Targoman {
 namespace PDFLA {
@@ -13,32 +29,110 @@ using namespace Targoman::DLA;
 using namespace Targoman::Common;
 
 constexpr float DEBUG_UPSCALE_FACTOR = 2.f;
-constexpr float MAX_IMAGE_BLOB_AREA_FACTOR = 0.5f;
+constexpr size_t MAX_STATISTICS_SAMPLE_PAGES = 32;
+constexpr size_t MIN_CHARS_FOR_INTRA_PAGE_PARALLELISM = 1024;
+constexpr size_t MAX_OBSTACLES_FOR_EXACT_COVER = 10000;
+constexpr float SORT_KEY_QUANTUM = 1.f / 64;
+//@NOTE: Must be bumped whenever the analysis output changes, as the cached
+//       results may outlive the process
+constexpr uint64_t PAGE_RESULT_CACHE_VERSION = 12;
 
 class clsPdfLaInternals {
  private:
   std::unique_ptr<clsPdfiumWrapper> PdfiumWrapper;
+  // Items of the pages visited by document level passes, so they are read
+  // from PDFium only once
+  std::unordered_map<size_t, CompactDocItemVector_t> PageItemCache;
+  stuPdfLaOptions Options;
+  // Options of the call in progress, the document ones unless it has its own
+  stuPdfLaOptions PageOptions;
+  std::unique_ptr<clsPageFurnitureIndex> PageFurnitureIndex;
+  std::shared_ptr<const clsWordGapStatistics> DocumentWordGapStatistics;
+  // Created on first use, as the options of a call may enable them
+  std::unique_ptr<clsThreadPool> IntraPageThreadPool;
+  size_t IntraPageNumberOfThreads;
+  std::unique_ptr<clsLayoutTemplateCache> LayoutTemplateCache;
+  // Zero until computed, covers all pages for the document level passes
+  uint64_t DocumentContentHash;
+  // Deadline of the page being analyzed, max() when there is no budget
+  std::chrono::steady_clock::time_point PageDeadline;
+  std::atomic<bool> PageBudgetExceeded;
+  std::atomic<bool> PageIsDegraded;
+  std::mutex DocumentLock;
+  std::once_flag AsyncStrandIsCreated;
+  //@NOTE: Declared last, so the queued calls are drained before the members
+  //       they use are destroyed
+  std::unique_ptr<clsStrand> AsyncStrand;
 
  private:
-  float computeWordSeparationThreshold(
-      const DocItemPtrVector_t &_sortedDocItems, float _width);
+  bool pageBudgetExceeded();
+  // Null when the page options do not use them
+  clsThreadPool *intraPageThreadPool();
+  clsLayoutTemplateCache *layoutTemplateCache();
+  PageResultKey_t pageResultCacheKey(size_t _pageIndex);
+  DocBlockPtrVector_t analyzePageBlocks(size_t _pageIndex);
+  DocItemPtrVector_t getPageItems(size_t _pageIndex, bool _cache = false);
+  // `_f` of the (cached) items of each page, for the document level passes
+  template <typename Functor_t>
+  auto mapPageItems(const std::vector<size_t> &_pageIndexes, Functor_t _f);
+  const clsPageFurnitureIndex &pageFurnitureIndex();
+  DocBlockPtrVector_t separatePageFurniture(size_t _pageIndex,
+                                            DocItemPtrVector_t &_docItems,
+                                            const stuSize &_pageSize);
+  std::shared_ptr<const clsWordGapStatistics> getWordGapStatistics(
+      const DocItemPtrVector_t &_sortedChars, const stuSize &_pageSize);
   BoundingBoxPtrVector_t getRawWhitespaceCover(
       const BoundingBoxPtr_t &_bounds, const BoundingBoxPtrVector_t &_obstacles,
       float _minCoverLegSize);
   BoundingBoxPtrVector_t getWhitespaceCoverage(
-      const DocItemPtrVector_t &_sortedDocItems, const stuSize &_pageSize,
-      float _wordSeparationThreshold);
+      const clsConcatView<DocItemPtr_t> &_sortedDocItems,
+      const stuSize &_pageSize,
+      const clsWordGapStatistics &_wordGapStatistics);
+  DocItemPtrVector_t findPageFigures(const DocItemPtrVector_t &_figureItems,
+                                     const stuSize &_pageSize);
+  // Chars sorted vertically and figure items in reading order
+  std::tuple<DocItemPtrVector_t, DocItemPtrVector_t> sortPageItems(
+      const DocItemPtrVector_t &_docItems);
+  // Separators are obstacles to the whitespace cover, but never figures
+  std::tuple<DocItemPtrVector_t, DocItemPtrVector_t, BoundingBoxPtrVector_t>
+  analyzePageItems(const DocItemPtrVector_t &_docItems,
+                   const stuSize &_pageSize,
+                   const DocItemPtrVector_t &_separators);
+  // The chars are best given in content stream order
+  DocLinePtrVector_t findPageLines(
+      const DocItemPtrVector_t &_chars,
+      const BoundingBoxPtrVector_t &_whitespaceCover);
   std::tuple<DocLinePtrVector_t, DocItemPtrVector_t> findPageLinesAndFigures(
       const DocItemPtrVector_t &_docItems, const stuSize &_pageSize);
   DocBlockPtrVector_t findPageTextBlocks(
       const DocLinePtrVector_t &_pageLines,
       const DocItemPtrVector_t &_pageFigures);
+  DocBlockPtrVector_t findPageTextBlocksByColumns(
+      const DocItemPtrVector_t &_contentOrderChars,
+      const DocItemPtrVector_t &_pageFigures,
+      const BoundingBoxPtrVector_t &_whitespaceCover);
 
  public:
-  clsPdfLaInternals(uint8_t *_data, size_t _size)
-      : PdfiumWrapper(new clsPdfiumWrapper(_data, _size)) {}
+  clsPdfLaInternals(uint8_t *_data, size_t _size,
+                    const stuPdfLaOptions &_options)
+      : PdfiumWrapper(new clsPdfiumWrapper(_data, _size)),
+        Options(_options),
+        PageOptions(_options),
+        IntraPageNumberOfThreads(0),
+        DocumentContentHash(0),
+        PageDeadline(std::chrono::steady_clock::time_point::max()),
+        PageBudgetExceeded(false),
+        PageIsDegraded(false) {}
 
+  // Serializes the calls into the document, as neither its PDFium state nor
+  // the analysis state are thread safe
+  std::mutex &documentLock() { return this->DocumentLock; }
+  clsStrand &asyncStrand();
+
+  bool isLoaded() const { return this->PdfiumWrapper->isLoaded(); }
   size_t pageCount();
+  const stuPdfLaOptions &options() const { return this->Options; }
+  void setOptions(const stuPdfLaOptions &_options);
 
  public:
   stuSize getPageSize(size_t _pageIndex);
@@ -47,66 +141,472 @@ class clsPdfLaInternals {
                                        const stuSize &_renderSize);
 
  public:
-  DocBlockPtrVector_t getPageBlocks(size_t _pageIndex);
+  DocBlockPtrVector_t getPageBlocks(size_t _pageIndex,
+                                    const stuPdfLaOptions &_options,
+                                    bool *_isDegraded);
   DocBlockPtrVector_t getTextBlocks(size_t _pageIndex);
+  std::vector<stuEmbeddedImage> getEmbeddedImages(
+      size_t _pageIndex, const stuBoundingBox &_region);
 };
 
-clsPdfLa::clsPdfLa(uint8_t *_data, size_t _size)
-    : Internals(new clsPdfLaInternals(_data, _size)) {}
+class clsAsyncExecutor {
+ private:
+  std::mutex Lock;
+  size_t NumberOfThreads;
+  std::unique_ptr<clsThreadPool> ThreadPool;
+
+ private:
+  clsAsyncExecutor() : NumberOfThreads(0) {}
+
+ public:
+  static clsAsyncExecutor &instance() {
+    static clsAsyncExecutor Instance;
+    return Instance;
+  }
+
+  void setNumberOfThreads(size_t _numberOfThreads) {
+    std::lock_guard<std::mutex> Guard(this->Lock);
+    this->NumberOfThreads = _numberOfThreads;
+  }
+
+  clsThreadPool &threadPool() {
+    std::lock_guard<std::mutex> Guard(this->Lock);
+    if (this->ThreadPool.get() == nullptr)
+      this->ThreadPool.reset(new clsThreadPool(this->NumberOfThreads));
+    return *this->ThreadPool;
+  }
+};
+
+clsStrand &clsPdfLaInternals::asyncStrand() {
+  std::call_once(this->AsyncStrandIsCreated, [this]() {
+    this->AsyncStrand.reset(
+        new clsStrand(clsAsyncExecutor::instance().threadPool()));
+  });
+  return *this->AsyncStrand;
+}
+
+stuPdfLaOptions::stuPdfLaOptions()
+    : SegmentationMode(enuSegmentationMode::WhitespaceCover),
+      DetectTables(true),
+      DetectPageFurniture(false),
+      UseDocumentStatistics(false),
+      ReuseLayoutTemplates(false),
+      UseIntraPageParallelism(false),
+      NumberOfThreads(0),
+      PageTimeBudget(0),
+      MaxCovers(30),
+      MinCoverArea(2048.f),
+      MaxCoverCandidates(0),
+      WordSeparationThresholdMultiplier(1.5f),
+      MaxImageBlobAreaFactor(0.5f) {}
+
+stuPdfLaOptions stuPdfLaOptions::fast() {
+  stuPdfLaOptions Options;
+  Options.SegmentationMode = enuSegmentationMode::XYCut;
+  Options.DetectTables = false;
+  return Options;
+}
+
+stuPdfLaOptions stuPdfLaOptions::balanced() { return stuPdfLaOptions(); }
+
+stuPdfLaOptions stuPdfLaOptions::accurate() {
+  stuPdfLaOptions Options;
+  Options.DetectPageFurniture = true;
+  Options.UseDocumentStatistics = true;
+  Options.MaxCovers = 50;
+  return Options;
+}
+
+clsPdfLa::clsPdfLa(uint8_t *_data, size_t _size,
+                   const stuPdfLaOptions &_options)
+    : Internals(new clsPdfLaInternals(_data, _size, _options)) {}
 
 clsPdfLa::~clsPdfLa() { clsPdfLaDebug::instance().unregisterObject(this); }
 
-size_t clsPdfLa::pageCount() { return this->Internals->pageCount(); }
+bool clsPdfLa::isLoaded() const { return this->Internals->isLoaded(); }
+
+size_t clsPdfLa::pageCount() {
+  std::lock_guard<std::mutex> Guard(this->Internals->documentLock());
+  return this->Internals->pageCount();
+}
+
+void clsPdfLa::setOptions(const stuPdfLaOptions &_options) {
+  std::lock_guard<std::mutex> Guard(this->Internals->documentLock());
+  this->Internals->setOptions(_options);
+}
+
+stuPdfLaOptions clsPdfLa::options() {
+  std::lock_guard<std::mutex> Guard(this->Internals->documentLock());
+  return this->Internals->options();
+}
 
 Targoman::DLA::stuSize clsPdfLa::getPageSize(size_t _pageIndex) {
+  std::lock_guard<std::mutex> Guard(this->Internals->documentLock());
   return this->Internals->getPageSize(_pageIndex);
 }
 
 std::vector<uint8_t> clsPdfLa::renderPageImage(size_t _pageIndex,
                                                uint32_t _backgroundColor,
                                                const stuSize &_renderSize) {
+  std::lock_guard<std::mutex> Guard(this->Internals->documentLock());
   return this->Internals->renderPageImage(_pageIndex, _backgroundColor,
                                           _renderSize);
 }
 
-Targoman::DLA::DocBlockPtrVector_t clsPdfLa::getPageBlocks(size_t _pageIndex) {
-  return this->Internals->getPageBlocks(_pageIndex);
+// The document options with another segmentation mode
+stuPdfLaOptions withSegmentationMode(stuPdfLaOptions _options,
+                                     enuSegmentationMode _mode) {
+  _options.SegmentationMode = _mode;
+  return _options;
+}
+
+DocBlockPtrVector_t clsPdfLa::getPageBlocks(size_t _pageIndex,
+                                            bool *_isDegraded) {
+  std::lock_guard<std::mutex> Guard(this->Internals->documentLock());
+  return this->Internals->getPageBlocks(
+      _pageIndex, this->Internals->options(), _isDegraded);
+}
+
+DocBlockPtrVector_t clsPdfLa::getPageBlocks(size_t _pageIndex,
+                                            enuSegmentationMode _mode,
+                                            bool *_isDegraded) {
+  std::lock_guard<std::mutex> Guard(this->Internals->documentLock());
+  return this->Internals->getPageBlocks(
+      _pageIndex, withSegmentationMode(this->Internals->options(), _mode),
+      _isDegraded);
+}
+
+DocBlockPtrVector_t clsPdfLa::getPageBlocks(size_t _pageIndex,
+                                            const stuPdfLaOptions &_options,
+                                            bool *_isDegraded) {
+  std::lock_guard<std::mutex> Guard(this->Internals->documentLock());
+  return this->Internals->getPageBlocks(_pageIndex, _options, _isDegraded);
 }
 
 DocBlockPtrVector_t clsPdfLa::getTextBlocks(size_t _pageIndex) {
+  std::lock_guard<std::mutex> Guard(this->Internals->documentLock());
   return this->Internals->getTextBlocks(_pageIndex);
 }
 
+std::vector<stuEmbeddedImage> clsPdfLa::getEmbeddedImages(
+    size_t _pageIndex, const stuBoundingBox &_region) {
+  std::lock_guard<std::mutex> Guard(this->Internals->documentLock());
+  return this->Internals->getEmbeddedImages(_pageIndex, _region);
+}
+
+//@NOTE: The options are resolved from the document ones on the strand, so
+//       queued calls see the options set before them and never block on the
+//       document lock while being queued
+template <typename OptionsOf_t>
+std::future<DocBlockPtrVector_t> submitPageBlocks(clsPdfLaInternals *_internals,
+                                                  size_t _pageIndex,
+                                                  OptionsOf_t _optionsOf,
+                                                  bool *_isDegraded) {
+  return _internals->asyncStrand().submit([_internals, _pageIndex, _optionsOf,
+                                           _isDegraded]() {
+    std::lock_guard<std::mutex> Guard(_internals->documentLock());
+    return _internals->getPageBlocks(
+        _pageIndex, _optionsOf(_internals->options()), _isDegraded);
+  });
+}
+
+template <typename OptionsOf_t>
+void postPageBlocks(clsPdfLaInternals *_internals, size_t _pageIndex,
+                    std::function<void(DocBlockPtrVector_t)> _onDone,
+                    OptionsOf_t _optionsOf, bool *_isDegraded) {
+  _internals->asyncStrand().post([_internals, _pageIndex, _onDone, _optionsOf,
+                                  _isDegraded]() {
+    DocBlockPtrVector_t Blocks;
+    {
+      std::lock_guard<std::mutex> Guard(_internals->documentLock());
+      Blocks = _internals->getPageBlocks(
+          _pageIndex, _optionsOf(_internals->options()), _isDegraded);
+    }
+    _onDone(std::move(Blocks));
+  });
+}
+
+std::future<DocBlockPtrVector_t> clsPdfLa::getPageBlocksAsync(
+    size_t _pageIndex, bool *_isDegraded) {
+  return submitPageBlocks(
+      this->Internals.get(), _pageIndex,
+      [](const stuPdfLaOptions &_documentOptions) { return _documentOptions; },
+      _isDegraded);
+}
+
+std::future<DocBlockPtrVector_t> clsPdfLa::getPageBlocksAsync(
+    size_t _pageIndex, enuSegmentationMode _mode, bool *_isDegraded) {
+  return submitPageBlocks(this->Internals.get(), _pageIndex,
+                          [_mode](const stuPdfLaOptions &_documentOptions) {
+                            return withSegmentationMode(_documentOptions,
+                                                        _mode);
+                          },
+                          _isDegraded);
+}
+
+std::future<DocBlockPtrVector_t> clsPdfLa::getPageBlocksAsync(
+    size_t _pageIndex, const stuPdfLaOptions &_options, bool *_isDegraded) {
+  return submitPageBlocks(
+      this->Internals.get(), _pageIndex,
+      [_options](const stuPdfLaOptions &) { return _options; }, _isDegraded);
+}
+
+void clsPdfLa::getPageBlocksAsync(
+    size_t _pageIndex, std::function<void(DocBlockPtrVector_t)> _onDone,
+    bool *_isDegraded) {
+  postPageBlocks(
+      this->Internals.get(), _pageIndex, _onDone,
+      [](const stuPdfLaOptions &_documentOptions) { return _documentOptions; },
+      _isDegraded);
+}
+
+void clsPdfLa::getPageBlocksAsync(
+    size_t _pageIndex, std::function<void(DocBlockPtrVector_t)> _onDone,
+    enuSegmentationMode _mode, bool *_isDegraded) {
+  postPageBlocks(this->Internals.get(), _pageIndex, _onDone,
+                 [_mode](const stuPdfLaOptions &_documentOptions) {
+                   return withSegmentationMode(_documentOptions, _mode);
+                 },
+                 _isDegraded);
+}
+
+void clsPdfLa::getPageBlocksAsync(
+    size_t _pageIndex, std::function<void(DocBlockPtrVector_t)> _onDone,
+    const stuPdfLaOptions &_options, bool *_isDegraded) {
+  postPageBlocks(this->Internals.get(), _pageIndex, _onDone,
+                 [_options](const stuPdfLaOptions &) { return _options; },
+                 _isDegraded);
+}
+
+std::future<std::vector<uint8_t>> clsPdfLa::renderPageImageAsync(
+    size_t _pageIndex, uint32_t _backgroundColor, const stuSize &_renderSize) {
+  auto Internals = this->Internals.get();
+  return Internals->asyncStrand().submit(
+      [Internals, _pageIndex, _backgroundColor, _renderSize]() {
+        std::lock_guard<std::mutex> Guard(Internals->documentLock());
+        return Internals->renderPageImage(_pageIndex, _backgroundColor,
+                                          _renderSize);
+      });
+}
+
+void clsPdfLa::renderPageImageAsync(
+    size_t _pageIndex, uint32_t _backgroundColor, const stuSize &_renderSize,
+    std::function<void(std::vector<uint8_t>)> _onDone) {
+  auto Internals = this->Internals.get();
+  Internals->asyncStrand().post(
+      [Internals, _pageIndex, _backgroundColor, _renderSize, _onDone]() {
+        std::vector<uint8_t> Data;
+        {
+          std::lock_guard<std::mutex> Guard(Internals->documentLock());
+          Data = Internals->renderPageImage(_pageIndex, _backgroundColor,
+                                            _renderSize);
+        }
+        _onDone(std::move(Data));
+      });
+}
+
+void clsPdfLa::enablePageFurnitureDetection(bool _enable) {
+  std::lock_guard<std::mutex> Guard(this->Internals->documentLock());
+  auto Options = this->Internals->options();
+  Options.DetectPageFurniture = _enable;
+  this->Internals->setOptions(Options);
+}
+
+void clsPdfLa::enableDocumentStatistics(bool _enable) {
+  std::lock_guard<std::mutex> Guard(this->Internals->documentLock());
+  auto Options = this->Internals->options();
+  Options.UseDocumentStatistics = _enable;
+  this->Internals->setOptions(Options);
+}
+
+void clsPdfLa::enableIntraPageParallelism(bool _enable,
+                                          size_t _numberOfThreads) {
+  std::lock_guard<std::mutex> Guard(this->Internals->documentLock());
+  auto Options = this->Internals->options();
+  Options.UseIntraPageParallelism = _enable;
+  Options.NumberOfThreads = _numberOfThreads;
+  this->Internals->setOptions(Options);
+}
+
+void clsPdfLa::enableLayoutTemplateReuse(bool _enable) {
+  std::lock_guard<std::mutex> Guard(this->Internals->documentLock());
+  auto Options = this->Internals->options();
+  Options.ReuseLayoutTemplates = _enable;
+  this->Internals->setOptions(Options);
+}
+
+void clsPdfLa::setPageTimeBudget(std::chrono::milliseconds _budget) {
+  std::lock_guard<std::mutex> Guard(this->Internals->documentLock());
+  auto Options = this->Internals->options();
+  Options.PageTimeBudget = _budget;
+  this->Internals->setOptions(Options);
+}
+
 void clsPdfLa::enableDebugging(const std::string &_basename) {
+  std::lock_guard<std::mutex> Guard(this->Internals->documentLock());
   if (!_basename.empty())
     clsPdfLaDebug::instance().registerObject(this->Internals.get(), _basename);
 }
 
-float clsPdfLaInternals::computeWordSeparationThreshold(
-    const DocItemPtrVector_t &_sortedDocItems, float _width) {
-  constexpr float MIN_ACKNOWLEDGABLE_DISTANCE = 3.f;
-  constexpr float WORD_SEPARATION_THRESHOLD_MULTIPLIER = 1.5f;
+/**
+ * PDFium parses one page at a time, so the pages are read in batches of a few
+ * per intra-page thread and `_f` runs on the pages of each batch
+ * concurrently. Without intra-page parallelism the pages are read and mapped
+ * one by one, which keeps a single page of items in memory.
+ */
+template <typename Functor_t>
+auto clsPdfLaInternals::mapPageItems(const std::vector<size_t> &_pageIndexes,
+                                     Functor_t _f) {
+  using Result_t = decltype(_f(std::declval<DocItemPtrVector_t>()));
+  auto ThreadPool = this->intraPageThreadPool();
+  size_t BatchSize =
+      ThreadPool == nullptr ? 1 : ThreadPool->size() * CHUNKS_PER_THREAD;
 
-  std::vector<int32_t> HorzDistanceHistogram(
-      static_cast<size_t>(std::ceil(_width)), 0);
-  for (size_t i = 1; i < _sortedDocItems.size(); ++i) {
-    const auto &ThisItem = _sortedDocItems.at(i);
-    const auto &PrevItem = _sortedDocItems.at(i - 1);
-    if (ThisItem->BoundingBox.verticalOverlap(PrevItem->BoundingBox) >
-        MIN_ITEM_SIZE) {
-      auto dx = static_cast<int32_t>(ThisItem->BoundingBox.left() -
-                                     PrevItem->BoundingBox.right() + 0.5);
-      if (dx >= MIN_ACKNOWLEDGABLE_DISTANCE) {
-        ++HorzDistanceHistogram[dx];
-        if (dx > 1) ++HorzDistanceHistogram[dx - 1];
-        if (dx < static_cast<int32_t>(HorzDistanceHistogram.size()) - 1)
-          ++HorzDistanceHistogram[dx + 1];
-      }
+  std::vector<Result_t> Result;
+  Result.reserve(_pageIndexes.size());
+  std::vector<DocItemPtrVector_t> Batch;
+  for (size_t First = 0; First < _pageIndexes.size(); First += BatchSize) {
+    size_t Last = std::min(First + BatchSize, _pageIndexes.size());
+    Batch.clear();
+    for (size_t i = First; i < Last; ++i)
+      Batch.push_back(this->getPageItems(_pageIndexes[i], true));
+    auto Mapped = ThreadPool == nullptr
+                      ? map(Batch, _f)
+                      : map(stuParallelPolicy(*ThreadPool, 2, 1), Batch, _f);
+    Result.insert(Result.end(), std::make_move_iterator(Mapped.begin()),
+                  std::make_move_iterator(Mapped.end()));
+  }
+  return Result;
+}
+
+std::shared_ptr<const clsWordGapStatistics>
+clsPdfLaInternals::getWordGapStatistics(
+    const DocItemPtrVector_t &_sortedChars, const stuSize &_pageSize) {
+  float ThresholdMultiplier =
+      this->PageOptions.WordSeparationThresholdMultiplier;
+  if (this->PageOptions.UseDocumentStatistics) {
+    if (this->DocumentWordGapStatistics.get() == nullptr ||
+        this->DocumentWordGapStatistics->thresholdMultiplier() !=
+            ThresholdMultiplier) {
+      //@NOTE: Chars are taken in content stream order, where consecutive chars
+      //       of a line are neighbours far more often than in sorted order
+      auto Statistics =
+          std::make_shared<clsWordGapStatistics>(ThresholdMultiplier);
+      size_t PageCount = this->pageCount();
+      size_t Step = std::max(static_cast<size_t>(1),
+                             PageCount / MAX_STATISTICS_SAMPLE_PAGES);
+      std::vector<size_t> SamplePages;
+      for (size_t PageIndex = 0; PageIndex < PageCount; PageIndex += Step)
+        SamplePages.push_back(PageIndex);
+      auto PageChars = this->mapPageItems(
+          SamplePages, [](const DocItemPtrVector_t &_items) {
+            return filter(_items, [](const DocItemPtr_t &e) {
+              return e->Type == enuDocItemType::Char;
+            });
+          });
+      for (const auto &Chars : PageChars) Statistics->addGaps(Chars);
+      Statistics->finalize();
+      this->DocumentWordGapStatistics = Statistics;
     }
+    return this->DocumentWordGapStatistics;
   }
 
-  return WORD_SEPARATION_THRESHOLD_MULTIPLIER *
-         argmax(HorzDistanceHistogram, [](int32_t a) { return a; });
+  auto Statistics = std::make_shared<clsWordGapStatistics>(ThresholdMultiplier,
+                                                          _pageSize.Width);
+  Statistics->addGaps(_sortedChars);
+  Statistics->finalize();
+  return Statistics;
+}
+
+/**
+ * Cheap approximation of the whitespace cover for pages that are too large or
+ * too slow for the exact search. The obstacles are rasterized on a coarse grid
+ * and each maximal empty run of a grid column is grown to the right for as
+ * long as the next column is empty over the same rows.
+ */
+BoundingBoxPtrVector_t findCoarseWhitespaceCover(
+    const BoundingBoxPtr_t &_bounds, const BoundingBoxPtrVector_t &_obstacles) {
+  constexpr float COARSE_GRID_CELL_SIZE = 8.f;
+
+  auto cellCount = [](float _length) {
+    return std::max(
+        static_cast<int32_t>(std::ceil(_length / COARSE_GRID_CELL_SIZE)), 1);
+  };
+  auto cellOf = [](float _coordinate, float _origin, int32_t _count,
+                   bool _roundUp) {
+    float Cell = (_coordinate - _origin) / COARSE_GRID_CELL_SIZE;
+    return std::min(
+        std::max(static_cast<int32_t>(_roundUp ? std::ceil(Cell)
+                                               : std::floor(Cell)),
+                 0),
+        _count);
+  };
+  int32_t Columns = cellCount(_bounds->width());
+  int32_t Rows = cellCount(_bounds->height());
+  size_t Stride = static_cast<size_t>(Columns) + 1;
+
+  //@NOTE: Obstacles are added as corner deltas and summed up once, so huge
+  //       numbers of large obstacles cost no more than the grid itself
+  std::vector<int32_t> Occupancy(Stride * (static_cast<size_t>(Rows) + 1), 0);
+  auto at = [&](int32_t _x, int32_t _y) -> int32_t & {
+    return Occupancy[static_cast<size_t>(_y) * Stride +
+                     static_cast<size_t>(_x)];
+  };
+  for (const auto &Obstacle : _obstacles) {
+    int32_t X0 = cellOf(Obstacle->left(), _bounds->left(), Columns, false);
+    int32_t X1 = cellOf(Obstacle->right(), _bounds->left(), Columns, true);
+    int32_t Y0 = cellOf(Obstacle->top(), _bounds->top(), Rows, false);
+    int32_t Y1 = cellOf(Obstacle->bottom(), _bounds->top(), Rows, true);
+    if (X0 >= X1 || Y0 >= Y1) continue;
+    ++at(X0, Y0);
+    --at(X1, Y0);
+    --at(X0, Y1);
+    ++at(X1, Y1);
+  }
+  for (int32_t Y = 0; Y < Rows; ++Y)
+    for (int32_t X = 0; X < Columns; ++X)
+      at(X, Y) += (X > 0 ? at(X - 1, Y) : 0) + (Y > 0 ? at(X, Y - 1) : 0) -
+                  (X > 0 && Y > 0 ? at(X - 1, Y - 1) : 0);
+
+  auto isEmpty = [&](int32_t _x, int32_t _y0, int32_t _y1) {
+    for (int32_t Y = _y0; Y < _y1; ++Y)
+      if (at(_x, Y) > 0) return false;
+    return true;
+  };
+  BoundingBoxPtrVector_t Result;
+  std::vector<int32_t> CoveredUpTo(static_cast<size_t>(Columns) *
+                                       static_cast<size_t>(Rows),
+                                   0);
+  for (int32_t X = 0; X < Columns; ++X)
+    for (int32_t Y0 = 0; Y0 < Rows;) {
+      if (at(X, Y0) > 0) {
+        ++Y0;
+        continue;
+      }
+      int32_t Y1 = Y0;
+      while (Y1 < Rows && at(X, Y1) <= 0) ++Y1;
+      //@NOTE: Runs grown from a column on the left are not reported again
+      auto &Covered =
+          CoveredUpTo[static_cast<size_t>(X) * static_cast<size_t>(Rows) +
+                      static_cast<size_t>(Y0)];
+      if (Covered < Y1) {
+        int32_t X1 = X + 1;
+        while (X1 < Columns && isEmpty(X1, Y0, Y1)) {
+          CoveredUpTo[static_cast<size_t>(X1) * static_cast<size_t>(Rows) +
+                      static_cast<size_t>(Y0)] = Y1;
+          ++X1;
+        }
+        Result.push_back(std::make_shared<stuBoundingBox>(
+            _bounds->left() + X * COARSE_GRID_CELL_SIZE,
+            _bounds->top() + Y0 * COARSE_GRID_CELL_SIZE,
+            std::min(_bounds->left() + X1 * COARSE_GRID_CELL_SIZE,
+                     _bounds->right()),
+            std::min(_bounds->top() + Y1 * COARSE_GRID_CELL_SIZE,
+                     _bounds->bottom())));
+      }
+      Y0 = Y1;
+    }
+  return Result;
 }
 
 BoundingBoxPtrVector_t clsPdfLaInternals::getRawWhitespaceCover(
@@ -114,15 +614,16 @@ BoundingBoxPtrVector_t clsPdfLaInternals::getRawWhitespaceCover(
     float _minCoverLegSize) {
   constexpr float MIN_COVER_SIZE = 4.f;
   constexpr float MIN_COVER_PERIMETER = 128.f;
-  constexpr float MIN_COVER_AREA = 2048.f;
-  constexpr size_t MAX_COVER_NUMBER_OF_ITEMS = 30;
+  const float MinCoverArea = this->PageOptions.MinCoverArea;
+  const size_t MaxCovers = this->PageOptions.MaxCovers;
+  const size_t MaxCandidates = this->PageOptions.MaxCoverCandidates;
 
   BoundingBoxPtrVector_t Result;
   auto candidateIsAcceptable = [&](const BoundingBoxPtr_t &_bounds) {
     return _bounds->width() >= MIN_COVER_SIZE &&
            _bounds->height() >= MIN_COVER_SIZE &&
            _bounds->width() + _bounds->height() >= MIN_COVER_PERIMETER &&
-           _bounds->area() >= MIN_COVER_AREA;
+           _bounds->area() >= MinCoverArea;
   };
   auto calculateCandidateScore = [&](const BoundingBoxPtr_t &_candidate) {
     return _candidate->height() + 0.1f * _candidate->width();
@@ -135,7 +636,8 @@ BoundingBoxPtrVector_t clsPdfLaInternals::getRawWhitespaceCover(
     std::vector<Candidate_t> Candidates{
         std::make_tuple(calculateCandidateScore(_bounds), _bounds, _obstacles)};
     while (true) {
-      if (Candidates.empty()) return std::make_shared<stuBoundingBox>();
+      if (Candidates.empty() || this->pageBudgetExceeded())
+        return std::make_shared<stuBoundingBox>();
 
       auto ArgMax = argmax(Candidates, [&](const Candidate_t &_candidate) {
         return candidateIsAcceptable(std::get<1>(_candidate))
@@ -168,22 +670,91 @@ BoundingBoxPtrVector_t clsPdfLaInternals::getRawWhitespaceCover(
             })));
       }
       Candidates.erase(Candidates.begin() + ArgMax);
+      //@NOTE: A beam of the best scoring candidates, whichever is returned is
+      //       still free of obstacles
+      if (MaxCandidates > 0 && Candidates.size() > MaxCandidates) {
+        std::nth_element(Candidates.begin(),
+                         Candidates.begin() +
+                             static_cast<ptrdiff_t>(MaxCandidates),
+                         Candidates.end(),
+                         [](const Candidate_t &a, const Candidate_t &b) {
+                           return std::get<0>(a) > std::get<0>(b);
+                         });
+        Candidates.erase(
+            Candidates.begin() + static_cast<ptrdiff_t>(MaxCandidates),
+            Candidates.end());
+      }
     }
   };
+  auto findCoarseCover = [&]() {
+    auto Cover = filter(findCoarseWhitespaceCover(_bounds, _obstacles),
+                        candidateIsAcceptable);
+    std::sort(Cover.begin(), Cover.end(),
+              [&](const BoundingBoxPtr_t &a, const BoundingBoxPtr_t &b) {
+                return calculateCandidateScore(a) > calculateCandidateScore(b);
+              });
+    if (Cover.size() > MaxCovers) Cover.resize(MaxCovers);
+    return Cover;
+  };
+
+  bool HasPageBudget =
+      this->PageDeadline != std::chrono::steady_clock::time_point::max();
+  if (HasPageBudget && _obstacles.size() > MAX_OBSTACLES_FOR_EXACT_COVER) {
+    this->PageIsDegraded = true;
+    return findCoarseCover();
+  }
+  if (this->pageBudgetExceeded()) return findCoarseCover();
+
   auto Obstacles = _obstacles;
-  for (size_t i = 0; i < MAX_COVER_NUMBER_OF_ITEMS; ++i) {
+  auto LayoutTemplateCache = this->layoutTemplateCache();
+  clsLayoutTemplateCache::Occupancy_t Occupancy;
+  const std::vector<stuBoundingBox> *TemplateCovers = nullptr;
+  if (LayoutTemplateCache != nullptr) {
+    Occupancy = clsLayoutTemplateCache::occupancyOf(*_bounds, _obstacles);
+    TemplateCovers = LayoutTemplateCache->findCovers(_bounds->Size, Occupancy);
+  }
+
+  //@NOTE: Covers of a page with the same layout are kept as long as they are
+  //       still free of obstacles here. The search then only looks for the
+  //       covers that were lost (usually none, which takes a single search).
+  if (TemplateCovers != nullptr)
+    for (const auto &TemplateCover : *TemplateCovers) {
+      if (Result.size() >= MaxCovers) break;
+      auto Cover = std::make_shared<stuBoundingBox>(TemplateCover);
+      if (!candidateIsAcceptable(Cover) || !_bounds->contains(Cover)) continue;
+      bool IsBlocked = false;
+      for (const auto &Obstacle : Obstacles)
+        if (Obstacle->hasIntersectionWith(Cover)) {
+          IsBlocked = true;
+          break;
+        }
+      if (IsBlocked) continue;
+      Result.push_back(Cover);
+      Obstacles.push_back(Cover);
+    }
+
+  for (size_t i = Result.size(); i < MaxCovers; ++i) {
     auto NextCover = findNextLargetsCover(_bounds, Obstacles);
     if (!candidateIsAcceptable(NextCover)) break;
     Result.push_back(NextCover);
     Obstacles.push_back(NextCover);
   }
+  if (this->pageBudgetExceeded()) return findCoarseCover();
 
+  //@NOTE: A matched template takes the repaired covers, so it follows the
+  //       layout as it drifts instead of being repaired again on every page
+  if (LayoutTemplateCache != nullptr) {
+    if (TemplateCovers == nullptr)
+      LayoutTemplateCache->addCovers(_bounds->Size, Occupancy, Result);
+    else
+      LayoutTemplateCache->refreshCovers(Occupancy, Result);
+  }
   return Result;
 }
 
 BoundingBoxPtrVector_t clsPdfLaInternals::getWhitespaceCoverage(
-    const DocItemPtrVector_t &_sortedDocItems, const stuSize &_pageSize,
-    float _wordSeparationThreshold) {
+    const clsConcatView<DocItemPtr_t> &_sortedDocItems,
+    const stuSize &_pageSize, const clsWordGapStatistics &_wordGapStatistics) {
   constexpr float APPROXIMATE_FULL_OVERLAP_RATIO = 0.95f;
 
   DocItemPtrVector_t Blobs;
@@ -191,7 +762,7 @@ BoundingBoxPtrVector_t clsPdfLaInternals::getWhitespaceCoverage(
   float MeanCharWidth = 0;
   size_t NumberOfChars = 0;
   for (size_t i = 0; i < _sortedDocItems.size(); ++i) {
-    const auto &ThisItem = _sortedDocItems.at(i);
+    const auto &ThisItem = _sortedDocItems[i];
     if (ThisItem->Type != enuDocItemType::Char) continue;
     MeanCharWidth += ThisItem->BoundingBox.width();
     ++NumberOfChars;
@@ -206,7 +777,7 @@ BoundingBoxPtrVector_t clsPdfLaInternals::getWhitespaceCoverage(
             0.5) {
       auto dx = static_cast<int32_t>(ThisItem->BoundingBox.left() -
                                      PrevItem->BoundingBox.right() + 0.5);
-      if (dx < _wordSeparationThreshold) {
+      if (dx < _wordGapStatistics.wordSeparationThreshold(ThisItem)) {
         Blobs.back()->BoundingBox.unionWith_(ThisItem->BoundingBox);
         DoNotPushback = true;
       }
@@ -218,11 +789,13 @@ BoundingBoxPtrVector_t clsPdfLaInternals::getWhitespaceCoverage(
   if (NumberOfChars > 0) MeanCharWidth /= static_cast<float>(NumberOfChars);
 
   for (const auto &Item :
-       filter(_sortedDocItems, [](const DocItemPtr_t &_item) {
+       filter_view(_sortedDocItems, [](const DocItemPtr_t &_item) {
          return _item->Type != enuDocItemType::Char;
        })) {
-    if (Item->BoundingBox.area() <=
-        MAX_IMAGE_BLOB_AREA_FACTOR * _pageSize.area())
+    //@NOTE: Separators (of type None) are kept whatever their size
+    if (Item->Type == enuDocItemType::None ||
+        Item->BoundingBox.area() <=
+            this->PageOptions.MaxImageBlobAreaFactor * _pageSize.area())
       Blobs.push_back(Item);
   }
 
@@ -234,12 +807,11 @@ BoundingBoxPtrVector_t clsPdfLaInternals::getWhitespaceCoverage(
           }),
       MeanCharWidth);
 
-  auto Cover = filter(RawCover, [](const BoundingBoxPtr_t &a) {
-    return a->width() < a->height();
-  });
-  RawCover = filter(RawCover, [](const BoundingBoxPtr_t &a) {
-    return a->width() >= a->height();
-  });
+  BoundingBoxPtrVector_t Cover;
+  std::tie(Cover, RawCover) =
+      split(std::move(RawCover), [](const BoundingBoxPtr_t &a) {
+        return a->width() < a->height();
+      });
   for (auto &CoverItem : Cover) {
     for (const auto &HelperItem : RawCover)
       if (CoverItem->horizontalOverlap(HelperItem) >=
@@ -269,6 +841,95 @@ BoundingBoxPtrVector_t clsPdfLaInternals::getWhitespaceCoverage(
   return Cover;
 }
 
+DocItemPtrVector_t clsPdfLaInternals::findPageFigures(
+    const DocItemPtrVector_t &_figureItems, const stuSize &_pageSize) {
+  constexpr float FIGURE_GRID_CELL_SIZE = 32.f;
+  constexpr float MAX_FIGURE_MERGE_GAP = 1.f;
+
+  auto Items = filter(_figureItems, [&](const DocItemPtr_t &e) {
+    return e->BoundingBox.area() <=
+           this->PageOptions.MaxImageBlobAreaFactor * _pageSize.area();
+  });
+
+  //@NOTE: Items are hashed into the grid cells they touch, so each item is
+  //       only compared with its neighbours and every intersecting or nearly
+  //       touching pair ends up in the same cluster regardless of order. The
+  //       items of a cell are grouped by cluster, and the groups already in
+  //       the cluster of an item are skipped without comparing their items.
+  clsUnionFind Clusters(Items.size());
+  std::unordered_map<uint64_t, std::vector<std::vector<uint32_t>>> Grid;
+  auto gridCell = [](float _coordinate) {
+    return static_cast<int32_t>(
+        std::floor(_coordinate / FIGURE_GRID_CELL_SIZE));
+  };
+  for (uint32_t i = 0; i < Items.size(); ++i) {
+    const auto &BBox = Items[i]->BoundingBox;
+    for (int32_t X = gridCell(BBox.left() - MAX_FIGURE_MERGE_GAP);
+         X <= gridCell(BBox.right() + MAX_FIGURE_MERGE_GAP); ++X)
+      for (int32_t Y = gridCell(BBox.top() - MAX_FIGURE_MERGE_GAP);
+           Y <= gridCell(BBox.bottom() + MAX_FIGURE_MERGE_GAP); ++Y) {
+        auto &Cell = Grid[(static_cast<uint64_t>(static_cast<uint32_t>(X))
+                           << 32) |
+                          static_cast<uint32_t>(Y)];
+        std::vector<uint32_t> *OwnGroup = nullptr;
+        for (auto &Group : Cell) {
+          if (Clusters.find(Group.front()) != Clusters.find(i)) {
+            bool Touches = std::any_of(
+                Group.begin(), Group.end(), [&](uint32_t j) {
+                  return BBox.horizontalOverlap(Items[j]->BoundingBox) >=
+                             -MAX_FIGURE_MERGE_GAP &&
+                         BBox.verticalOverlap(Items[j]->BoundingBox) >=
+                             -MAX_FIGURE_MERGE_GAP;
+                });
+            if (Touches == false) continue;
+            Clusters.merge(i, Group.front());
+          }
+          if (OwnGroup == nullptr) {
+            OwnGroup = &Group;
+            continue;
+          }
+          //@NOTE: The smaller group is moved, so each item moves O(log n)
+          //       times
+          if (OwnGroup->size() < Group.size()) OwnGroup->swap(Group);
+          OwnGroup->insert(OwnGroup->end(), Group.begin(), Group.end());
+          Group.clear();
+        }
+        if (OwnGroup != nullptr) {
+          OwnGroup->push_back(i);
+          filter_inplace(Cell, [](const std::vector<uint32_t> &e) {
+            return e.size() > 0;
+          });
+        } else {
+          Cell.push_back({i});
+        }
+      }
+  }
+
+  DocItemPtrVector_t Result;
+  std::vector<int32_t> ResultIndexOfCluster(Items.size(), -1);
+  std::vector<bool> ResultIsMerged;
+  for (uint32_t i = 0; i < Items.size(); ++i) {
+    auto &ResultIndex = ResultIndexOfCluster[Clusters.find(i)];
+    if (ResultIndex < 0) {
+      ResultIndex = static_cast<int32_t>(Result.size());
+      Result.push_back(Items[i]);
+      ResultIsMerged.push_back(false);
+      continue;
+    }
+    auto &Figure = Result[static_cast<size_t>(ResultIndex)];
+    if (!ResultIsMerged[static_cast<size_t>(ResultIndex)]) {
+      Figure = std::make_shared<stuDocItem>(*Figure);
+      ResultIsMerged[static_cast<size_t>(ResultIndex)] = true;
+    }
+    Figure->BoundingBox.unionWith_(Items[i]->BoundingBox);
+    if (Figure->Type != enuDocItemType::Image)
+      Figure->Type = Items[i]->Type == enuDocItemType::Image
+                         ? enuDocItemType::Image
+                         : enuDocItemType::Path;
+  }
+  return Result;
+}
+
 bool itemBelongsToLine(const DocItemPtr_t &_item, const DocLinePtr_t &_line) {
   float HorizontalOverlap =
       _line->BoundingBox.horizontalOverlap(_item->BoundingBox);
@@ -286,91 +947,284 @@ bool itemBelongsToLine(const DocItemPtr_t &_item, const DocLinePtr_t &_line) {
   }
 }
 
-std::tuple<DocLinePtrVector_t, DocItemPtrVector_t>
-clsPdfLaInternals::findPageLinesAndFigures(const DocItemPtrVector_t &_docItems,
-                                           const stuSize &_pageSize) {
+std::tuple<DocItemPtrVector_t, DocItemPtrVector_t, BoundingBoxPtrVector_t>
+clsPdfLaInternals::analyzePageItems(const DocItemPtrVector_t &_docItems,
+                                    const stuSize &_pageSize,
+                                    const DocItemPtrVector_t &_separators) {
+  auto [SortedChars, SortedFigures] = this->sortPageItems(_docItems);
+  auto WordGapStatistics = this->getWordGapStatistics(SortedChars, _pageSize);
+  auto Obstacles = SortedFigures;
+  Obstacles.insert(Obstacles.end(), _separators.begin(), _separators.end());
+  auto WhitespaceCover = this->getWhitespaceCoverage(
+      cat_view(SortedChars, Obstacles), _pageSize, *WordGapStatistics);
+
+  auto ResultFigures = this->findPageFigures(SortedFigures, _pageSize);
+  return std::make_tuple(SortedChars, ResultFigures, WhitespaceCover);
+}
+
+std::tuple<DocItemPtrVector_t, DocItemPtrVector_t>
+clsPdfLaInternals::sortPageItems(const DocItemPtrVector_t &_docItems) {
   auto [SortedFigures, SortedChars] =
       std::move(split(_docItems, [&](const DocItemPtr_t &e) {
         return e->Type != enuDocItemType::Char;
       }));
-  std::sort(
-      SortedFigures.begin(), SortedFigures.end(),
-      [](const DocItemPtr_t &a, const DocItemPtr_t &b) {
-        if (a->BoundingBox.verticalOverlap(b->BoundingBox) > MIN_ITEM_SIZE)
-          return a->BoundingBox.left() < b->BoundingBox.left();
-        return a->BoundingBox.top() < b->BoundingBox.top();
-      });
+  //@NOTE: Packed keys make the order total and deterministic, which the
+  //       overlap based comparison of figures was not, and radix sorting
+  //       them is linear in the number of items
+  auto topLeftKey = [](const DocItemPtr_t &e) {
+    return packSortKey(e->BoundingBox.top(), e->BoundingBox.left(),
+                       SORT_KEY_QUANTUM);
+  };
+  radixSortBy(SortedFigures, topLeftKey);
+  radixSortBy(SortedChars, topLeftKey);
+  return std::make_tuple(SortedChars, SortedFigures);
+}
 
-  std::sort(SortedChars.begin(), SortedChars.end(),
-            [](const DocItemPtr_t &a, const DocItemPtr_t &b) {
-              return a->BoundingBox.top() < b->BoundingBox.top();
-            });
-  
-  for(size_t Y = 0; Y < static_cast<size_t>(_pageSize.Height); ++Y) {
-    auto Subset = filter(SortedChars, [&](const DocItemPtr_t &e) { return e->BoundingBox.top() <= Y && e->BoundingBox.bottom() >= Y; });
-    if(Subset.size() == 0)
+constexpr float BASELINE_QUANTUM = 0.25f;
+constexpr int64_t MAX_BASELINE_STEP = 4;  // In quanta, i.e. 1pt
+constexpr float MAX_LINE_GAP_RATIO = 2.5f;
+constexpr float MIN_COVER_LINE_OVERLAP = 3.f;
+
+/**
+ * Whether a whitespace cover separates the box from the line on its right or
+ * left. Covers are only as wide as the word gaps, so narrower gaps are
+ * skipped without looking at them.
+ */
+bool coverSeparates(const clsCoverIndex &_covers, const stuBoundingBox &_line,
+                    const stuBoundingBox &_box) {
+  float GapLeft = std::min(_line.right(), _box.right());
+  float GapRight = std::max(_line.left(), _box.left());
+  if (GapRight - GapLeft < _covers.minCoverWidth()) return false;
+  auto Union = _line.unionWith(_box);
+  return _covers.crosses(
+      stuBoundingBox(GapLeft, Union.top(), GapRight, Union.bottom()));
+}
+
+/**
+ * Cuts the chars, in content stream order, into runs that each continue a
+ * line: same baseline, right next to either end of the run so far and not
+ * separated from it by a whitespace cover. Content streams mostly draw the
+ * glyphs in reading order, so most lines come out as a single run in one
+ * linear pass. Chars without a finite baseline are left in `_leftovers`.
+ */
+DocLinePtrVector_t findContentOrderRuns(
+    const DocItemPtrVector_t &_chars, const clsCoverIndex &_whitespaceCover,
+    DocItemPtrVector_t &_leftovers) {
+  DocLinePtrVector_t Result;
+  DocLinePtr_t Run = nullptr;
+  for (const auto &Item : _chars) {
+    if (!std::isfinite(Item->Baseline)) {
+      _leftovers.push_back(Item);
       continue;
-    for(size_t i = 1; i < Subset.size(); ++i) {
-      size_t Position = i;
-      for(size_t j = i; j > 0; --j) {
-        if(Subset[i]->BoundingBox.left() > Subset[j - 1]->BoundingBox.left())
-          Position = j - 1;
-      }
-      if(Position != i) {
-        auto Copy = Subset[i];
-        for(size_t j = i; j > Position; --j)
-          Subset[j] = Subset[j - 1];
-        Subset[Position] = Copy;
-      }
     }
-    for(size_t i = 1; i < Subset.size(); ++i) {
-      if(Subset[i]->BoundingBox.left() > Subset[i - 1]->BoundingBox.left()) {
-        std::cout << "TROUBLE" << std::endl;
+    if (Run.get() != nullptr) {
+      const auto &Box = Item->BoundingBox;
+      float MaxGap = MAX_LINE_GAP_RATIO * std::max(Box.height(),
+                                                   Run->BoundingBox.height());
+      float HalfWidth = Box.width() / 2;
+      bool Continues =
+          std::abs(Item->Baseline - Run->Baseline) <=
+              MAX_BASELINE_STEP * BASELINE_QUANTUM &&
+          ((Box.left() >= Run->BoundingBox.right() - HalfWidth &&
+            Box.left() - Run->BoundingBox.right() <= MaxGap) ||
+           (Box.right() <= Run->BoundingBox.left() + HalfWidth &&
+            Run->BoundingBox.left() - Box.right() <= MaxGap)) &&
+          !coverSeparates(_whitespaceCover, Run->BoundingBox, Box);
+      if (!Continues) Run = nullptr;
+    }
+    if (Run.get() == nullptr) {
+      Run = std::make_shared<stuDocLine>();
+      Run->BoundingBox = Item->BoundingBox;
+      Run->Baseline = Item->Baseline;
+      Result.push_back(Run);
+    }
+    Run->BoundingBox.unionWith_(Item->BoundingBox);
+    Run->Items.push_back(Item);
+  }
+  return Result;
+}
+
+/**
+ * Joins the runs of chars into lines by their baselines. The quantized
+ * baselines are clustered in one pass over their sorted values, and the runs
+ * of each cluster are joined from left to right unless a wide gap or a
+ * whitespace cover separates them. Lines of smaller chars (superscripts,
+ * subscripts) are then merged into the neighbouring line they touch. Chars
+ * that end up alone, like those of rotated text, are left in `_leftovers`.
+ *
+ * Only the runs are sorted, which for well ordered content streams are about
+ * as many as the lines.
+ */
+DocLinePtrVector_t joinRunsByBaseline(
+    const DocLinePtrVector_t &_runs, const clsCoverIndex &_whitespaceCover,
+    DocItemPtrVector_t &_leftovers) {
+  constexpr float MIN_SCRIPT_OVERLAP_RATIO = 0.3f;
+  constexpr float MAX_SCRIPT_DISTANCE_RATIO = 2.f;
+
+  struct stuKeyedRun {
+    int64_t Key;
+    DocLinePtr_t Run;
+  };
+  std::vector<stuKeyedRun> Runs;
+  Runs.reserve(_runs.size());
+  for (const auto &Run : _runs)
+    Runs.push_back({std::llround(Run->Baseline / BASELINE_QUANTUM), Run});
+  std::stable_sort(Runs.begin(), Runs.end(),
+                   [](const stuKeyedRun &a, const stuKeyedRun &b) {
+                     return a.Key < b.Key;
+                   });
+
+  struct stuSegment {
+    DocLinePtr_t Line;
+    size_t Cluster;
+  };
+  std::vector<stuSegment> Segments;
+  std::vector<size_t> ClusterFirstSegment;
+  std::vector<float> ClusterBaselines;
+  for (size_t Begin = 0; Begin < Runs.size();) {
+    size_t End = Begin + 1;
+    while (End < Runs.size() &&
+           Runs[End].Key - Runs[End - 1].Key <= MAX_BASELINE_STEP)
+      ++End;
+    size_t Cluster = ClusterFirstSegment.size();
+    ClusterFirstSegment.push_back(Segments.size());
+    ClusterBaselines.push_back(Runs[(Begin + End) / 2].Run->Baseline);
+
+    std::stable_sort(Runs.begin() + static_cast<ptrdiff_t>(Begin),
+                     Runs.begin() + static_cast<ptrdiff_t>(End),
+                     [](const stuKeyedRun &a, const stuKeyedRun &b) {
+                       return a.Run->BoundingBox.left() <
+                              b.Run->BoundingBox.left();
+                     });
+    DocLinePtr_t Line = nullptr;
+    for (size_t i = Begin; i < End; ++i) {
+      const auto &Run = Runs[i].Run;
+      if (Line.get() != nullptr) {
+        float Gap = Run->BoundingBox.left() - Line->BoundingBox.right();
+        if (Gap > MAX_LINE_GAP_RATIO * std::max(Line->BoundingBox.height(),
+                                                Run->BoundingBox.height()) ||
+            coverSeparates(_whitespaceCover, Line->BoundingBox,
+                           Run->BoundingBox))
+          Line = nullptr;
       }
-      if(Subset[i]->BoundingBox.left() == Subset[i - 1]->BoundingBox.left()) {
-        std::cout << "POSSIBLE TROUBLE" << std::endl;
+      if (Line.get() == nullptr) {
+        Line = Run;
+        Line->Baseline = ClusterBaselines.back();
+        Segments.push_back({Line, Cluster});
+        continue;
       }
+      Line->BoundingBox.unionWith_(Run->BoundingBox);
+      Line->Items.insert(Line->Items.end(), Run->Items.begin(),
+                         Run->Items.end());
     }
+    Begin = End;
   }
+  ClusterFirstSegment.push_back(Segments.size());
 
-  auto WordSeparationThreshold =
-      this->computeWordSeparationThreshold(SortedChars, _pageSize.Width);
-  auto WhitespaceCover = this->getWhitespaceCoverage(
-      cat(SortedChars, SortedFigures), _pageSize, WordSeparationThreshold);
-
-  DocItemPtrVector_t ResultFigures;
-  for (const auto &Item : SortedFigures) {
-    if (Item->BoundingBox.area() <=
-        MAX_IMAGE_BLOB_AREA_FACTOR * _pageSize.area()) {
-      DocItemPtr_t SameFigure{nullptr};
-      for (auto &ResultFigureItem : ResultFigures)
-        if (ResultFigureItem->BoundingBox.hasIntersectionWith(
-                Item->BoundingBox)) {
-          SameFigure = ResultFigureItem;
-          break;
-        }
-      if (SameFigure.get() != nullptr)
-        SameFigure->BoundingBox.unionWith_(Item->BoundingBox);
+  //@NOTE: The merged line of each set of segments is kept by its root
+  clsUnionFind Merged(Segments.size());
+  //@NOTE: Only the clusters within a few script heights are searched, and
+  //       they hold a handful of segments each
+  for (size_t i = 0; i < Segments.size(); ++i) {
+    //@NOTE: Segments merged into a host are only compared through it, when
+    //       its own turn comes, so every set is searched once and the pass
+    //       stays linear
+    auto Root = static_cast<uint32_t>(i);
+    if (Merged.find(Root) != Root) continue;
+    auto ScriptLine = Segments[Root].Line;
+    const auto &Script = ScriptLine->BoundingBox;
+    float MaxDistance = MAX_SCRIPT_DISTANCE_RATIO * Script.height();
+    size_t ScriptCluster = Segments[i].Cluster;
+    auto findHost = [&](size_t _cluster) {
+      for (size_t j = ClusterFirstSegment[_cluster];
+           j < ClusterFirstSegment[_cluster + 1]; ++j) {
+        uint32_t Host = Merged.find(static_cast<uint32_t>(j));
+        if (Host == Root) continue;
+        const auto &Box = Segments[Host].Line->BoundingBox;
+        if (Box.height() > Script.height() &&
+            Box.verticalOverlap(Script) >
+                MIN_SCRIPT_OVERLAP_RATIO * Script.height() &&
+            -Box.horizontalOverlap(Script) <= Box.height())
+          return Host;
+      }
+      return Root;
+    };
+    uint32_t Host = Root;
+    for (size_t Cluster = ScriptCluster + 1;
+         Host == Root && Cluster + 1 < ClusterFirstSegment.size() &&
+         ClusterBaselines[Cluster] - ClusterBaselines[ScriptCluster] <
+             MaxDistance;
+         ++Cluster)
+      Host = findHost(Cluster);
+    for (size_t Cluster = ScriptCluster;
+         Host == Root && Cluster-- > 0 &&
+         ClusterBaselines[ScriptCluster] - ClusterBaselines[Cluster] <
+             MaxDistance;)
+      Host = findHost(Cluster);
+    if (Host == Root) continue;
+    auto HostLine = Segments[Host].Line;
+    HostLine->BoundingBox.unionWith_(Script);
+    HostLine->Items.insert(HostLine->Items.end(), ScriptLine->Items.begin(),
+                           ScriptLine->Items.end());
+    Merged.merge(Root, Host);
+    Segments[Merged.find(Root)].Line = HostLine;
+  }
+
+  DocLinePtrVector_t Result;
+  for (size_t i = 0; i < Segments.size(); ++i) {
+    if (Merged.find(static_cast<uint32_t>(i)) != i) continue;
+    auto &Line = Segments[i].Line;
+    if (Line->Items.size() == 1) {
+      _leftovers.push_back(Line->Items.front());
+      continue;
+    }
+    auto isLeftOf = [](const DocItemPtr_t &a, const DocItemPtr_t &b) {
+      return a->BoundingBox.left() < b->BoundingBox.left();
+    };
+    //@NOTE: Runs drawn from right to left are reversed in one go
+    if (!std::is_sorted(Line->Items.begin(), Line->Items.end(), isLeftOf)) {
+      if (std::is_sorted(Line->Items.rbegin(), Line->Items.rend(), isLeftOf))
+        std::reverse(Line->Items.begin(), Line->Items.end());
       else
-        ResultFigures.push_back(Item);
+        std::stable_sort(Line->Items.begin(), Line->Items.end(), isLeftOf);
     }
+    Result.push_back(Line);
   }
-  DocLinePtrVector_t ResultLines;
-  for (const auto &Item : SortedChars) {
-    DocLinePtr_t Line = nullptr;
+  return Result;
+}
+
+DocLinePtrVector_t clsPdfLaInternals::findPageLines(
+    const DocItemPtrVector_t &_chars,
+    const BoundingBoxPtrVector_t &_whitespaceCover) {
+  clsCoverIndex CoverIndex(_whitespaceCover, MIN_COVER_LINE_OVERLAP);
+
+  //@NOTE: Only the chars left alone by the runs and baselines go through the
+  //       pairwise search below
+  DocItemPtrVector_t Leftovers;
+  auto ResultLines = joinRunsByBaseline(
+      findContentOrderRuns(_chars, CoverIndex, Leftovers), CoverIndex,
+      Leftovers);
+  std::stable_sort(Leftovers.begin(), Leftovers.end(),
+                   [](const DocItemPtr_t &a, const DocItemPtr_t &b) {
+                     return a->BoundingBox.top() < b->BoundingBox.top();
+                   });
+  for (const auto &Item : Leftovers) {
+    if (this->pageBudgetExceeded()) break;
+    //@NOTE: The covers of all candidate lines are checked in one batch. The
+    //       inset matches the horizontal overlap that counts as intersecting.
+    DocLinePtrVector_t Candidates;
+    std::vector<stuBoundingBox> Unions;
     for (auto &ResultItem : ResultLines)
       if (itemBelongsToLine(Item, ResultItem)) {
         auto Union = ResultItem->BoundingBox.unionWith(Item->BoundingBox);
-        bool OverlapsWithCover = false;
-        for (const auto &CoverItem : WhitespaceCover)
-          if (CoverItem->hasIntersectionWith(Union) &&
-              CoverItem->verticalOverlap(Union) > 3) {
-            OverlapsWithCover = true;
-            break;
-          }
-        if (OverlapsWithCover) continue;
-        Line = ResultItem;
+        Candidates.push_back(ResultItem);
+        Unions.emplace_back(Union.left() + MIN_ITEM_SIZE, Union.top(),
+                            Union.right() - MIN_ITEM_SIZE, Union.bottom());
       }
+    auto CrossesCover = CoverIndex.crosses(Unions);
+    DocLinePtr_t Line = nullptr;
+    for (size_t i = Candidates.size(); i-- > 0 && Line.get() == nullptr;)
+      if (!CrossesCover[i]) Line = Candidates[i];
     if (Line.get() == nullptr) {
       clsPdfLaDebug::instance().showDebugImage(
           this, "Item NO LINE", DEBUG_UPSCALE_FACTOR, ResultLines,
@@ -392,16 +1246,295 @@ clsPdfLaInternals::findPageLinesAndFigures(const DocItemPtrVector_t &_docItems,
     Line->BoundingBox.unionWith_(Item->BoundingBox);
     Line->Items.push_back(Item);
   }
-  return std::make_tuple(ResultLines, ResultFigures);
+  return ResultLines;
+}
+
+std::tuple<DocLinePtrVector_t, DocItemPtrVector_t>
+clsPdfLaInternals::findPageLinesAndFigures(const DocItemPtrVector_t &_docItems,
+                                           const stuSize &_pageSize) {
+  auto [SortedChars, Figures, WhitespaceCover] =
+      this->analyzePageItems(_docItems, _pageSize, DocItemPtrVector_t());
+  auto Chars = filter(_docItems, [](const DocItemPtr_t &e) {
+    return e->Type == enuDocItemType::Char;
+  });
+  return std::make_tuple(this->findPageLines(Chars, WhitespaceCover),
+                         Figures);
+}
+
+/**
+ * Splits the chars into the column regions separated by the tall whitespace
+ * covers (gutters). The page is cut into horizontal bands wherever a gutter
+ * starts or ends, and every band is cut at the gutters spanning it, so a
+ * title running across the columns is kept whole. The chars of each region
+ * keep their relative order in _chars.
+ */
+std::vector<DocItemPtrVector_t> splitCharsAtColumnGutters(
+    const DocItemPtrVector_t &_chars,
+    const BoundingBoxPtrVector_t &_whitespaceCover) {
+  constexpr float MIN_GUTTER_HEIGHT_RATIO = 0.5f;
+
+  if (_chars.empty()) return {};
+  float TextTop = _chars.front()->BoundingBox.top();
+  float TextBottom = _chars.front()->BoundingBox.bottom();
+  for (const auto &Item : _chars) {
+    TextTop = std::min(TextTop, Item->BoundingBox.top());
+    TextBottom = std::max(TextBottom, Item->BoundingBox.bottom());
+  }
+
+  auto Gutters = filter(_whitespaceCover, [&](const BoundingBoxPtr_t &e) {
+    return e->height() >= MIN_GUTTER_HEIGHT_RATIO * (TextBottom - TextTop);
+  });
+  if (Gutters.empty()) return {_chars};
+
+  std::vector<float> BandBoundaries{TextTop, TextBottom};
+  for (const auto &Gutter : Gutters) {
+    if (Gutter->top() > TextTop && Gutter->top() < TextBottom)
+      BandBoundaries.push_back(Gutter->top());
+    if (Gutter->bottom() > TextTop && Gutter->bottom() < TextBottom)
+      BandBoundaries.push_back(Gutter->bottom());
+  }
+  std::sort(BandBoundaries.begin(), BandBoundaries.end());
+  BandBoundaries.erase(
+      std::unique(BandBoundaries.begin(), BandBoundaries.end()),
+      BandBoundaries.end());
+  if (BandBoundaries.size() < 2) return {_chars};
+
+  size_t NumberOfBands = BandBoundaries.size() - 1;
+  std::vector<std::vector<float>> BandSplits(NumberOfBands);
+  std::vector<size_t> BandFirstRegion(NumberOfBands, 0);
+  size_t NumberOfRegions = 0;
+  for (size_t Band = 0; Band < NumberOfBands; ++Band) {
+    float Middle = (BandBoundaries[Band] + BandBoundaries[Band + 1]) / 2;
+    for (const auto &Gutter : Gutters)
+      if (Gutter->top() <= Middle && Gutter->bottom() >= Middle)
+        BandSplits[Band].push_back(Gutter->centerX());
+    std::sort(BandSplits[Band].begin(), BandSplits[Band].end());
+    BandFirstRegion[Band] = NumberOfRegions;
+    NumberOfRegions += BandSplits[Band].size() + 1;
+  }
+
+  std::vector<DocItemPtrVector_t> Regions(NumberOfRegions);
+  for (const auto &Item : _chars) {
+    auto Y = Item->BoundingBox.centerY();
+    size_t Band = static_cast<size_t>(
+        std::upper_bound(BandBoundaries.begin(), BandBoundaries.end(), Y) -
+        BandBoundaries.begin());
+    Band = std::min(std::max(Band, static_cast<size_t>(1)), NumberOfBands) - 1;
+    const auto &Splits = BandSplits[Band];
+    size_t Column = static_cast<size_t>(
+        std::upper_bound(Splits.begin(), Splits.end(),
+                         Item->BoundingBox.centerX()) -
+        Splits.begin());
+    Regions[BandFirstRegion[Band] + Column].push_back(Item);
+  }
+  return filter(std::move(Regions),
+                [](const DocItemPtrVector_t &e) { return e.size() > 0; });
+}
+
+/**
+ * Fallback of the line and block search for pages over their time budget: the
+ * chars of each column region are swept once in vertical order into lines and
+ * the region becomes a single text block.
+ */
+DocBlockPtrVector_t findColumnTextBlocks(
+    const DocItemPtrVector_t &_sortedChars,
+    const BoundingBoxPtrVector_t &_whitespaceCover) {
+  DocBlockPtrVector_t Result;
+  for (const auto &RegionChars :
+       splitCharsAtColumnGutters(_sortedChars, _whitespaceCover)) {
+    clsDocBlockPtr Block;
+    Block.reset(new stuDocTextBlock);
+    Block->BoundingBox = RegionChars.front()->BoundingBox;
+    DocLinePtr_t Line = nullptr;
+    for (const auto &Item : RegionChars) {
+      if (Line.get() == nullptr || !itemBelongsToLine(Item, Line)) {
+        Line = std::make_shared<stuDocLine>();
+        Line->BoundingBox = Item->BoundingBox;
+        Block.asText()->Lines.push_back(Line);
+      }
+      Line->BoundingBox.unionWith_(Item->BoundingBox);
+      Line->Items.push_back(Item);
+      Block->BoundingBox.unionWith_(Item->BoundingBox);
+    }
+    Result.push_back(Block);
+  }
+  return Result;
+}
+
+/**
+ * Text blocks of the fast segmentation mode, by recursive XY-cut. A region is
+ * cut at all the gaps of its projection profile on the axis with the widest
+ * gap (relative to the minimum gap of that axis), and a region without such
+ * gaps becomes a text block, whose lines are the slabs of its vertical profile.
+ * The figures take part in the profiles, so no block spans over them, but only
+ * the chars end up in blocks.
+ *
+ * The items of a region are kept sorted along both axes and partitioned
+ * stably at each cut, so the profiles are linear sweeps after the initial
+ * (radix) sorts. The blocks come out in the reading order of the cuts.
+ */
+DocBlockPtrVector_t findXYCutTextBlocks(const DocItemPtrVector_t &_sortedChars,
+                                        const DocItemPtrVector_t &_figures) {
+  //@NOTE: Relative to the median char height. Vertical gaps split paragraphs
+  //       while horizontal ones must be wider than any word gap to only split
+  //       columns.
+  constexpr float MIN_XYCUT_VERTICAL_GAP = 1.f;
+  constexpr float MIN_XYCUT_HORIZONTAL_GAP = 3.f;
+
+  DocBlockPtrVector_t Result;
+  if (_sortedChars.empty()) return Result;
+
+  std::vector<float> Heights = map(_sortedChars, [](const DocItemPtr_t &e) {
+    return e->BoundingBox.height();
+  });
+  std::nth_element(Heights.begin(), Heights.begin() + Heights.size() / 2,
+                   Heights.end());
+  float CharHeight = std::max(Heights[Heights.size() / 2], MIN_ITEM_SIZE);
+
+  //@NOTE: Chars come first, so indices below the number of chars are chars
+  DocItemPtrVector_t Items = _sortedChars;
+  Items.insert(Items.end(), _figures.begin(), _figures.end());
+  auto isChar = [&](uint32_t _index) { return _index < _sortedChars.size(); };
+
+  struct stuRegion {
+    std::vector<uint32_t> ByTop, ByLeft;
+  };
+  stuRegion Page;
+  Page.ByTop = radixSortIndices(map(Items, [](const DocItemPtr_t &e) {
+    return packSortKey(e->BoundingBox.top(), e->BoundingBox.left(),
+                       SORT_KEY_QUANTUM);
+  }));
+  Page.ByLeft = radixSortIndices(map(Items, [](const DocItemPtr_t &e) {
+    return packSortKey(e->BoundingBox.left(), e->BoundingBox.top(),
+                       SORT_KEY_QUANTUM);
+  }));
+
+  // Cut positions at the gaps of the profile and the widest gap
+  auto findGaps = [&](const std::vector<uint32_t> &_sorted, bool _vertical,
+                      float _minGap) {
+    auto begin = [&](uint32_t i) {
+      return _vertical ? Items[i]->BoundingBox.top()
+                       : Items[i]->BoundingBox.left();
+    };
+    auto end = [&](uint32_t i) {
+      return _vertical ? Items[i]->BoundingBox.bottom()
+                       : Items[i]->BoundingBox.right();
+    };
+    std::vector<float> Cuts;
+    float WidestGap = 0;
+    float Reach = end(_sorted.front());
+    for (size_t i = 1; i < _sorted.size(); ++i) {
+      float Gap = begin(_sorted[i]) - Reach;
+      if (Gap >= _minGap) {
+        Cuts.push_back(Reach + Gap / 2);
+        WidestGap = std::max(WidestGap, Gap);
+      }
+      Reach = std::max(Reach, end(_sorted[i]));
+    }
+    return std::make_tuple(Cuts, WidestGap / _minGap);
+  };
+  auto splitRegion = [&](const stuRegion &_region,
+                         const std::vector<float> &_cuts, bool _vertical) {
+    auto partOf = [&](uint32_t i) {
+      float Begin = _vertical ? Items[i]->BoundingBox.top()
+                              : Items[i]->BoundingBox.left();
+      return static_cast<size_t>(
+          std::upper_bound(_cuts.begin(), _cuts.end(), Begin) - _cuts.begin());
+    };
+    std::vector<stuRegion> Parts(_cuts.size() + 1);
+    for (auto Index : _region.ByTop)
+      Parts[partOf(Index)].ByTop.push_back(Index);
+    for (auto Index : _region.ByLeft)
+      Parts[partOf(Index)].ByLeft.push_back(Index);
+    return Parts;
+  };
+
+  std::vector<stuRegion> Stack;
+  Stack.push_back(std::move(Page));
+  while (Stack.size()) {
+    stuRegion Region = std::move(Stack.back());
+    Stack.pop_back();
+
+    auto [VerticalCuts, VerticalGap] = findGaps(
+        Region.ByTop, true, MIN_XYCUT_VERTICAL_GAP * CharHeight);
+    auto [HorizontalCuts, HorizontalGap] = findGaps(
+        Region.ByLeft, false, MIN_XYCUT_HORIZONTAL_GAP * CharHeight);
+
+    if (VerticalCuts.empty() && HorizontalCuts.empty()) {
+      clsDocBlockPtr Block;
+      auto LineCuts = std::get<0>(findGaps(Region.ByTop, true, MIN_ITEM_SIZE));
+      for (const auto &Slab : splitRegion(Region, LineCuts, true)) {
+        DocLinePtr_t Line = nullptr;
+        for (auto Index : Slab.ByLeft) {
+          if (!isChar(Index)) continue;
+          const auto &Item = Items[Index];
+          if (Line.get() == nullptr) {
+            Line = std::make_shared<stuDocLine>();
+            Line->BoundingBox = Item->BoundingBox;
+            if (Block.get() == nullptr) {
+              Block.reset(new stuDocTextBlock);
+              Block->BoundingBox = Item->BoundingBox;
+            }
+            Block.asText()->Lines.push_back(Line);
+          }
+          Line->BoundingBox.unionWith_(Item->BoundingBox);
+          Line->Items.push_back(Item);
+        }
+        if (Line.get() != nullptr)
+          Block->BoundingBox.unionWith_(Line->BoundingBox);
+      }
+      if (Block.get() != nullptr) Result.push_back(Block);
+      continue;
+    }
+
+    bool Vertical = VerticalGap >= HorizontalGap;
+    auto Parts =
+        splitRegion(Region, Vertical ? VerticalCuts : HorizontalCuts, Vertical);
+    //@NOTE: Pushed in reverse to be popped top to bottom, left to right
+    for (auto Part = Parts.rbegin(); Part != Parts.rend(); ++Part)
+      Stack.push_back(std::move(*Part));
+  }
+  return Result;
+}
+
+DocBlockPtrVector_t clsPdfLaInternals::findPageTextBlocksByColumns(
+    const DocItemPtrVector_t &_contentOrderChars,
+    const DocItemPtrVector_t &_pageFigures,
+    const BoundingBoxPtrVector_t &_whitespaceCover) {
+  //@NOTE: findPageLines joins the runs of the content stream, so each region
+  //       keeps the content order rather than the geometric one
+  auto Regions =
+      splitCharsAtColumnGutters(_contentOrderChars, _whitespaceCover);
+  auto findRegionBlocks = [&](const DocItemPtrVector_t &_regionChars) {
+    return this->findPageTextBlocks(
+        this->findPageLines(_regionChars, _whitespaceCover), _pageFigures);
+  };
+
+  auto ThreadPool = this->intraPageThreadPool();
+  std::vector<std::future<DocBlockPtrVector_t>> RegionBlocks;
+  for (size_t i = 1; i < Regions.size(); ++i)
+    RegionBlocks.push_back(ThreadPool->submit(
+        [&, i]() { return findRegionBlocks(Regions[i]); }));
+
+  DocBlockPtrVector_t Result;
+  if (Regions.size()) Result = findRegionBlocks(Regions.front());
+  for (auto &Future : RegionBlocks) {
+    auto Blocks = ThreadPool->wait(Future);
+    Result.insert(Result.end(), Blocks.begin(), Blocks.end());
+  }
+  return Result;
 }
 
 DocBlockPtrVector_t clsPdfLaInternals::findPageTextBlocks(
     const DocLinePtrVector_t &_pageLines,
     const DocItemPtrVector_t &_pageFigures) {
+  //@NOTE: A strict weak ordering, unlike ordering the lines by top only when
+  //       they overlap horizontally. The order of the blocks is set later by
+  //       sortBlocksInReadingOrder.
   auto SortedLines = _pageLines;
   std::sort(SortedLines.begin(), SortedLines.end(),
             [&](const DocLinePtr_t &a, const DocLinePtr_t &b) {
-              if (a->BoundingBox.horizontalOverlap(b->BoundingBox))
+              if (a->BoundingBox.top() != b->BoundingBox.top())
                 return a->BoundingBox.top() < b->BoundingBox.top();
               return a->BoundingBox.left() < b->BoundingBox.left();
             });
@@ -411,6 +1544,7 @@ DocBlockPtrVector_t clsPdfLaInternals::findPageTextBlocks(
 
   DocBlockPtrVector_t Result;
   for (auto &Line : SortedLines) {
+    if (this->pageBudgetExceeded()) break;
     clsDocBlockPtr Block{nullptr};
     for (auto &ResultItem : Result)
       if (ResultItem->BoundingBox.horizontalOverlap(Line->BoundingBox) >= 5) {
@@ -463,6 +1597,117 @@ size_t clsPdfLaInternals::pageCount() {
   return this->PdfiumWrapper->pageCount();
 }
 
+void clsPdfLaInternals::setOptions(const stuPdfLaOptions &_options) {
+  this->Options = _options;
+  //@NOTE: State of the stages the document no longer uses is released, calls
+  //       with their own options build it again
+  if (!_options.UseIntraPageParallelism) this->IntraPageThreadPool.reset();
+  if (!_options.ReuseLayoutTemplates) this->LayoutTemplateCache.reset();
+}
+
+clsThreadPool *clsPdfLaInternals::intraPageThreadPool() {
+  if (!this->PageOptions.UseIntraPageParallelism) return nullptr;
+  if (this->IntraPageThreadPool.get() == nullptr ||
+      this->IntraPageNumberOfThreads != this->PageOptions.NumberOfThreads) {
+    this->IntraPageThreadPool.reset(
+        new clsThreadPool(this->PageOptions.NumberOfThreads));
+    this->IntraPageNumberOfThreads = this->PageOptions.NumberOfThreads;
+  }
+  return this->IntraPageThreadPool.get();
+}
+
+clsLayoutTemplateCache *clsPdfLaInternals::layoutTemplateCache() {
+  if (!this->PageOptions.ReuseLayoutTemplates) return nullptr;
+  if (this->LayoutTemplateCache.get() == nullptr)
+    this->LayoutTemplateCache.reset(new clsLayoutTemplateCache);
+  return this->LayoutTemplateCache.get();
+}
+
+//@NOTE: Called from the intra-page threads too, hence the atomic flags
+bool clsPdfLaInternals::pageBudgetExceeded() {
+  if (this->PageBudgetExceeded.load(std::memory_order_relaxed)) return true;
+  if (std::chrono::steady_clock::now() < this->PageDeadline) return false;
+  this->PageIsDegraded.store(true, std::memory_order_relaxed);
+  this->PageBudgetExceeded.store(true, std::memory_order_relaxed);
+  return true;
+}
+
+DocItemPtrVector_t clsPdfLaInternals::getPageItems(size_t _pageIndex,
+                                                   bool _cache) {
+  auto CachedItems = this->PageItemCache.find(_pageIndex);
+  if (CachedItems == this->PageItemCache.end()) {
+    auto Items = filter(this->PdfiumWrapper->getPageItems(_pageIndex),
+                        [](const DocItemPtr_t &e) {
+                          return e->BoundingBox.width() > MIN_ITEM_SIZE &&
+                                 e->BoundingBox.height() > MIN_ITEM_SIZE;
+                        });
+    if (_cache == false) return Items;
+
+    CompactDocItemVector_t CompactItems;
+    CompactItems.reserve(Items.size());
+    for (const auto &Item : Items)
+      CompactItems.push_back(stuCompactDocItem::fromDocItem(*Item));
+    CachedItems =
+        this->PageItemCache.emplace(_pageIndex, std::move(CompactItems)).first;
+  }
+
+  //@NOTE: Cached pages are always served from the compact items (even on the
+  //       pass that filled the cache) so every analysis sees the same values
+  DocItemPtrVector_t Result;
+  Result.reserve(CachedItems->second.size());
+  for (const auto &Item : CachedItems->second)
+    Result.push_back(Item.toDocItem());
+  return Result;
+}
+
+const clsPageFurnitureIndex &clsPdfLaInternals::pageFurnitureIndex() {
+  if (this->PageFurnitureIndex.get() == nullptr) {
+    this->PageFurnitureIndex.reset(new clsPageFurnitureIndex);
+    std::vector<size_t> PageIndexes(this->pageCount());
+    std::iota(PageIndexes.begin(), PageIndexes.end(), 0);
+    auto Fingerprints = this->mapPageItems(
+        PageIndexes, &clsPageFurnitureIndex::pageFingerprints);
+    for (size_t PageIndex = 0; PageIndex < Fingerprints.size(); ++PageIndex)
+      this->PageFurnitureIndex->addPage(PageIndex, Fingerprints[PageIndex]);
+  }
+  return *this->PageFurnitureIndex;
+}
+
+DocBlockPtrVector_t clsPdfLaInternals::separatePageFurniture(
+    size_t _pageIndex, DocItemPtrVector_t &_docItems,
+    const stuSize &_pageSize) {
+  DocBlockPtrVector_t Result;
+  if (!this->PageOptions.DetectPageFurniture || this->pageCount() < 2)
+    return Result;
+
+  auto RepeatedElements = this->pageFurnitureIndex().findRepeatedElements(
+      _pageIndex, _docItems, _pageSize);
+  if (RepeatedElements.empty()) return Result;
+
+  filter_inplace(_docItems, [](const DocItemPtr_t &e) {
+    return e->RepetitionPageOffset == 0;
+  });
+
+  for (auto &Element : RepeatedElements) {
+    clsDocBlockPtr Block;
+    if (Element.Items.front()->Type == enuDocItemType::Char) {
+      Block.reset(new stuDocTextBlock);
+      auto Line = std::make_shared<stuDocLine>();
+      Line->BoundingBox = Element.BoundingBox;
+      Line->Baseline = Element.Items.front()->Baseline;
+      Line->Items = std::move(Element.Items);
+      Block.asText()->Lines.push_back(Line);
+    } else {
+      Block.reset(new stuDocFigureBlock);
+      Block->Elements = std::move(Element.Items);
+    }
+    Block->BoundingBox = Element.BoundingBox;
+    Block->Area = Element.Area;
+    Result.push_back(Block);
+  }
+  return Result;
+}
+
 stuSize clsPdfLaInternals::getPageSize(size_t _pageIndex) {
   return this->PdfiumWrapper->getPageSize(_pageIndex);
 }
@@ -482,8 +1727,92 @@ std::vector<uint8_t> clsPdfLaInternals::renderPageImage(
   return Data;
 }
 
-DocBlockPtrVector_t clsPdfLaInternals::getPageBlocks(size_t _pageIndex) {
+PageResultKey_t clsPdfLaInternals::pageResultCacheKey(size_t _pageIndex) {
+  const auto &Options = this->PageOptions;
+  auto floatBits = [](float _value) {
+    uint32_t Bits;
+    std::memcpy(&Bits, &_value, sizeof(Bits));
+    return static_cast<uint64_t>(Bits);
+  };
+  PageResultKey_t Key{
+      PAGE_RESULT_CACHE_VERSION,
+      this->PdfiumWrapper->getPageContentHash(_pageIndex),
+      static_cast<uint64_t>(
+          (Options.DetectPageFurniture ? 1 : 0) |
+          (Options.UseDocumentStatistics ? 2 : 0) |
+          (Options.UseIntraPageParallelism ? 4 : 0) |
+          (Options.ReuseLayoutTemplates ? 8 : 0) |
+          (Options.SegmentationMode == enuSegmentationMode::XYCut ? 16 : 0) |
+          (Options.DetectTables ? 32 : 0)),
+      static_cast<uint64_t>(Options.MaxCovers),
+      static_cast<uint64_t>(Options.MaxCoverCandidates),
+      floatBits(Options.MinCoverArea),
+      floatBits(Options.WordSeparationThresholdMultiplier),
+      floatBits(Options.MaxImageBlobAreaFactor)};
+  //@NOTE: Furniture and document statistics depend on the other pages too
+  if (Options.DetectPageFurniture || Options.UseDocumentStatistics) {
+    if (this->DocumentContentHash == 0) {
+      uint64_t DocumentHash = this->pageCount();
+      for (size_t i = 0; i < this->pageCount(); ++i)
+        hashCombine(DocumentHash, this->PdfiumWrapper->getPageContentHash(i));
+      this->DocumentContentHash = DocumentHash | 1;
+    }
+    Key.push_back(this->DocumentContentHash);
+  }
+  return Key;
+}
+
+// Adds the non text blocks to the text blocks and sorts them in reading order
+DocBlockPtrVector_t completePageBlocks(
+    DocBlockPtrVector_t &_blocks, const DocBlockPtrVector_t &_tableBlocks,
+    const DocItemPtrVector_t &_figures,
+    const DocBlockPtrVector_t &_furnitureBlocks) {
+  _blocks.insert(_blocks.end(), _tableBlocks.begin(), _tableBlocks.end());
+  for (const auto Item : _figures) {
+    clsDocBlockPtr FigureBlock;
+    FigureBlock.reset(new stuDocFigureBlock);
+    FigureBlock->BoundingBox = Item->BoundingBox;
+    _blocks.push_back(FigureBlock);
+  }
+  _blocks.insert(_blocks.end(), _furnitureBlocks.begin(),
+                 _furnitureBlocks.end());
+  sortBlocksInReadingOrder(_blocks);
+  return _blocks;
+}
+
+DocBlockPtrVector_t clsPdfLaInternals::getPageBlocks(
+    size_t _pageIndex, const stuPdfLaOptions &_options, bool *_isDegraded) {
   clsPdfLaDebug::instance().setCurrentPageIndex(this, _pageIndex);
+  this->PageOptions = _options;
+  if (_isDegraded != nullptr) *_isDegraded = false;
+
+  DocBlockPtrVector_t Blocks;
+  auto &Cache = clsPageResultCache::instance();
+  bool UseCache =
+      Cache.isEnabled() && !clsPdfLaDebug::instance().isObjectRegister(this);
+  //@NOTE: The key is computed from the raw page objects, so a hit never
+  //       parses the page content
+  PageResultKey_t Key;
+  if (UseCache) {
+    Key = this->pageResultCacheKey(_pageIndex);
+    if (Cache.find(Key, Blocks)) return Blocks;
+  }
+  Blocks = this->analyzePageBlocks(_pageIndex);
+  bool IsDegraded = this->PageIsDegraded;
+  if (_isDegraded != nullptr) *_isDegraded = IsDegraded;
+  //@NOTE: Degraded results depend on timing, so they are never shared
+  if (UseCache && !IsDegraded) Cache.add(Key, Blocks);
+  return Blocks;
+}
+
+DocBlockPtrVector_t clsPdfLaInternals::analyzePageBlocks(size_t _pageIndex) {
+  const auto &Options = this->PageOptions;
+  this->PageBudgetExceeded = false;
+  this->PageIsDegraded = false;
+  this->PageDeadline = Options.PageTimeBudget.count() > 0
+                           ? std::chrono::steady_clock::now() +
+                                 Options.PageTimeBudget
+                           : std::chrono::steady_clock::time_point::max();
 
   auto PageSize = this->getPageSize(_pageIndex);
 
@@ -500,36 +1829,93 @@ DocBlockPtrVector_t clsPdfLaInternals::getPageBlocks(size_t _pageIndex) {
     }
   }
 
-  auto Items = filter(this->PdfiumWrapper->getPageItems(_pageIndex),
-                      [](const DocItemPtr_t &e) {
-                        return e->BoundingBox.width() > MIN_ITEM_SIZE &&
-                               e->BoundingBox.height() > MIN_ITEM_SIZE;
-                      });
-  auto [Lines, Figures] =
-      std::move(this->findPageLinesAndFigures(Items, PageSize));
-  auto Blocks = this->findPageTextBlocks(Lines, Figures);
-  for (const auto Item : Figures) {
-    clsDocBlockPtr FigureBlock;
-    FigureBlock.reset(new stuDocFigureBlock);
-    FigureBlock->BoundingBox = Item->BoundingBox;
-    Blocks.push_back(FigureBlock);
+  auto Items = this->getPageItems(_pageIndex);
+  auto FurnitureBlocks =
+      this->separatePageFurniture(_pageIndex, Items, PageSize);
+  auto TableBlocks =
+      Options.DetectTables ? extractPageTables(Items) : DocBlockPtrVector_t();
+  //@NOTE: The text around a table must not merge across it, now that the
+  //       items of the table are gone
+  auto Separators = tableSeparators(TableBlocks);
+  auto withSeparators = [&](DocItemPtrVector_t _figures) {
+    _figures.insert(_figures.end(), Separators.begin(), Separators.end());
+    return _figures;
+  };
+
+  if (Options.SegmentationMode == enuSegmentationMode::XYCut) {
+    auto [SortedChars, SortedFigures] = this->sortPageItems(Items);
+    auto Figures = this->findPageFigures(SortedFigures, PageSize);
+    auto Blocks = findXYCutTextBlocks(SortedChars, withSeparators(Figures));
+    this->PageDeadline = std::chrono::steady_clock::time_point::max();
+    return completePageBlocks(Blocks, TableBlocks, Figures, FurnitureBlocks);
   }
-  return Blocks;
+
+  auto [SortedChars, Figures, WhitespaceCover] =
+      this->analyzePageItems(Items, PageSize, Separators);
+  auto Blockers = withSeparators(Figures);
+  auto ContentOrderChars = filter(Items, [](const DocItemPtr_t &e) {
+    return e->Type == enuDocItemType::Char;
+  });
+  DocBlockPtrVector_t Blocks;
+  if (this->intraPageThreadPool() != nullptr &&
+      ContentOrderChars.size() >= MIN_CHARS_FOR_INTRA_PAGE_PARALLELISM &&
+      !clsPdfLaDebug::instance().isObjectRegister(this))
+    Blocks = this->findPageTextBlocksByColumns(ContentOrderChars, Blockers,
+                                               WhitespaceCover);
+  else
+    Blocks = this->findPageTextBlocks(
+        this->findPageLines(ContentOrderChars, WhitespaceCover), Blockers);
+
+  //@NOTE: The searches above stop at the deadline with partial results, which
+  //       are replaced by the single pass fallback
+  if (this->PageBudgetExceeded)
+    Blocks = findColumnTextBlocks(SortedChars, WhitespaceCover);
+  this->PageDeadline = std::chrono::steady_clock::time_point::max();
+  this->PageBudgetExceeded = false;
+
+  return completePageBlocks(Blocks, TableBlocks, Figures, FurnitureBlocks);
 }
 
 DocBlockPtrVector_t clsPdfLaInternals::getTextBlocks(size_t _pageIndex) {
   clsPdfLaDebug::instance().setCurrentPageIndex(this, _pageIndex);
+  this->PageOptions = this->Options;
 
   auto PageSize = this->getPageSize(_pageIndex);
   auto Items = this->PdfiumWrapper->getPageItems(_pageIndex);
+  auto FurnitureBlocks =
+      this->separatePageFurniture(_pageIndex, Items, PageSize);
   auto [Lines, Figures] =
       std::move(this->findPageLinesAndFigures(Items, PageSize));
-  return this->findPageTextBlocks(Lines, Figures);
+  auto Blocks = this->findPageTextBlocks(Lines, Figures);
+  for (const auto &Block : FurnitureBlocks)
+    if (Block->Type == enuDocBlockType::Text) Blocks.push_back(Block);
+  sortBlocksInReadingOrder(Blocks);
+  return Blocks;
+}
+
+std::vector<stuEmbeddedImage> clsPdfLaInternals::getEmbeddedImages(
+    size_t _pageIndex, const stuBoundingBox &_region) {
+  return this->PdfiumWrapper->getPageImages(_pageIndex, _region);
 }
 
 void setDebugOutputPath(const std::string &_path) {
   clsPdfLaDebug::instance().setDebugOutputPath(_path);
 }
 
+void configurePageResultCache(size_t _maxMemoryBytes,
+                              const std::string &_diskPath,
+                              size_t _maxDiskBytes) {
+  clsPageResultCache::instance().configure(_maxMemoryBytes, _diskPath,
+                                           _maxDiskBytes);
+}
+
+stuPageResultCacheStats getPageResultCacheStats() {
+  return clsPageResultCache::instance().stats();
+}
+
+void setAsyncConcurrency(size_t _numberOfThreads) {
+  clsAsyncExecutor::instance().setNumberOfThreads(_numberOfThreads);
+}
+
 }  // namespace PDFLA
 }  // namespace Targoman
\ No newline at end of file
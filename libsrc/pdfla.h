@@ -1,6 +1,12 @@
 #ifndef __TARGOMAN_PDFLA__
 #define __TARGOMAN_PDFLA__
 
+#include <array>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <map>
+
 #include "dla.h"
 
 namespace Targoman {
@@ -8,17 +14,148 @@ namespace PDFLA {
 
 void setDebugOutputPath(const std::string& _path);
 
+struct stuPageResultCacheStats {
+  uint64_t Hits;
+  uint64_t Misses;
+  size_t MemoryEntries;
+  size_t MemoryBytes;
+  size_t DiskEntries;
+  size_t DiskBytes;
+
+  stuPageResultCacheStats()
+      : Hits(0), Misses(0), MemoryEntries(0), MemoryBytes(0), DiskEntries(0),
+        DiskBytes(0) {}
+  double hitRate() const {
+    return Hits + Misses > 0 ? static_cast<double>(Hits) / (Hits + Misses)
+                             : 0.;
+  }
+};
+
+// Shares the analyzed blocks of pages with identical content (and options)
+// across all documents of the process. Entries are kept in up to
+// `_maxMemoryBytes` of memory and, when `_diskPath` is given, in up to
+// `_maxDiskBytes` of files in that directory which survive restarts.
+// Zero sizes disable the cache.
+void configurePageResultCache(size_t _maxMemoryBytes,
+                              const std::string& _diskPath = std::string(),
+                              size_t _maxDiskBytes = 0);
+stuPageResultCacheStats getPageResultCacheStats();
+
+// Number of threads running the asynchronous calls of all documents, zero
+// means one per hardware thread. Only effective before the first such call.
+// PDFium is called by one thread at a time across all documents, so only the
+// layout analysis of different documents runs concurrently.
+void setAsyncConcurrency(size_t _numberOfThreads);
+
+// How getPageBlocks segments the text of a page
+enum class enuSegmentationMode {
+  // Lines and blocks are grown item by item inside the whitespace cover of
+  // the page. Accurate but slow on dense pages.
+  WhitespaceCover,
+  // Recursive XY-cut on the projection profiles of the page items, in
+  // O(n log n). Much faster, but misses the blocks that no straight cut
+  // through the whole region separates.
+  XYCut
+};
+
+/**
+ * Tuning of the layout analysis, to trade accuracy for speed on different
+ * workloads. Default constructed options are the balanced preset, which is
+ * also what documents use unless told otherwise.
+ */
+struct stuPdfLaOptions {
+  enuSegmentationMode SegmentationMode;
+  // Optional stages, see the enable methods of clsPdfLa
+  bool DetectTables;
+  bool DetectPageFurniture;
+  bool UseDocumentStatistics;
+  bool ReuseLayoutTemplates;
+  bool UseIntraPageParallelism;
+  // Threads of the intra-page parallelism, zero means one per hardware thread
+  size_t NumberOfThreads;
+  // See clsPdfLa::setPageTimeBudget, zero disables the budget
+  std::chrono::milliseconds PageTimeBudget;
+
+  // Whitespace covers searched on each page, largest first
+  size_t MaxCovers;
+  float MinCoverArea;
+  // Candidate rectangles kept by the search of each cover, zero for no limit.
+  // Past the limit the least promising ones are dropped, so the search may
+  // settle for a smaller cover than the largest one.
+  size_t MaxCoverCandidates;
+  // Chars are in one word when their gap is below this multiple of the most
+  // common gap between the chars of their page, or of their font size with
+  // document statistics
+  float WordSeparationThresholdMultiplier;
+  // Images and paths larger than this fraction of the page (e.g. backgrounds)
+  // are not obstacles to the whitespace cover
+  float MaxImageBlobAreaFactor;
+
+  stuPdfLaOptions();
+
+  // XY-cut segmentation without tables. The whitespace cover, and so the
+  // cover search limits, template reuse and intra-page parallelism, are not
+  // used by XY-cut.
+  static stuPdfLaOptions fast();
+  static stuPdfLaOptions balanced();
+  // Exhaustive cover search with more covers, and the document level passes
+  // for page furniture and word gap statistics
+  static stuPdfLaOptions accurate();
+};
+
+// An image XObject (or inline image) of a page with its stream data exactly as
+// stored in the file, i.e. still encoded by its filters. Color spaces are only
+// named, so images in parameterized ones (Indexed, ICCBased, Separation,
+// DeviceN, ...) cannot be reproduced from these fields alone.
+struct stuEmbeddedImage {
+  // Maps the unit square of the image onto the page, as (a, b, c, d, e, f) in
+  // the coordinates of the layout (origin at the top left of the page)
+  std::array<float, 6> Placement;
+  // Visible part of the image on the page
+  Targoman::DLA::stuBoundingBox BoundingBox;
+  int32_t Width, Height;
+  int32_t BitsPerComponent;
+  // Name of the color space, or of its family for parameterized ones
+  std::string ColorSpace;
+  // Filters in decoding order (e.g. FlateDecode, DCTDecode), each with the
+  // numeric and boolean entries of its DecodeParms
+  std::vector<std::string> Filters;
+  std::vector<std::map<std::string, int32_t>> DecodeParams;
+  // The decoded JBIG2Globals stream of a JBIG2Decode filter, if any
+  std::vector<uint8_t> JBIG2Globals;
+  // The Decode array, empty for the default mapping
+  std::vector<float> Decode;
+  // Stencil masks are painted in the fill color and have no color space
+  bool IsImageMask;
+  // SMask and Mask streams, as images placed like the one they mask
+  std::shared_ptr<stuEmbeddedImage> SoftMask;
+  std::shared_ptr<stuEmbeddedImage> Mask;
+  // A Mask array: the min and max of each color component to mask out
+  std::vector<int32_t> ColorKeyMask;
+  std::vector<uint8_t> Data;
+
+  stuEmbeddedImage()
+      : Width(0), Height(0), BitsPerComponent(0), IsImageMask(false) {}
+};
+
 class clsPdfLaInternals;
 class clsPdfLa {
  private:
   std::unique_ptr<clsPdfLaInternals> Internals;
 
  public:
-  clsPdfLa(uint8_t *_data, size_t _size);
+  clsPdfLa(uint8_t *_data, size_t _size,
+           const stuPdfLaOptions &_options = stuPdfLaOptions());
   ~clsPdfLa();
 
+  // False for malformed data, which has no pages to analyze
+  bool isLoaded() const;
   size_t pageCount();
 
+  // Options of the calls that are not given their own
+  void setOptions(const stuPdfLaOptions &_options);
+  stuPdfLaOptions options();
+
  public:
   Targoman::DLA::stuSize getPageSize(size_t _pageIndex);
   std::vector<uint8_t> renderPageImage(
@@ -26,8 +163,88 @@ class clsPdfLa {
       const Targoman::DLA::stuSize &_renderSize);
 
  public:
-  Targoman::DLA::DocBlockPtrVector_t getPageBlocks(size_t _pageIndex);
+  // `_isDegraded`, when given, is set to whether the page exceeded its time
+  // budget and got a coarser result (see setPageTimeBudget)
+  Targoman::DLA::DocBlockPtrVector_t getPageBlocks(size_t _pageIndex,
+                                                   bool *_isDegraded = nullptr);
+  // With the document options but another segmentation mode
+  Targoman::DLA::DocBlockPtrVector_t getPageBlocks(
+      size_t _pageIndex, enuSegmentationMode _mode,
+      bool *_isDegraded = nullptr);
+  Targoman::DLA::DocBlockPtrVector_t getPageBlocks(
+      size_t _pageIndex, const stuPdfLaOptions &_options,
+      bool *_isDegraded = nullptr);
   Targoman::DLA::DocBlockPtrVector_t getTextBlocks(size_t _pageIndex);
+  // Embedded images drawn over the region (e.g. of a figure block), read from
+  // the file without decoding or rendering them
+  std::vector<stuEmbeddedImage> getEmbeddedImages(
+      size_t _pageIndex, const Targoman::DLA::stuBoundingBox &_region);
+
+ public:
+  // Queued on the shared executor and run in order, one at a time for each
+  // document. Callbacks are called on the executor threads and must not
+  // destroy the document, which waits for its queued calls when destroyed.
+  // Calls without options of their own use those of the document when they
+  // are run. Exceptions of the analysis are rethrown by the futures, while
+  // the callbacks are skipped on them. Exceptions thrown by a callback are
+  // discarded. Neither stops the calls queued after them. `_isDegraded` is set
+  // before the future is ready or the callback is called, so it must outlive
+  // the call.
+  std::future<Targoman::DLA::DocBlockPtrVector_t> getPageBlocksAsync(
+      size_t _pageIndex, bool *_isDegraded = nullptr);
+  std::future<Targoman::DLA::DocBlockPtrVector_t> getPageBlocksAsync(
+      size_t _pageIndex, enuSegmentationMode _mode,
+      bool *_isDegraded = nullptr);
+  std::future<Targoman::DLA::DocBlockPtrVector_t> getPageBlocksAsync(
+      size_t _pageIndex, const stuPdfLaOptions &_options,
+      bool *_isDegraded = nullptr);
+  void getPageBlocksAsync(
+      size_t _pageIndex,
+      std::function<void(Targoman::DLA::DocBlockPtrVector_t)> _onDone,
+      bool *_isDegraded = nullptr);
+  void getPageBlocksAsync(
+      size_t _pageIndex,
+      std::function<void(Targoman::DLA::DocBlockPtrVector_t)> _onDone,
+      enuSegmentationMode _mode, bool *_isDegraded = nullptr);
+  void getPageBlocksAsync(
+      size_t _pageIndex,
+      std::function<void(Targoman::DLA::DocBlockPtrVector_t)> _onDone,
+      const stuPdfLaOptions &_options, bool *_isDegraded = nullptr);
+  std::future<std::vector<uint8_t>> renderPageImageAsync(
+      size_t _pageIndex, uint32_t _backgroundColor,
+      const Targoman::DLA::stuSize &_renderSize);
+  void renderPageImageAsync(
+      size_t _pageIndex, uint32_t _backgroundColor,
+      const Targoman::DLA::stuSize &_renderSize,
+      std::function<void(std::vector<uint8_t>)> _onDone);
+
+ public:
+  // Each of these sets one field of the document options
+
+  // Runs a document level pass over all pages (on first use) to find the
+  // running headers, footers, sidebars and watermarks. These are returned as
+  // separate blocks with their `Area` set and are skipped by layout analysis.
+  void enablePageFurnitureDetection(bool _enable = true);
+  // Estimates the word separation thresholds (per font size) once from a
+  // sample of the document's pages, instead of a single threshold from each
+  // page alone
+  void enableDocumentStatistics(bool _enable = true);
+  // Builds the lines and blocks of each column of large pages concurrently.
+  // Zero threads means one per hardware thread.
+  void enableIntraPageParallelism(bool _enable = true,
+                                  size_t _numberOfThreads = 0);
+  // Seeds the whitespace analysis of a page with the covers of a recent page
+  // of the same layout, keeping those that still fit and searching only for
+  // the rest. The covers (and so the blocks) of a page may then depend on
+  // which pages were analyzed before it; the page result cache keeps the
+  // result of the first analysis of each page.
+  void enableLayoutTemplateReuse(bool _enable = true);
+  // Bounds the layout analysis time of each page in getPageBlocks. A page that
+  // exceeds it (or has too many graphics for the exact whitespace search) is
+  // finished with coarser strategies, ending with one text block per column,
+  // and reported through the `_isDegraded` argument of getPageBlocks. Zero
+  // disables the budget.
+  void setPageTimeBudget(std::chrono::milliseconds _budget);
 
  public:
   void enableDebugging(const std::string &_basename);
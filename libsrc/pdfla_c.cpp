@@ -0,0 +1,338 @@
+#include "pdfla_c.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+#include "pdfla.h"
+
+using namespace Targoman::DLA;
+using namespace Targoman::PDFLA;
+
+struct pdfla_document {
+  std::unique_ptr<clsPdfLa> PdfLa;
+};
+
+namespace Targoman {
+namespace PDFLA {
+
+static_assert(PDFLA_ITEM_CHAR == static_cast<int>(enuDocItemType::Char) &&
+                  PDFLA_AREA_WATERMARK ==
+                      static_cast<int>(enuDocArea::Watermark) &&
+                  PDFLA_BLOCK_FORMULAE ==
+                      static_cast<int>(enuDocBlockType::Formulae) &&
+                  PDFLA_ASSOCIATION_IS_INSIDE_OF ==
+                      static_cast<int>(enuDocTextBlockAssociation::IsInsideOf),
+              "C enums must follow the C++ ones");
+
+template <typename T>
+class clsFlatIndex {
+ private:
+  std::unordered_map<const void *, uint32_t> Indices;
+  std::vector<T> Objects;
+
+ public:
+  void add(const T &_object) {
+    if (_object.get() != nullptr &&
+        this->Indices.emplace(_object.get(), this->Objects.size()).second)
+      this->Objects.push_back(_object);
+  }
+
+  uint32_t indexOf(const T &_object) const {
+    if (_object.get() == nullptr) return PDFLA_NO_INDEX;
+    return this->Indices.at(_object.get());
+  }
+
+  const std::vector<T> &objects() const { return this->Objects; }
+};
+
+/**
+ * Lays out the blocks of a page as the arrays of a pdfla_layout_header in a
+ * single malloc'ed buffer. Shared lines and items are stored once.
+ */
+class clsFlatLayoutWriter {
+ private:
+  clsFlatIndex<clsDocBlockPtr> Blocks;
+  clsFlatIndex<DocLinePtr_t> Lines;
+  clsFlatIndex<DocItemPtr_t> Items;
+  size_t NumberOfCells;
+  size_t NumberOfIndices;
+  size_t NumberOfChars;
+
+ private:
+  static pdfla_box toBox(const stuBoundingBox &_boundingBox) {
+    return {_boundingBox.left(), _boundingBox.top(), _boundingBox.width(),
+            _boundingBox.height()};
+  }
+  static uint32_t placeArray(pdfla_array &_array, size_t &_offset,
+                             size_t _count, size_t _recordSize) {
+    _array.offset = static_cast<uint32_t>(_offset);
+    _array.count = static_cast<uint32_t>(_count);
+    _array.record_size = static_cast<uint32_t>(_recordSize);
+    _offset += _count * _recordSize;
+    return _array.offset;
+  }
+
+  void collect(const DocBlockPtrVector_t &_pageBlocks);
+
+ public:
+  clsFlatLayoutWriter()
+      : NumberOfCells(0), NumberOfIndices(0), NumberOfChars(0) {}
+  pdfla_layout_header *write(const DocBlockPtrVector_t &_pageBlocks,
+                             const stuSize &_pageSize, bool _isDegraded);
+};
+
+void clsFlatLayoutWriter::collect(const DocBlockPtrVector_t &_pageBlocks) {
+  for (const auto &Block : _pageBlocks) this->Blocks.add(Block);
+  //@NOTE: Referenced blocks are appended while iterating, hence the indices
+  for (size_t i = 0; i < this->Blocks.objects().size(); ++i) {
+    auto Block = this->Blocks.objects()[i];
+    for (const auto &Item : Block->Elements) this->Items.add(Item);
+    this->NumberOfIndices += Block->Elements.size();
+    switch (Block->Type) {
+      case enuDocBlockType::Text:
+        for (const auto &Line : Block.asText()->Lines) {
+          this->Lines.add(Line);
+          for (const auto &Item : Line->Items) this->Items.add(Item);
+        }
+        this->NumberOfIndices += Block.asText()->Lines.size();
+        this->Blocks.add(Block.asText()->AssociatedBlock);
+        break;
+      case enuDocBlockType::Figure:
+        this->Blocks.add(Block.asFigure()->Caption);
+        break;
+      case enuDocBlockType::Table:
+        this->Blocks.add(Block.asTable()->Caption);
+        for (const auto &Cell : Block.asTable()->Cells)
+          this->Blocks.add(Cell.Text);
+        this->NumberOfCells += Block.asTable()->Cells.size();
+        break;
+      case enuDocBlockType::Formulae:
+        this->NumberOfChars += Block.asFormulae()->LatexSource.size();
+        break;
+    }
+  }
+  for (const auto &Line : this->Lines.objects())
+    this->NumberOfIndices += Line->Items.size();
+}
+
+pdfla_layout_header *clsFlatLayoutWriter::write(
+    const DocBlockPtrVector_t &_pageBlocks, const stuSize &_pageSize,
+    bool _isDegraded) {
+  this->collect(_pageBlocks);
+
+  pdfla_layout_header Header;
+  std::memset(&Header, 0, sizeof(Header));
+  size_t Size = sizeof(pdfla_layout_header);
+  placeArray(Header.blocks, Size, this->Blocks.objects().size(),
+             sizeof(pdfla_block));
+  placeArray(Header.lines, Size, this->Lines.objects().size(),
+             sizeof(pdfla_line));
+  placeArray(Header.items, Size, this->Items.objects().size(),
+             sizeof(pdfla_item));
+  placeArray(Header.cells, Size, this->NumberOfCells,
+             sizeof(pdfla_table_cell));
+  placeArray(Header.indices, Size, this->NumberOfIndices, sizeof(uint32_t));
+  placeArray(Header.text, Size, this->NumberOfChars, sizeof(uint32_t));
+  if (Size > UINT32_MAX) return nullptr;
+
+  auto Buffer = static_cast<uint8_t *>(std::calloc(Size, 1));
+  if (Buffer == nullptr) return nullptr;
+  Header.magic = PDFLA_LAYOUT_MAGIC;
+  Header.version = PDFLA_LAYOUT_VERSION;
+  Header.size = static_cast<uint32_t>(Size);
+  Header.header_size = sizeof(pdfla_layout_header);
+  Header.page_width = _pageSize.Width;
+  Header.page_height = _pageSize.Height;
+  Header.is_degraded = _isDegraded ? 1 : 0;
+  Header.page_block_count = static_cast<uint32_t>(_pageBlocks.size());
+  std::memcpy(Buffer, &Header, sizeof(Header));
+
+  auto Items = reinterpret_cast<pdfla_item *>(Buffer + Header.items.offset);
+  for (const auto &Item : this->Items.objects()) {
+    Items->box = toBox(Item->BoundingBox);
+    Items->baseline = Item->Baseline;
+    Items->ascent = Item->Ascent;
+    Items->descent = Item->Descent;
+    Items->code_point = static_cast<uint32_t>(Item->Char);
+    Items->type = static_cast<uint8_t>(Item->Type);
+    Items->repetition_page_offset = Item->RepetitionPageOffset;
+    ++Items;
+  }
+
+  auto Indices = reinterpret_cast<uint32_t *>(Buffer + Header.indices.offset);
+  uint32_t NextIndex = 0;
+  auto appendIndices = [&](const auto &_index, const auto &_objects,
+                           uint32_t &_first, uint32_t &_count) {
+    _first = NextIndex;
+    _count = static_cast<uint32_t>(_objects.size());
+    for (const auto &Object : _objects)
+      Indices[NextIndex++] = _index.indexOf(Object);
+  };
+
+  auto Lines = reinterpret_cast<pdfla_line *>(Buffer + Header.lines.offset);
+  for (const auto &Line : this->Lines.objects()) {
+    Lines->box = toBox(Line->BoundingBox);
+    Lines->baseline = Line->Baseline;
+    Lines->text_left = Line->TextLeft;
+    Lines->id = Line->ID;
+    Lines->list_type = static_cast<uint32_t>(Line->ListType);
+    appendIndices(this->Items, Line->Items, Lines->first_item,
+                  Lines->item_count);
+    ++Lines;
+  }
+
+  auto Cells =
+      reinterpret_cast<pdfla_table_cell *>(Buffer + Header.cells.offset);
+  auto Text = reinterpret_cast<uint32_t *>(Buffer + Header.text.offset);
+  uint32_t NextCell = 0, NextChar = 0;
+  auto Blocks = reinterpret_cast<pdfla_block *>(Buffer + Header.blocks.offset);
+  for (auto Block : this->Blocks.objects()) {
+    Blocks->box = toBox(Block->BoundingBox);
+    Blocks->type = static_cast<uint8_t>(Block->Type);
+    Blocks->area = static_cast<uint8_t>(Block->Area);
+    Blocks->reading_order = Block->ReadingOrder;
+    Blocks->related_block = PDFLA_NO_INDEX;
+    appendIndices(this->Items, Block->Elements, Blocks->first_element,
+                  Blocks->element_count);
+    Blocks->first_line = Blocks->first_cell = Blocks->first_char = 0;
+    switch (Block->Type) {
+      case enuDocBlockType::Text:
+        Blocks->association =
+            static_cast<uint8_t>(Block.asText()->Association);
+        Blocks->related_block =
+            this->Blocks.indexOf(Block.asText()->AssociatedBlock);
+        appendIndices(this->Lines, Block.asText()->Lines, Blocks->first_line,
+                      Blocks->line_count);
+        break;
+      case enuDocBlockType::Figure:
+        Blocks->related_block = this->Blocks.indexOf(Block.asFigure()->Caption);
+        break;
+      case enuDocBlockType::Table:
+        Blocks->related_block = this->Blocks.indexOf(Block.asTable()->Caption);
+        Blocks->first_cell = NextCell;
+        Blocks->cell_count =
+            static_cast<uint32_t>(Block.asTable()->Cells.size());
+        for (const auto &Cell : Block.asTable()->Cells)
+          Cells[NextCell++] = {this->Blocks.indexOf(Cell.Text), Cell.Row,
+                               Cell.RowSpan, Cell.Col, Cell.ColSpan};
+        break;
+      case enuDocBlockType::Formulae:
+        Blocks->first_char = NextChar;
+        Blocks->char_count =
+            static_cast<uint32_t>(Block.asFormulae()->LatexSource.size());
+        for (auto Char : Block.asFormulae()->LatexSource)
+          Text[NextChar++] = static_cast<uint32_t>(Char);
+        break;
+    }
+    ++Blocks;
+  }
+  return reinterpret_cast<pdfla_layout_header *>(Buffer);
+}
+
+}  // namespace PDFLA
+}  // namespace Targoman
+
+//@NOTE: No exception may cross the C boundary, so each call catches them all
+//       and reports the failure as NULL or zero
+pdfla_document *pdfla_open(const uint8_t *data, size_t size) {
+  if (data == nullptr) return nullptr;
+  try {
+    std::unique_ptr<pdfla_document> Document(new pdfla_document);
+    Document->PdfLa.reset(new clsPdfLa(const_cast<uint8_t *>(data), size));
+    if (Document->PdfLa->isLoaded() == false) return nullptr;
+    return Document.release();
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void pdfla_close(pdfla_document *document) {
+  try {
+    delete document;
+  } catch (...) {
+  }
+}
+
+int pdfla_enable(pdfla_document *document, enum pdfla_feature feature,
+                 int enable) {
+  if (document == nullptr) return 0;
+  try {
+    switch (feature) {
+      case PDFLA_FEATURE_PAGE_FURNITURE_DETECTION:
+        document->PdfLa->enablePageFurnitureDetection(enable != 0);
+        return 1;
+      case PDFLA_FEATURE_DOCUMENT_STATISTICS:
+        document->PdfLa->enableDocumentStatistics(enable != 0);
+        return 1;
+      case PDFLA_FEATURE_INTRA_PAGE_PARALLELISM:
+        document->PdfLa->enableIntraPageParallelism(enable != 0);
+        return 1;
+      case PDFLA_FEATURE_LAYOUT_TEMPLATE_REUSE:
+        document->PdfLa->enableLayoutTemplateReuse(enable != 0);
+        return 1;
+    }
+  } catch (...) {
+  }
+  return 0;
+}
+
+int pdfla_use_preset(pdfla_document *document, enum pdfla_preset preset) {
+  if (document == nullptr) return 0;
+  try {
+    switch (preset) {
+      case PDFLA_PRESET_FAST:
+        document->PdfLa->setOptions(stuPdfLaOptions::fast());
+        return 1;
+      case PDFLA_PRESET_BALANCED:
+        document->PdfLa->setOptions(stuPdfLaOptions::balanced());
+        return 1;
+      case PDFLA_PRESET_ACCURATE:
+        document->PdfLa->setOptions(stuPdfLaOptions::accurate());
+        return 1;
+    }
+  } catch (...) {
+  }
+  return 0;
+}
+
+size_t pdfla_page_count(pdfla_document *document) {
+  if (document == nullptr) return 0;
+  try {
+    return document->PdfLa->pageCount();
+  } catch (...) {
+    return 0;
+  }
+}
+
+int pdfla_page_size(pdfla_document *document, size_t page_index,
+                    float *width, float *height) {
+  if (document == nullptr || width == nullptr || height == nullptr) return 0;
+  try {
+    if (page_index >= document->PdfLa->pageCount()) return 0;
+    auto PageSize = document->PdfLa->getPageSize(page_index);
+    *width = PageSize.Width;
+    *height = PageSize.Height;
+    return 1;
+  } catch (...) {
+    return 0;
+  }
+}
+
+const pdfla_layout_header *pdfla_get_page_layout(pdfla_document *document,
+                                                 size_t page_index) {
+  if (document == nullptr) return nullptr;
+  try {
+    if (page_index >= document->PdfLa->pageCount()) return nullptr;
+    bool IsDegraded = false;
+    auto Blocks = document->PdfLa->getPageBlocks(page_index, &IsDegraded);
+    return clsFlatLayoutWriter().write(
+        Blocks, document->PdfLa->getPageSize(page_index), IsDegraded);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void pdfla_free_layout(const pdfla_layout_header *layout) {
+  std::free(const_cast<pdfla_layout_header *>(layout));
+}
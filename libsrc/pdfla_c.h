@@ -0,0 +1,178 @@
+#ifndef __TARGOMAN_PDFLA_C__
+#define __TARGOMAN_PDFLA_C__
+
+/**
+ * C interface of the layout analysis, for bindings from other languages.
+ *
+ * The layout of a page is returned as a single allocation, starting with a
+ * `pdfla_layout_header` that gives the offset (from the start of the buffer),
+ * count and record size of each array in it. Records reference each other by
+ * index into these arrays, so the buffer can be read in place, copied or
+ * mapped as is, and is released with one `pdfla_free_layout` call. Readers
+ * should use the record sizes as strides, as later versions may only append
+ * fields to the records.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PDFLA_LAYOUT_MAGIC 0x464c4450u /* "PDLF" */
+#define PDFLA_LAYOUT_VERSION 2u
+#define PDFLA_NO_INDEX 0xffffffffu
+
+/* Values of the Targoman::DLA enums of the same names */
+enum pdfla_item_type {
+  PDFLA_ITEM_NONE,
+  PDFLA_ITEM_IMAGE,
+  PDFLA_ITEM_PATH,
+  PDFLA_ITEM_VERTICAL_LINE,
+  PDFLA_ITEM_HORIZONTAL_LINE,
+  PDFLA_ITEM_SOLID_RECTANGLE,
+  PDFLA_ITEM_CHAR,
+  PDFLA_ITEM_BACKGROUND
+};
+
+enum pdfla_area {
+  PDFLA_AREA_HEADER,
+  PDFLA_AREA_BODY,
+  PDFLA_AREA_FOOTER,
+  PDFLA_AREA_LEFT_SIDEBAR,
+  PDFLA_AREA_RIGHT_SIDEBAR,
+  PDFLA_AREA_WATERMARK
+};
+
+enum pdfla_block_type {
+  PDFLA_BLOCK_TEXT,
+  PDFLA_BLOCK_FIGURE,
+  PDFLA_BLOCK_TABLE,
+  PDFLA_BLOCK_FORMULAE
+};
+
+enum pdfla_association {
+  PDFLA_ASSOCIATION_NONE,
+  PDFLA_ASSOCIATION_IS_CAPTION_OF,
+  PDFLA_ASSOCIATION_IS_INSIDE_OF
+};
+
+enum pdfla_list_type {
+  PDFLA_LIST_NONE,
+  PDFLA_LIST_BULLETED,
+  PDFLA_LIST_NUMBERED
+};
+
+enum pdfla_feature {
+  PDFLA_FEATURE_PAGE_FURNITURE_DETECTION,
+  PDFLA_FEATURE_DOCUMENT_STATISTICS,
+  PDFLA_FEATURE_INTRA_PAGE_PARALLELISM,
+  PDFLA_FEATURE_LAYOUT_TEMPLATE_REUSE
+};
+
+/* Presets of Targoman::PDFLA::stuPdfLaOptions */
+enum pdfla_preset {
+  PDFLA_PRESET_FAST,
+  PDFLA_PRESET_BALANCED,
+  PDFLA_PRESET_ACCURATE
+};
+
+typedef struct pdfla_box {
+  float left, top, width, height;
+} pdfla_box;
+
+typedef struct pdfla_array {
+  uint32_t offset;
+  uint32_t count;
+  uint32_t record_size;
+} pdfla_array;
+
+typedef struct pdfla_layout_header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size; /* Of the whole buffer */
+  uint32_t header_size;
+  float page_width, page_height;
+  uint32_t is_degraded; /* See clsPdfLa::setPageTimeBudget */
+  /* Blocks of the page come first, followed by the captions, table cells and
+     associated blocks they reference which are not page blocks themselves */
+  uint32_t page_block_count;
+  pdfla_array blocks;  /* pdfla_block */
+  pdfla_array lines;   /* pdfla_line */
+  pdfla_array items;   /* pdfla_item */
+  pdfla_array cells;   /* pdfla_table_cell */
+  pdfla_array indices; /* uint32_t, lists of line and item indices */
+  pdfla_array text;    /* uint32_t, unicode code points of the formulae */
+} pdfla_layout_header;
+
+typedef struct pdfla_block {
+  pdfla_box box;
+  uint8_t type; /* pdfla_block_type */
+  uint8_t area; /* pdfla_area */
+  uint8_t association; /* pdfla_association, of text blocks */
+  uint8_t reserved;
+  /* Associated block of text blocks, caption of figures and tables */
+  uint32_t related_block;
+  uint32_t first_element, element_count; /* Items, through `indices` */
+  uint32_t first_line, line_count;       /* Lines, through `indices` */
+  uint32_t first_cell, cell_count;       /* Directly into `cells` */
+  uint32_t first_char, char_count;       /* Latex source, into `text` */
+  /* Position among the page blocks in reading order, -1 for the others */
+  int32_t reading_order;
+} pdfla_block;
+
+typedef struct pdfla_line {
+  pdfla_box box;
+  float baseline;
+  float text_left;
+  int32_t id;
+  uint32_t list_type; /* pdfla_list_type */
+  uint32_t first_item, item_count; /* Through `indices` */
+} pdfla_line;
+
+typedef struct pdfla_item {
+  pdfla_box box;
+  float baseline, ascent, descent;
+  uint32_t code_point;
+  uint8_t type; /* pdfla_item_type */
+  uint8_t reserved[3];
+  int32_t repetition_page_offset;
+} pdfla_item;
+
+typedef struct pdfla_table_cell {
+  uint32_t block; /* The text block of the cell */
+  int16_t row, row_span;
+  int16_t col, col_span;
+} pdfla_table_cell;
+
+typedef struct pdfla_document pdfla_document;
+
+/* No call throws: failures, including a NULL document, return NULL or zero */
+
+/* The data is used in place and must outlive the document. Returns NULL when
+   the data is not a PDF that can be parsed */
+pdfla_document *pdfla_open(const uint8_t *data, size_t size);
+void pdfla_close(pdfla_document *document);
+
+/* Return zero when the feature or preset is unknown, or on failure */
+int pdfla_enable(pdfla_document *document, enum pdfla_feature feature,
+                 int enable);
+/* Replaces all options of the document, including the enabled features */
+int pdfla_use_preset(pdfla_document *document, enum pdfla_preset preset);
+
+size_t pdfla_page_count(pdfla_document *document);
+/* Returns zero when the page index is out of range */
+int pdfla_page_size(pdfla_document *document, size_t page_index,
+                    float *width, float *height);
+
+/* Returns NULL when the page index is out of range or the analysis fails */
+const pdfla_layout_header *pdfla_get_page_layout(pdfla_document *document,
+                                                 size_t page_index);
+void pdfla_free_layout(const pdfla_layout_header *layout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TARGOMAN_PDFLA_C__ */
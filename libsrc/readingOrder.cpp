@@ -0,0 +1,104 @@
+#include "readingOrder.h"
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <queue>
+
+namespace Targoman {
+namespace PDFLA {
+
+using namespace Targoman::DLA;
+
+int32_t areaRank(enuDocArea _area) {
+  switch (_area) {
+    case enuDocArea::Header:
+      return 0;
+    case enuDocArea::Body:
+      return 1;
+    case enuDocArea::LeftSidebar:
+    case enuDocArea::RightSidebar:
+      return 2;
+    case enuDocArea::Footer:
+      return 3;
+    case enuDocArea::Watermark:
+      break;
+  }
+  return 4;
+}
+
+void sortBlocksInReadingOrder(DocBlockPtrVector_t &_blocks) {
+  constexpr int32_t NO_BLOCK = -1;
+
+  std::vector<uint32_t> ByTop;
+  for (uint32_t i = 0; i < _blocks.size(); ++i)
+    if (_blocks[i]->Area != enuDocArea::Watermark) ByTop.push_back(i);
+  std::stable_sort(ByTop.begin(), ByTop.end(), [&](uint32_t a, uint32_t b) {
+    return _blocks[a]->BoundingBox.top() < _blocks[b]->BoundingBox.top();
+  });
+
+  //@NOTE: The skyline maps the start of each horizontal interval to the
+  //       lowest block seen so far over it. Sweeping the blocks downwards, a
+  //       block follows exactly the blocks visible above it, which keeps the
+  //       graph sparse: each block adds at most two intervals and every other
+  //       interval it sees is overwritten.
+  std::map<float, int32_t> Skyline{
+      {-std::numeric_limits<float>::infinity(), NO_BLOCK}};
+  std::vector<std::vector<uint32_t>> Successors(_blocks.size());
+  std::vector<uint32_t> Predecessors(_blocks.size(), 0);
+  for (auto Index : ByTop) {
+    float Left = _blocks[Index]->BoundingBox.left();
+    float Right = std::max(_blocks[Index]->BoundingBox.right(),
+                           Left + MIN_ITEM_SIZE);
+    auto Begin = std::prev(Skyline.upper_bound(Left));
+    auto End = Skyline.lower_bound(Right);
+    int32_t Below = std::prev(End)->second;
+    int32_t Previous = NO_BLOCK;
+    for (auto Interval = Begin; Interval != End; ++Interval) {
+      if (Interval->second != NO_BLOCK && Interval->second != Previous) {
+        Successors[static_cast<size_t>(Interval->second)].push_back(Index);
+        ++Predecessors[Index];
+      }
+      Previous = Interval->second;
+    }
+    Skyline.erase(Skyline.lower_bound(Left), End);
+    Skyline[Left] = static_cast<int32_t>(Index);
+    if (End == Skyline.end() || End->first != Right) Skyline[Right] = Below;
+  }
+
+  auto readsAfter = [&](uint32_t a, uint32_t b) {
+    const auto &A = _blocks[a];
+    const auto &B = _blocks[b];
+    if (areaRank(A->Area) != areaRank(B->Area))
+      return areaRank(A->Area) > areaRank(B->Area);
+    if (A->BoundingBox.left() != B->BoundingBox.left())
+      return A->BoundingBox.left() > B->BoundingBox.left();
+    return A->BoundingBox.top() > B->BoundingBox.top();
+  };
+  std::priority_queue<uint32_t, std::vector<uint32_t>, decltype(readsAfter)>
+      Ready(readsAfter);
+  for (auto Index : ByTop)
+    if (Predecessors[Index] == 0) Ready.push(Index);
+
+  //@NOTE: Edges only point downwards, so the graph has no cycles and every
+  //       block is reached
+  int32_t NextOrder = 0;
+  while (Ready.size()) {
+    auto Index = Ready.top();
+    Ready.pop();
+    _blocks[Index]->ReadingOrder = NextOrder++;
+    for (auto Successor : Successors[Index])
+      if (--Predecessors[Successor] == 0) Ready.push(Successor);
+  }
+  for (auto &Block : _blocks)
+    if (Block->Area == enuDocArea::Watermark) Block->ReadingOrder = NextOrder++;
+
+  std::stable_sort(_blocks.begin(), _blocks.end(),
+                   [](const clsDocBlockPtr &a, const clsDocBlockPtr &b) {
+                     return a->ReadingOrder < b->ReadingOrder;
+                   });
+}
+
+}  // namespace PDFLA
+}  // namespace Targoman
@@ -0,0 +1,21 @@
+#ifndef __TARGOMAN_PDFLA_READINGORDER__
+#define __TARGOMAN_PDFLA_READINGORDER__
+
+#include "dla.h"
+
+namespace Targoman {
+namespace PDFLA {
+
+/**
+ * Sorts the blocks of a page in reading order and numbers them through their
+ * `ReadingOrder`. A block precedes the blocks right below it which overlap it
+ * horizontally, and among the blocks free to come next the leftmost one of
+ * the earliest area (header, body, sidebars, footer) is read first, so the
+ * columns are read one after the other. Watermarks come last.
+ */
+void sortBlocksInReadingOrder(Targoman::DLA::DocBlockPtrVector_t &_blocks);
+
+}  // namespace PDFLA
+}  // namespace Targoman
+
+#endif  // __TARGOMAN_PDFLA_READINGORDER__
@@ -0,0 +1,377 @@
+#include "serialization.h"
+
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <unordered_map>
+
+namespace Targoman {
+namespace PDFLA {
+using namespace Targoman::DLA;
+
+constexpr uint32_t SERIALIZATION_MAGIC = 0x414c4450;  // "PDLA"
+constexpr uint32_t SERIALIZATION_VERSION = 2;
+constexpr uint32_t NULL_INDEX = std::numeric_limits<uint32_t>::max();
+
+template <typename T>
+class clsObjectIndex {
+ private:
+  std::unordered_map<const void *, uint32_t> Indices;
+  std::vector<T> Objects;
+
+ public:
+  // Returns false when the object was already indexed
+  bool add(const T &_object) {
+    if (_object.get() == nullptr ||
+        this->Indices.emplace(_object.get(), this->Objects.size()).second ==
+            false)
+      return false;
+    this->Objects.push_back(_object);
+    return true;
+  }
+
+  uint32_t indexOf(const T &_object) const {
+    if (_object.get() == nullptr) return NULL_INDEX;
+    return this->Indices.at(_object.get());
+  }
+
+  const std::vector<T> &objects() const { return this->Objects; }
+};
+
+class clsBlockWriter {
+ private:
+  std::vector<uint8_t> &Buffer;
+  clsObjectIndex<DocItemPtr_t> Items;
+  clsObjectIndex<DocLinePtr_t> Lines;
+  clsObjectIndex<clsDocBlockPtr> Blocks;
+
+ private:
+  template <typename T>
+  void write(T _value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Only plain values can be written as is");
+    size_t Position = this->Buffer.size();
+    this->Buffer.resize(Position + sizeof(T));
+    std::memcpy(this->Buffer.data() + Position, &_value, sizeof(T));
+  }
+
+  void write(const stuBoundingBox &_boundingBox) {
+    this->write(_boundingBox.left());
+    this->write(_boundingBox.top());
+    this->write(_boundingBox.width());
+    this->write(_boundingBox.height());
+  }
+
+  template <typename T>
+  void writeIndices(const clsObjectIndex<T> &_index,
+                    const std::vector<T> &_objects) {
+    this->write(static_cast<uint32_t>(_objects.size()));
+    for (const auto &Object : _objects) this->write(_index.indexOf(Object));
+  }
+
+  void collect(const DocBlockPtrVector_t &_rootBlocks);
+  void writeBlock(const clsDocBlockPtr &_block);
+
+ public:
+  clsBlockWriter(std::vector<uint8_t> &_buffer) : Buffer(_buffer) {}
+  void writeBlocks(const DocBlockPtrVector_t &_rootBlocks);
+};
+
+void clsBlockWriter::collect(const DocBlockPtrVector_t &_rootBlocks) {
+  DocBlockPtrVector_t Pending(_rootBlocks.rbegin(), _rootBlocks.rend());
+  while (Pending.size()) {
+    auto Block = Pending.back();
+    Pending.pop_back();
+    if (this->Blocks.add(Block) == false) continue;
+
+    for (const auto &Item : Block->Elements) this->Items.add(Item);
+    switch (Block->Type) {
+      case enuDocBlockType::Text:
+        for (const auto &Line : Block.asText()->Lines) {
+          this->Lines.add(Line);
+          for (const auto &Item : Line->Items) this->Items.add(Item);
+        }
+        Pending.push_back(Block.asText()->AssociatedBlock);
+        break;
+      case enuDocBlockType::Figure:
+        Pending.push_back(Block.asFigure()->Caption);
+        break;
+      case enuDocBlockType::Table:
+        Pending.push_back(Block.asTable()->Caption);
+        for (const auto &Cell : Block.asTable()->Cells)
+          Pending.push_back(Cell.Text);
+        break;
+      case enuDocBlockType::Formulae:
+        break;
+    }
+  }
+}
+
+void clsBlockWriter::writeBlock(const clsDocBlockPtr &_block) {
+  this->write(_block->BoundingBox);
+  this->write(static_cast<uint8_t>(_block->Area));
+  this->write(_block->ReadingOrder);
+  this->writeIndices(this->Items, _block->Elements);
+
+  auto Block = _block;
+  switch (Block->Type) {
+    case enuDocBlockType::Text:
+      this->writeIndices(this->Lines, Block.asText()->Lines);
+      this->write(static_cast<uint8_t>(Block.asText()->Association));
+      this->write(this->Blocks.indexOf(Block.asText()->AssociatedBlock));
+      break;
+    case enuDocBlockType::Figure:
+      this->write(this->Blocks.indexOf(Block.asFigure()->Caption));
+      break;
+    case enuDocBlockType::Table:
+      this->write(this->Blocks.indexOf(Block.asTable()->Caption));
+      this->write(static_cast<uint32_t>(Block.asTable()->Cells.size()));
+      for (const auto &Cell : Block.asTable()->Cells) {
+        this->write(this->Blocks.indexOf(Cell.Text));
+        this->write(Cell.Row);
+        this->write(Cell.RowSpan);
+        this->write(Cell.Col);
+        this->write(Cell.ColSpan);
+      }
+      break;
+    case enuDocBlockType::Formulae: {
+      const auto &LatexSource = Block.asFormulae()->LatexSource;
+      this->write(static_cast<uint32_t>(LatexSource.size()));
+      for (auto Char : LatexSource)
+        this->write(static_cast<uint32_t>(Char));
+      break;
+    }
+  }
+}
+
+void clsBlockWriter::writeBlocks(const DocBlockPtrVector_t &_rootBlocks) {
+  this->collect(_rootBlocks);
+
+  this->write(SERIALIZATION_MAGIC);
+  this->write(SERIALIZATION_VERSION);
+
+  this->write(static_cast<uint32_t>(this->Items.objects().size()));
+  for (const auto &Item : this->Items.objects()) {
+    this->write(Item->BoundingBox);
+    this->write(static_cast<uint8_t>(Item->Type));
+    this->write(Item->RepetitionPageOffset);
+    this->write(Item->Baseline);
+    this->write(Item->Ascent);
+    this->write(Item->Descent);
+    this->write(static_cast<uint32_t>(Item->Char));
+  }
+
+  this->write(static_cast<uint32_t>(this->Lines.objects().size()));
+  for (const auto &Line : this->Lines.objects()) {
+    this->write(Line->BoundingBox);
+    this->write(Line->Baseline);
+    this->write(Line->ID);
+    this->write(static_cast<uint8_t>(Line->ListType));
+    this->write(Line->TextLeft);
+    this->writeIndices(this->Items, Line->Items);
+  }
+
+  //@NOTE: All block types come first so references between blocks (which may
+  //       form cycles, e.g. a figure and its caption) can be resolved at once
+  this->write(static_cast<uint32_t>(this->Blocks.objects().size()));
+  for (const auto &Block : this->Blocks.objects())
+    this->write(static_cast<uint8_t>(Block->Type));
+  this->writeIndices(this->Blocks, _rootBlocks);
+  for (const auto &Block : this->Blocks.objects()) this->writeBlock(Block);
+}
+
+class clsBlockReader {
+ private:
+  const uint8_t *Data;
+  size_t Size;
+  size_t Position;
+  bool Failed;
+  DocItemPtrVector_t Items;
+  DocLinePtrVector_t Lines;
+  DocBlockPtrVector_t Blocks;
+
+ private:
+  template <typename T>
+  T read() {
+    T Value{};
+    if (this->Failed || this->Position + sizeof(T) > this->Size) {
+      this->Failed = true;
+      return Value;
+    }
+    std::memcpy(&Value, this->Data + this->Position, sizeof(T));
+    this->Position += sizeof(T);
+    return Value;
+  }
+
+  stuBoundingBox readBoundingBox() {
+    auto Left = this->read<float>();
+    auto Top = this->read<float>();
+    auto Width = this->read<float>();
+    auto Height = this->read<float>();
+    return stuBoundingBox(stuPoint(Left, Top), stuSize(Width, Height));
+  }
+
+  template <typename Enum_t>
+  Enum_t readEnum(Enum_t _last) {
+    auto Value = this->read<uint8_t>();
+    if (Value > static_cast<uint8_t>(_last)) this->Failed = true;
+    return static_cast<Enum_t>(Value);
+  }
+
+  // Every element needs at least 4 bytes so a count is sane only if the
+  // remaining buffer could hold that many
+  uint32_t readCount() {
+    auto Count = this->read<uint32_t>();
+    if (Count > (this->Size - this->Position) / sizeof(uint32_t))
+      this->Failed = true;
+    return this->Failed ? 0 : Count;
+  }
+
+  template <typename T>
+  T readReference(const std::vector<T> &_objects, bool _nullable) {
+    auto Index = this->read<uint32_t>();
+    if (Index == NULL_INDEX && _nullable) return T();
+    if (Index >= _objects.size()) {
+      this->Failed = true;
+      return T();
+    }
+    return _objects[Index];
+  }
+
+  template <typename T>
+  void readReferences(const std::vector<T> &_objects, std::vector<T> &_target) {
+    auto Count = this->readCount();
+    _target.reserve(Count);
+    for (uint32_t i = 0; i < Count && this->Failed == false; ++i)
+      _target.push_back(this->readReference(_objects, false));
+  }
+
+  void readBlock(clsDocBlockPtr &_block);
+
+ public:
+  clsBlockReader(const uint8_t *_data, size_t _size)
+      : Data(_data), Size(_size), Position(0), Failed(false) {}
+  bool readBlocks(DocBlockPtrVector_t &_rootBlocks);
+};
+
+void clsBlockReader::readBlock(clsDocBlockPtr &_block) {
+  _block->BoundingBox = this->readBoundingBox();
+  _block->Area = this->readEnum(enuDocArea::Watermark);
+  _block->ReadingOrder = this->read<int32_t>();
+  this->readReferences(this->Items, _block->Elements);
+
+  switch (_block->Type) {
+    case enuDocBlockType::Text:
+      this->readReferences(this->Lines, _block.asText()->Lines);
+      _block.asText()->Association =
+          this->readEnum(enuDocTextBlockAssociation::IsInsideOf);
+      _block.asText()->AssociatedBlock =
+          this->readReference(this->Blocks, true);
+      break;
+    case enuDocBlockType::Figure:
+      _block.asFigure()->Caption = this->readReference(this->Blocks, true);
+      break;
+    case enuDocBlockType::Table: {
+      _block.asTable()->Caption = this->readReference(this->Blocks, true);
+      auto Count = this->readCount();
+      auto &Cells = _block.asTable()->Cells;
+      Cells.reserve(Count);
+      for (uint32_t i = 0; i < Count && this->Failed == false; ++i) {
+        stuDocTableCell Cell;
+        Cell.Text = this->readReference(this->Blocks, true);
+        Cell.Row = this->read<int16_t>();
+        Cell.RowSpan = this->read<int16_t>();
+        Cell.Col = this->read<int16_t>();
+        Cell.ColSpan = this->read<int16_t>();
+        Cells.push_back(Cell);
+      }
+      break;
+    }
+    case enuDocBlockType::Formulae: {
+      auto Count = this->readCount();
+      auto &LatexSource = _block.asFormulae()->LatexSource;
+      LatexSource.reserve(Count);
+      for (uint32_t i = 0; i < Count && this->Failed == false; ++i)
+        LatexSource.push_back(static_cast<wchar_t>(this->read<uint32_t>()));
+      break;
+    }
+  }
+}
+
+bool clsBlockReader::readBlocks(DocBlockPtrVector_t &_rootBlocks) {
+  if (this->read<uint32_t>() != SERIALIZATION_MAGIC ||
+      this->read<uint32_t>() != SERIALIZATION_VERSION)
+    return false;
+
+  auto ItemCount = this->readCount();
+  this->Items.reserve(ItemCount);
+  for (uint32_t i = 0; i < ItemCount && this->Failed == false; ++i) {
+    auto BoundingBox = this->readBoundingBox();
+    auto Type = this->readEnum(enuDocItemType::Background);
+    auto RepetitionPageOffset = this->read<int32_t>();
+    auto Baseline = this->read<float>();
+    auto Ascent = this->read<float>();
+    auto Descent = this->read<float>();
+    auto Char = static_cast<wchar_t>(this->read<uint32_t>());
+    auto Item = std::make_shared<stuDocItem>(BoundingBox, Type, Baseline,
+                                             Ascent, Descent, Char);
+    Item->RepetitionPageOffset = RepetitionPageOffset;
+    this->Items.push_back(Item);
+  }
+
+  auto LineCount = this->readCount();
+  this->Lines.reserve(LineCount);
+  for (uint32_t i = 0; i < LineCount && this->Failed == false; ++i) {
+    auto Line = std::make_shared<stuDocLine>();
+    Line->BoundingBox = this->readBoundingBox();
+    Line->Baseline = this->read<float>();
+    Line->ID = this->read<int32_t>();
+    Line->ListType = this->readEnum(enuListType::Numbered);
+    Line->TextLeft = this->read<float>();
+    this->readReferences(this->Items, Line->Items);
+    this->Lines.push_back(Line);
+  }
+
+  auto BlockCount = this->readCount();
+  this->Blocks.resize(BlockCount);
+  for (auto &Block : this->Blocks) {
+    switch (this->readEnum(enuDocBlockType::Formulae)) {
+      case enuDocBlockType::Text:
+        Block.reset(new stuDocTextBlock);
+        break;
+      case enuDocBlockType::Figure:
+        Block.reset(new stuDocFigureBlock);
+        break;
+      case enuDocBlockType::Table:
+        Block.reset(new stuDocTableBlock);
+        break;
+      case enuDocBlockType::Formulae:
+        Block.reset(new stuDocFormulaeBlock);
+        break;
+    }
+  }
+  DocBlockPtrVector_t Roots;
+  this->readReferences(this->Blocks, Roots);
+  for (auto &Block : this->Blocks) {
+    if (this->Failed) break;
+    this->readBlock(Block);
+  }
+
+  if (this->Failed || this->Position != this->Size) return false;
+  _rootBlocks = std::move(Roots);
+  return true;
+}
+
+void serializeBlocks(const DocBlockPtrVector_t &_blocks,
+                     std::vector<uint8_t> &_buffer) {
+  clsBlockWriter(_buffer).writeBlocks(_blocks);
+}
+
+bool deserializeBlocks(const uint8_t *_data, size_t _size,
+                       DocBlockPtrVector_t &_blocks) {
+  _blocks.clear();
+  return clsBlockReader(_data, _size).readBlocks(_blocks);
+}
+
+}  // namespace PDFLA
+}  // namespace Targoman
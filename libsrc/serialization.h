@@ -0,0 +1,26 @@
+#ifndef __TARGOMAN_PDFLA_SERIALIZATION__
+#define __TARGOMAN_PDFLA_SERIALIZATION__
+
+#include <vector>
+
+#include "dla.h"
+
+namespace Targoman {
+namespace PDFLA {
+
+/**
+ * Flattens the blocks (with their lines, items, table cells, captions and
+ * associations) into a self-contained byte buffer. Objects shared between
+ * blocks are written once and stay shared after deserialization.
+ */
+void serializeBlocks(const Targoman::DLA::DocBlockPtrVector_t &_blocks,
+                     std::vector<uint8_t> &_buffer);
+
+// Returns false (leaving `_blocks` empty) when the buffer is malformed
+bool deserializeBlocks(const uint8_t *_data, size_t _size,
+                       Targoman::DLA::DocBlockPtrVector_t &_blocks);
+
+}  // namespace PDFLA
+}  // namespace Targoman
+
+#endif  // __TARGOMAN_PDFLA_SERIALIZATION__
@@ -0,0 +1,340 @@
+#include "tables.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "algorithm.hpp"
+
+namespace Targoman {
+namespace PDFLA {
+
+using namespace Targoman::DLA;
+using namespace Targoman::Common;
+
+constexpr float RULER_SNAP_TOLERANCE = 2.f;
+constexpr float RULER_JOIN_TOLERANCE = 2.f;
+constexpr float RULER_CROSS_TOLERANCE = 3.f;
+constexpr float TABLE_CONTAINMENT_TOLERANCE = 1.f;
+//@NOTE: A page frame with a header rule or a column divider across it makes
+//       a single row or column of cells, which is never taken as a table
+constexpr size_t MIN_TABLE_ROWS = 2;
+constexpr size_t MIN_TABLE_COLS = 2;
+
+struct stuRuler {
+  float Position;  // Center on the thin axis
+  float From, To;  // Extent on the long axis
+  DocItemPtrVector_t Items;
+};
+typedef std::vector<stuRuler> RulerVector_t;
+
+/**
+ * Snaps rulers with nearly the same position onto one line and joins the
+ * touching pieces of each line, using two sorted sweeps.
+ */
+RulerVector_t snapAndMergeRulers(RulerVector_t &&_rulers) {
+  RulerVector_t Result;
+  std::sort(_rulers.begin(), _rulers.end(),
+            [](const stuRuler &a, const stuRuler &b) {
+              return a.Position < b.Position;
+            });
+
+  size_t ClusterStart = 0;
+  while (ClusterStart < _rulers.size()) {
+    size_t ClusterEnd = ClusterStart + 1;
+    float PositionSum = _rulers[ClusterStart].Position;
+    while (ClusterEnd < _rulers.size() &&
+           _rulers[ClusterEnd].Position - _rulers[ClusterEnd - 1].Position <=
+               RULER_SNAP_TOLERANCE) {
+      PositionSum += _rulers[ClusterEnd].Position;
+      ++ClusterEnd;
+    }
+    float Position =
+        PositionSum / static_cast<float>(ClusterEnd - ClusterStart);
+
+    std::sort(_rulers.begin() + ClusterStart, _rulers.begin() + ClusterEnd,
+              [](const stuRuler &a, const stuRuler &b) {
+                return a.From < b.From;
+              });
+    size_t FirstMerged = Result.size();
+    for (size_t i = ClusterStart; i < ClusterEnd; ++i) {
+      auto &Ruler = _rulers[i];
+      if (Result.size() > FirstMerged &&
+          Ruler.From <= Result.back().To + RULER_JOIN_TOLERANCE) {
+        Result.back().To = std::max(Result.back().To, Ruler.To);
+        Result.back().Items.insert(Result.back().Items.end(),
+                                   Ruler.Items.begin(), Ruler.Items.end());
+        continue;
+      }
+      Ruler.Position = Position;
+      Result.push_back(std::move(Ruler));
+    }
+    ClusterStart = ClusterEnd;
+  }
+  return Result;
+}
+
+std::vector<float> uniquePositions(const RulerVector_t &_rulers,
+                                   const std::vector<uint32_t> &_indices) {
+  std::vector<float> Result;
+  Result.reserve(_indices.size());
+  for (auto Index : _indices) Result.push_back(_rulers[Index].Position);
+  std::sort(Result.begin(), Result.end());
+  Result.erase(std::unique(Result.begin(), Result.end(),
+                           [](float a, float b) {
+                             return b - a <= RULER_SNAP_TOLERANCE;
+                           }),
+               Result.end());
+  return Result;
+}
+
+size_t findSlot(const std::vector<float> &_positions, float _value) {
+  auto Position =
+      std::upper_bound(_positions.begin(), _positions.end(), _value);
+  return static_cast<size_t>(Position - _positions.begin()) - 1;
+}
+
+clsDocBlockPtr makeCellTextBlock(DocItemPtrVector_t &&_chars) {
+  std::sort(_chars.begin(), _chars.end(),
+            [](const DocItemPtr_t &a, const DocItemPtr_t &b) {
+              return a->BoundingBox.top() < b->BoundingBox.top();
+            });
+  DocLinePtrVector_t Lines;
+  for (const auto &Char : _chars) {
+    DocLinePtr_t Line{nullptr};
+    for (auto &Candidate : Lines)
+      if (Candidate->BoundingBox.verticalOverlapRatio(Char->BoundingBox) >
+          0.5f) {
+        Line = Candidate;
+        break;
+      }
+    if (Line.get() == nullptr) {
+      Line = std::make_shared<stuDocLine>();
+      Line->BoundingBox = Char->BoundingBox;
+      Line->Baseline = Char->Baseline;
+      Lines.push_back(Line);
+    }
+    Line->BoundingBox.unionWith_(Char->BoundingBox);
+    Line->Items.push_back(Char);
+  }
+
+  clsDocBlockPtr Block;
+  Block.reset(new stuDocTextBlock);
+  for (auto &Line : Lines) {
+    std::sort(Line->Items.begin(), Line->Items.end(),
+              [](const DocItemPtr_t &a, const DocItemPtr_t &b) {
+                return a->BoundingBox.left() < b->BoundingBox.left();
+              });
+    if (Block.asText()->Lines.empty())
+      Block->BoundingBox = Line->BoundingBox;
+    Block->BoundingBox.unionWith_(Line->BoundingBox);
+    Block.asText()->Lines.push_back(Line);
+  }
+  return Block;
+}
+
+DocBlockPtrVector_t extractPageTables(DocItemPtrVector_t &_docItems) {
+  DocBlockPtrVector_t Result;
+
+  RulerVector_t HorizontalRulers, VerticalRulers;
+  for (const auto &Item : _docItems) {
+    if (Item->Type == enuDocItemType::Char ||
+        Item->Type == enuDocItemType::Image)
+      continue;
+    const auto &BBox = Item->BoundingBox;
+    if (BBox.isHorizontalRuler())
+      HorizontalRulers.push_back(
+          stuRuler{BBox.centerY(), BBox.left(), BBox.right(), {Item}});
+    else if (BBox.isVerticalRuler())
+      VerticalRulers.push_back(
+          stuRuler{BBox.centerX(), BBox.top(), BBox.bottom(), {Item}});
+  }
+  if (HorizontalRulers.size() < 2 || VerticalRulers.size() < 2) return Result;
+
+  HorizontalRulers = snapAndMergeRulers(std::move(HorizontalRulers));
+  VerticalRulers = snapAndMergeRulers(std::move(VerticalRulers));
+
+  //@NOTE: Vertical rulers are sorted by their X position, so the ones that may
+  //       cross a horizontal ruler are found by binary search
+  const size_t H = HorizontalRulers.size();
+  clsUnionFind Components(H + VerticalRulers.size());
+  for (size_t i = 0; i < H; ++i) {
+    const auto &HRuler = HorizontalRulers[i];
+    auto First = std::lower_bound(
+        VerticalRulers.begin(), VerticalRulers.end(),
+        HRuler.From - RULER_CROSS_TOLERANCE,
+        [](const stuRuler &r, float x) { return r.Position < x; });
+    for (auto VRuler = First;
+         VRuler != VerticalRulers.end() &&
+         VRuler->Position <= HRuler.To + RULER_CROSS_TOLERANCE;
+         ++VRuler)
+      if (VRuler->From - RULER_CROSS_TOLERANCE <= HRuler.Position &&
+          VRuler->To + RULER_CROSS_TOLERANCE >= HRuler.Position)
+        Components.merge(
+            static_cast<uint32_t>(i),
+            static_cast<uint32_t>(H + (VRuler - VerticalRulers.begin())));
+  }
+
+  std::vector<std::vector<uint32_t>> ComponentHRulers(Components.size()),
+      ComponentVRulers(Components.size());
+  for (uint32_t i = 0; i < Components.size(); ++i) {
+    auto Root = Components.find(i);
+    if (i < H)
+      ComponentHRulers[Root].push_back(i);
+    else
+      ComponentVRulers[Root].push_back(static_cast<uint32_t>(i - H));
+  }
+
+  std::vector<bool> ItemIsConsumed(_docItems.size(), false);
+  for (uint32_t Root = 0; Root < Components.size(); ++Root) {
+    const auto &HIndices = ComponentHRulers[Root];
+    const auto &VIndices = ComponentVRulers[Root];
+    if (HIndices.size() < 2 || VIndices.size() < 2) continue;
+
+    auto RowPositions = uniquePositions(HorizontalRulers, HIndices);
+    auto ColPositions = uniquePositions(VerticalRulers, VIndices);
+    if (RowPositions.size() < 2 || ColPositions.size() < 2) continue;
+    const size_t Rows = RowPositions.size() - 1;
+    const size_t Cols = ColPositions.size() - 1;
+    if (Rows < MIN_TABLE_ROWS || Cols < MIN_TABLE_COLS) continue;
+
+    // Which cell sides are drawn: VBorders[r][c] is the left side of cell
+    // (r, c) and HBorders[r][c] is its top side
+    std::vector<std::vector<bool>> VBorders(Rows,
+                                            std::vector<bool>(Cols + 1, false));
+    std::vector<std::vector<bool>> HBorders(Rows + 1,
+                                            std::vector<bool>(Cols, false));
+    for (auto Index : VIndices) {
+      const auto &Ruler = VerticalRulers[Index];
+      size_t Col = findSlot(ColPositions, Ruler.Position);
+      for (size_t Row = 0; Row < Rows; ++Row) {
+        float Middle = (RowPositions[Row] + RowPositions[Row + 1]) / 2;
+        if (Ruler.From <= Middle && Ruler.To >= Middle)
+          VBorders[Row][Col] = true;
+      }
+    }
+    for (auto Index : HIndices) {
+      const auto &Ruler = HorizontalRulers[Index];
+      size_t Row = findSlot(RowPositions, Ruler.Position);
+      for (size_t Col = 0; Col < Cols; ++Col) {
+        float Middle = (ColPositions[Col] + ColPositions[Col + 1]) / 2;
+        if (Ruler.From <= Middle && Ruler.To >= Middle)
+          HBorders[Row][Col] = true;
+      }
+    }
+
+    // Grow each cell to the right and then downwards until a drawn side stops
+    // it, which yields the spanned cells
+    clsDocBlockPtr Table;
+    Table.reset(new stuDocTableBlock);
+    auto &Cells = Table.asTable()->Cells;
+    std::vector<std::vector<int32_t>> CellIndex(Rows,
+                                                std::vector<int32_t>(Cols, -1));
+    for (size_t Row = 0; Row < Rows; ++Row)
+      for (size_t Col = 0; Col < Cols; ++Col) {
+        if (CellIndex[Row][Col] >= 0) continue;
+        size_t ColSpan = 1;
+        while (Col + ColSpan < Cols && !VBorders[Row][Col + ColSpan] &&
+               CellIndex[Row][Col + ColSpan] < 0)
+          ++ColSpan;
+        size_t RowSpan = 1;
+        while (Row + RowSpan < Rows) {
+          bool Open = true;
+          for (size_t k = Col; k < Col + ColSpan && Open; ++k)
+            Open = !HBorders[Row + RowSpan][k] &&
+                   CellIndex[Row + RowSpan][k] < 0;
+          if (!Open) break;
+          ++RowSpan;
+        }
+        for (size_t r = Row; r < Row + RowSpan; ++r)
+          for (size_t c = Col; c < Col + ColSpan; ++c)
+            CellIndex[r][c] = static_cast<int32_t>(Cells.size());
+        stuDocTableCell Cell;
+        Cell.Row = static_cast<int16_t>(Row);
+        Cell.RowSpan = static_cast<int16_t>(RowSpan);
+        Cell.Col = static_cast<int16_t>(Col);
+        Cell.ColSpan = static_cast<int16_t>(ColSpan);
+        Cells.push_back(Cell);
+      }
+    //@NOTE: Spans may still leave a single row or column of cells, when the
+    //       inner rulers do not cross the grid
+    std::unordered_set<int16_t> CellRows, CellCols;
+    for (const auto &Cell : Cells) {
+      CellRows.insert(Cell.Row);
+      CellCols.insert(Cell.Col);
+    }
+    if (CellRows.size() < MIN_TABLE_ROWS || CellCols.size() < MIN_TABLE_COLS)
+      continue;
+
+    Table->BoundingBox =
+        stuBoundingBox(ColPositions.front(), RowPositions.front(),
+                       ColPositions.back(), RowPositions.back());
+    std::unordered_set<const stuDocItem *> RulerItems;
+    for (auto Index : HIndices)
+      for (const auto &Item : HorizontalRulers[Index].Items) {
+        Table->BoundingBox.unionWith_(Item->BoundingBox);
+        Table->Elements.push_back(Item);
+        RulerItems.insert(Item.get());
+      }
+    for (auto Index : VIndices)
+      for (const auto &Item : VerticalRulers[Index].Items) {
+        Table->BoundingBox.unionWith_(Item->BoundingBox);
+        Table->Elements.push_back(Item);
+        RulerItems.insert(Item.get());
+      }
+
+    auto InflatedBounds = Table->BoundingBox;
+    InflatedBounds.Origin.X -= TABLE_CONTAINMENT_TOLERANCE;
+    InflatedBounds.Origin.Y -= TABLE_CONTAINMENT_TOLERANCE;
+    InflatedBounds.Size.Width += 2 * TABLE_CONTAINMENT_TOLERANCE;
+    InflatedBounds.Size.Height += 2 * TABLE_CONTAINMENT_TOLERANCE;
+
+    std::vector<DocItemPtrVector_t> CellChars(Cells.size());
+    for (size_t i = 0; i < _docItems.size(); ++i) {
+      const auto &Item = _docItems[i];
+      //@NOTE: Besides the rulers, only the cell shading goes with the table.
+      //       Images and other paths inside it stay on the page as figures.
+      if (Item->Type != enuDocItemType::Char) {
+        if (RulerItems.count(Item.get()) > 0) {
+          ItemIsConsumed[i] = true;
+        } else if ((Item->Type == enuDocItemType::SolidRectangle ||
+                    Item->Type == enuDocItemType::Background) &&
+                   InflatedBounds.contains(Item->BoundingBox)) {
+          Table->Elements.push_back(Item);
+          ItemIsConsumed[i] = true;
+        }
+        continue;
+      }
+      float X = Item->BoundingBox.centerX(), Y = Item->BoundingBox.centerY();
+      if (X <= ColPositions.front() || X >= ColPositions.back() ||
+          Y <= RowPositions.front() || Y >= RowPositions.back())
+        continue;
+      auto Index =
+          CellIndex[findSlot(RowPositions, Y)][findSlot(ColPositions, X)];
+      CellChars[static_cast<size_t>(Index)].push_back(Item);
+      ItemIsConsumed[i] = true;
+    }
+    for (size_t i = 0; i < Cells.size(); ++i)
+      if (!CellChars[i].empty())
+        Cells[i].Text = makeCellTextBlock(std::move(CellChars[i]));
+
+    Result.push_back(Table);
+  }
+
+  if (Result.size()) {
+    size_t Kept = 0;
+    for (size_t i = 0; i < _docItems.size(); ++i)
+      if (!ItemIsConsumed[i]) _docItems[Kept++] = std::move(_docItems[i]);
+    _docItems.resize(Kept);
+  }
+  return Result;
+}
+
+DocItemPtrVector_t tableSeparators(const DocBlockPtrVector_t &_tableBlocks) {
+  return map(_tableBlocks, [](const clsDocBlockPtr &e) {
+    return std::make_shared<stuDocItem>(e->BoundingBox, enuDocItemType::None,
+                                        NAN, NAN, NAN, 0);
+  });
+}
+
+}  // namespace PDFLA
+}  // namespace Targoman
@@ -0,0 +1,28 @@
+#ifndef __TARGOMAN_PDFLA_TABLES__
+#define __TARGOMAN_PDFLA_TABLES__
+
+#include "dla.h"
+
+namespace Targoman {
+namespace PDFLA {
+
+/**
+ * Finds the ruled tables of a page from its horizontal and vertical rulers and
+ * returns them as table blocks whose cells hold the enclosed text. Grids of a
+ * single row or column (like page frames) are not tables. The chars of the
+ * cells, the rulers and the cell shading are removed from `_docItems` so the
+ * rest of the analysis never sees them, while images and other paths inside
+ * the tables are left as figures.
+ */
+Targoman::DLA::DocBlockPtrVector_t extractPageTables(
+    Targoman::DLA::DocItemPtrVector_t &_docItems);
+
+// Items spanning the tables, for the rest of the analysis to keep text blocks
+// and whitespace covers from running across them
+Targoman::DLA::DocItemPtrVector_t tableSeparators(
+    const Targoman::DLA::DocBlockPtrVector_t &_tableBlocks);
+
+}  // namespace PDFLA
+}  // namespace Targoman
+
+#endif  // __TARGOMAN_PDFLA_TABLES__
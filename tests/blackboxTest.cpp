@@ -1,6 +1,9 @@
 
 #include <pdfla/pdfla.h>
 
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -33,17 +36,85 @@ std::vector<uint8_t> readFileContents(const char *_filePath) {
   return FileContents;
 }
 
+const char *modeName(enuSegmentationMode _mode) {
+  return _mode == enuSegmentationMode::XYCut ? "xycut" : "whitespace";
+}
+
+// The value of a `--_name=value` argument, or false for other arguments
+bool parseArgument(const std::string &_argument, const std::string &_name,
+                   std::string &_value) {
+  auto Prefix = "--" + _name + "=";
+  if (_argument.compare(0, Prefix.size(), Prefix) != 0) return false;
+  _value = _argument.substr(Prefix.size());
+  return true;
+}
+
+// The value of option `_name` from the last `--_name=value` argument, or else
+// from its environment variable (e.g. PDFLA_MAX_COVERS for max-covers)
+bool optionValue(int _argc, char **_argv, const std::string &_name,
+                 std::string &_value) {
+  for (int i = _argc - 1; i > 0; --i)
+    if (parseArgument(_argv[i], _name, _value)) return true;
+  std::string Variable = "PDFLA_";
+  for (char C : _name)
+    Variable += C == '-' ? '_' : static_cast<char>(std::toupper(C));
+  const char *Value = std::getenv(Variable.c_str());
+  if (Value == nullptr) return false;
+  _value = Value;
+  return true;
+}
+
+// Reads the preset and the fields of the options given on the command line or
+// in the environment into `_options`, false on invalid values
+bool parseOptions(int _argc, char **_argv, stuPdfLaOptions &_options,
+                  std::string &_presetName) {
+  std::string Value;
+  _presetName = "balanced";
+  if (optionValue(_argc, _argv, "preset", Value)) _presetName = Value;
+  if (_presetName == "fast")
+    _options = stuPdfLaOptions::fast();
+  else if (_presetName == "balanced")
+    _options = stuPdfLaOptions::balanced();
+  else if (_presetName == "accurate")
+    _options = stuPdfLaOptions::accurate();
+  else
+    return false;
+
+  char *End;
+  if (optionValue(_argc, _argv, "max-covers", Value)) {
+    _options.MaxCovers = std::strtoul(Value.c_str(), &End, 10);
+    if (Value.empty() || *End != '\0') return false;
+  }
+  if (optionValue(_argc, _argv, "max-cover-candidates", Value)) {
+    _options.MaxCoverCandidates = std::strtoul(Value.c_str(), &End, 10);
+    if (Value.empty() || *End != '\0') return false;
+  }
+  if (optionValue(_argc, _argv, "word-gap-multiplier", Value)) {
+    _options.WordSeparationThresholdMultiplier =
+        std::strtof(Value.c_str(), &End);
+    if (Value.empty() || *End != '\0' ||
+        _options.WordSeparationThresholdMultiplier <= 0)
+      return false;
+  }
+  return true;
+}
+
 cv::Rect bbox2CvRect(const stuBoundingBox &_bbox) {
   return cv::Rect(static_cast<int>(_bbox.left()), static_cast<int>(_bbox.top()),
                   static_cast<int>(_bbox.width()),
                   static_cast<int>(_bbox.height()));
 }
 
+// Each page is analyzed in every one of `_modes` and drawn with the blocks of
+// the first
 void processPdfFile(const std::string &_pdfFilePath, const std::string &_stem,
-                    const std::string &_debugOut, const std::vector<size_t> _pageIndexes, bool _enableDebugging = false) {
+                    const std::string &_debugOut, const std::vector<size_t> _pageIndexes,
+                    const stuPdfLaOptions &_options,
+                    const std::vector<enuSegmentationMode> &_modes,
+                    bool _enableDebugging = false) {
   auto PdfFileContent = readFileContents(_pdfFilePath.data());
-  auto PdfLa =
-      std::make_shared<clsPdfLa>(PdfFileContent.data(), PdfFileContent.size());
+  auto PdfLa = std::make_shared<clsPdfLa>(PdfFileContent.data(),
+                                          PdfFileContent.size(), _options);
 
   if(_enableDebugging)
     PdfLa->enableDebugging(fs::path(_pdfFilePath).stem());
@@ -56,8 +127,23 @@ void processPdfFile(const std::string &_pdfFilePath, const std::string &_stem,
 
   constexpr float Scale = 4;
   for (size_t PageIndex : PageIndexes) {
+    //@NOTE: Getting the size parses the page, so no mode pays for it
     auto Size = PdfLa->getPageSize(PageIndex);
-    auto Blocks = PdfLa->getPageBlocks(PageIndex);
+    auto toMs = [](std::chrono::steady_clock::duration _duration) {
+      return std::chrono::duration_cast<std::chrono::milliseconds>(_duration)
+          .count();
+    };
+    DocBlockPtrVector_t Blocks;
+    std::cout << "  page " << PageIndex << ":";
+    for (auto Mode : _modes) {
+      auto Start = std::chrono::steady_clock::now();
+      auto ModeBlocks = PdfLa->getPageBlocks(PageIndex, Mode);
+      auto End = std::chrono::steady_clock::now();
+      std::cout << "  " << modeName(Mode) << " " << ModeBlocks.size()
+                << " blocks in " << toMs(End - Start) << "ms";
+      if (Mode == _modes.front()) Blocks = std::move(ModeBlocks);
+    }
+    std::cout << std::endl;
     Size = Size.scale(Scale);
 
     auto PageMatrixData = PdfLa->renderPageImage(PageIndex, 0xffffffff, Size);
@@ -92,11 +178,51 @@ void processPdfFile(const std::string &_pdfFilePath, const std::string &_stem,
   }
 }
 
-int main(void) {
+// Usage: test_PDFLA [--mode=whitespace|xycut|both]
+//                    [--preset=fast|balanced|accurate] [--max-covers=N]
+//                    [--max-cover-candidates=N] [--word-gap-multiplier=X]
+// Options may also be given in the environment (e.g. PDFLA_PRESET=fast), so
+// scripts can sweep them without editing this file.
+int main(int argc, char **argv) {
   const std::string BasePath = "/data/Resources/Pdfs4LA/pdfs/col-2";
   const std::string DebugOutputPath =
       "/data/Work/Targoman/InternalProjects/TarjomyarV2/PDFA/debug";
 
+  for (int i = 1; i < argc; ++i) {
+    std::string Value;
+    if (!parseArgument(argv[i], "mode", Value) &&
+        !parseArgument(argv[i], "preset", Value) &&
+        !parseArgument(argv[i], "max-covers", Value) &&
+        !parseArgument(argv[i], "max-cover-candidates", Value) &&
+        !parseArgument(argv[i], "word-gap-multiplier", Value)) {
+      std::cerr << "Unknown argument `" << argv[i] << "`" << std::endl;
+      return 1;
+    }
+  }
+
+  // Compare presets across separate runs, as analyzing a page again is faster
+  // once PDFium has parsed it.
+  stuPdfLaOptions Options;
+  std::string PresetName;
+  if (!parseOptions(argc, argv, Options, PresetName)) {
+    std::cerr << "Invalid options" << std::endl;
+    return 1;
+  }
+
+  // Both segmentation modes are compared on every page unless one is chosen
+  std::vector<enuSegmentationMode> Modes{enuSegmentationMode::WhitespaceCover,
+                                         enuSegmentationMode::XYCut};
+  std::string Mode;
+  if (optionValue(argc, argv, "mode", Mode)) {
+    if (Mode != "whitespace" && Mode != "xycut" && Mode != "both") {
+      std::cerr << "Invalid mode `" << Mode << "`" << std::endl;
+      return 1;
+    }
+    Modes.clear();
+    if (Mode != "xycut") Modes.push_back(enuSegmentationMode::WhitespaceCover);
+    if (Mode != "whitespace") Modes.push_back(enuSegmentationMode::XYCut);
+  }
+
   const std::vector<std::tuple<std::string, std::vector<size_t>>> ChosenPdfs{
       {"bi-1097.pdf", {1, 5}},
       // { "bi-1121", { 0 } }
@@ -120,8 +246,14 @@ int main(void) {
 
   std::cout << "Searching `" << BasePath << "` ..." << std::endl;
   for (auto &[Path, Pages] : PdfFilePaths) {
-      std::cout << Path.native() << std::endl;
-      processPdfFile(Path, Path.stem(), DebugOutputPath, Pages, ChosenPdfs.size() > 0);
+      std::cout << Path.native() << "  (preset=" << PresetName
+                << " max-covers=" << Options.MaxCovers
+                << " max-cover-candidates=" << Options.MaxCoverCandidates
+                << " word-gap-multiplier="
+                << Options.WordSeparationThresholdMultiplier << ")"
+                << std::endl;
+      processPdfFile(Path, Path.stem(), DebugOutputPath, Pages, Options,
+                     Modes, ChosenPdfs.size() > 0);
   }
   return 0;
 }
\ No newline at end of file
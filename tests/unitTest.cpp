@@ -0,0 +1,949 @@
+
+#include <signal.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "clsCoverIndex.h"
+#include "clsPageFurnitureIndex.h"
+#include "clsPdfLaWorkerPool.h"
+#include "clsSharedRingBuffer.h"
+#include "clsStrand.h"
+#include "clsWordGapStatistics.h"
+#include "dla.h"
+#include "parallelAlgorithm.hpp"
+#include "pdfla.h"
+#include "readingOrder.h"
+#include "serialization.h"
+#include "tables.h"
+
+using namespace Targoman::DLA;
+using namespace Targoman::Common;
+using namespace Targoman::PDFLA;
+
+int Failures = 0;
+
+void check(bool _condition, const std::string &_what) {
+  if (_condition) return;
+  ++Failures;
+  std::cerr << "FAILED: " << _what << std::endl;
+}
+
+bool isClose(float _a, float _b, float _tolerance) {
+  return std::abs(_a - _b) <= _tolerance;
+}
+
+// A PDF whose pages hold a few lines of `_text`, so the analysis is tested on
+// generated documents instead of sample files
+std::vector<uint8_t> makeTestPdf(size_t _numberOfPages,
+                                 const std::string &_text) {
+  constexpr size_t LINES_PER_PAGE = 6;
+  std::string Kids;
+  for (size_t i = 0; i < _numberOfPages; ++i)
+    Kids += std::to_string(4 + 2 * i) + " 0 R ";
+  std::vector<std::string> Objects{
+      "<< /Type /Catalog /Pages 2 0 R >>",
+      "<< /Type /Pages /Kids [" + Kids + "] /Count " +
+          std::to_string(_numberOfPages) + " >>",
+      "<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica >>"};
+  for (size_t i = 0; i < _numberOfPages; ++i) {
+    std::string Content = "BT /F1 11 Tf 14 TL 72 720 Td";
+    for (size_t Line = 0; Line < LINES_PER_PAGE; ++Line)
+      Content += " (" + _text + " on page " + std::to_string(i) + ", line " +
+                 std::to_string(Line) + ") Tj T*";
+    Content += " ET";
+    Objects.push_back(
+        "<< /Type /Page /Parent 2 0 R /MediaBox [0 0 612 792] /Resources "
+        "<< /Font << /F1 3 0 R >> >> /Contents " +
+        std::to_string(5 + 2 * i) + " 0 R >>");
+    Objects.push_back("<< /Length " + std::to_string(Content.size()) +
+                      " >>\nstream\n" + Content + "\nendstream");
+  }
+
+  std::string Pdf = "%PDF-1.4\n";
+  std::vector<size_t> Offsets;
+  for (size_t i = 0; i < Objects.size(); ++i) {
+    Offsets.push_back(Pdf.size());
+    Pdf += std::to_string(i + 1) + " 0 obj\n" + Objects[i] + "\nendobj\n";
+  }
+  size_t XrefOffset = Pdf.size();
+  Pdf += "xref\n0 " + std::to_string(Objects.size() + 1) +
+         "\n0000000000 65535 f \n";
+  for (auto Offset : Offsets) {
+    char Entry[21];
+    std::snprintf(Entry, sizeof(Entry), "%010zu 00000 n \n", Offset);
+    Pdf += Entry;
+  }
+  Pdf += "trailer\n<< /Size " + std::to_string(Objects.size() + 1) +
+         " /Root 1 0 R >>\nstartxref\n" + std::to_string(XrefOffset) +
+         "\n%%EOF\n";
+  return std::vector<uint8_t>(Pdf.begin(), Pdf.end());
+}
+
+// A thin line from (_x0, _y0) to (_x1, _y1), which is either horizontal or
+// vertical
+DocItemPtr_t makeRuler(float _x0, float _y0, float _x1, float _y1) {
+  constexpr float HALF_THICKNESS = 0.25f;
+  if (_y0 == _y1)
+    return std::make_shared<stuDocItem>(
+        stuBoundingBox(_x0, _y0 - HALF_THICKNESS, _x1, _y0 + HALF_THICKNESS),
+        enuDocItemType::HorizontalLine, NAN, NAN, NAN, 0);
+  return std::make_shared<stuDocItem>(
+      stuBoundingBox(_x0 - HALF_THICKNESS, _y0, _x0 + HALF_THICKNESS, _y1),
+      enuDocItemType::VerticalLine, NAN, NAN, NAN, 0);
+}
+
+// The chars of a line of `_text` whose top left corner is (_left, _top)
+DocItemPtrVector_t makeChars(float _left, float _top,
+                             const std::wstring &_text) {
+  constexpr float CHAR_WIDTH = 5.f, CHAR_HEIGHT = 10.f, BASELINE = 8.f;
+  DocItemPtrVector_t Result;
+  for (auto Char : _text) {
+    Result.push_back(std::make_shared<stuDocItem>(
+        stuBoundingBox(_left, _top, _left + CHAR_WIDTH, _top + CHAR_HEIGHT),
+        enuDocItemType::Char, _top + BASELINE, _top, _top + CHAR_HEIGHT,
+        Char));
+    _left += CHAR_WIDTH;
+  }
+  return Result;
+}
+
+void append(DocItemPtrVector_t &_items, const DocItemPtrVector_t &_more) {
+  _items.insert(_items.end(), _more.begin(), _more.end());
+}
+
+std::vector<uint8_t> serializedBlocks(const DocBlockPtrVector_t &_blocks) {
+  std::vector<uint8_t> Buffer;
+  serializeBlocks(_blocks, Buffer);
+  return Buffer;
+}
+
+void testCompactDocItems() {
+  constexpr float MAX_COMPACT_ERROR = 0.07f;
+
+  stuDocItem Char(stuBoundingBox(72.3f, 100.1f, 78.9f, 111.6f),
+                  enuDocItemType::Char, 109.2f, 101.f, 111.5f, L'x');
+  Char.RepetitionPageOffset = -3;
+  auto RoundTrip = stuCompactDocItem::fromDocItem(Char).toDocItem();
+  check(RoundTrip->Type == enuDocItemType::Char && RoundTrip->Char == L'x' &&
+            RoundTrip->RepetitionPageOffset == -3,
+        "compact char keeps its type, code point and repetition");
+  check(isClose(RoundTrip->BoundingBox.left(), 72.3f, MAX_COMPACT_ERROR) &&
+            isClose(RoundTrip->BoundingBox.top(), 100.1f, MAX_COMPACT_ERROR) &&
+            isClose(RoundTrip->BoundingBox.right(), 78.9f,
+                    MAX_COMPACT_ERROR) &&
+            isClose(RoundTrip->BoundingBox.bottom(), 111.6f,
+                    MAX_COMPACT_ERROR),
+        "compact char keeps its bounds");
+  check(isClose(RoundTrip->Baseline, 109.2f, MAX_COMPACT_ERROR) &&
+            isClose(RoundTrip->Ascent, 101.f, MAX_COMPACT_ERROR) &&
+            isClose(RoundTrip->Descent, 111.5f, MAX_COMPACT_ERROR),
+        "compact char keeps its font metrics");
+
+  stuDocItem Figure(stuBoundingBox(10.f, 20.f, 300.f, 400.f),
+                    enuDocItemType::Image, NAN, NAN, NAN, 0);
+  RoundTrip = stuCompactDocItem::fromDocItem(Figure).toDocItem();
+  check(std::isnan(RoundTrip->Baseline) && std::isnan(RoundTrip->Ascent) &&
+            std::isnan(RoundTrip->Descent),
+        "compact figure keeps its non finite metrics");
+  check(RoundTrip->Type == enuDocItemType::Image &&
+            isClose(RoundTrip->BoundingBox.right(), 300.f, MAX_COMPACT_ERROR),
+        "compact figure keeps its type and bounds");
+
+  stuDocItem Infinite(stuBoundingBox(0.f, 0.f, 1.f, 1.f), enuDocItemType::Char,
+                      INFINITY, -INFINITY, 0.f, L'y');
+  RoundTrip = stuCompactDocItem::fromDocItem(Infinite).toDocItem();
+  check(!std::isfinite(RoundTrip->Baseline) &&
+            !std::isfinite(RoundTrip->Ascent),
+        "compact infinities stay non finite");
+
+  //@NOTE: Out of range items are clamped, but never collapse nor turn into
+  //       non finite values
+  stuDocItem Far(stuBoundingBox(9000.f, 9000.f, 9100.f, 9100.f),
+                 enuDocItemType::Char, 9050.f, 9000.f, 9100.f, L'z');
+  RoundTrip = stuCompactDocItem::fromDocItem(Far).toDocItem();
+  check(std::isfinite(RoundTrip->BoundingBox.right()) &&
+            RoundTrip->BoundingBox.width() > 0 &&
+            RoundTrip->BoundingBox.height() > 0 &&
+            std::isfinite(RoundTrip->Baseline),
+        "compact far item is clamped to a finite, non empty box");
+}
+
+void testStrandExceptions() {
+  clsThreadPool ThreadPool(2);
+  int32_t NumberOfRuns = 0;
+  bool FutureRethrew = false;
+  {
+    clsStrand Strand(ThreadPool);
+    Strand.post([]() { throw std::runtime_error("posted"); });
+    Strand.post([&]() { ++NumberOfRuns; });
+    auto Future =
+        Strand.submit([]() -> int { throw std::runtime_error("submitted"); });
+    Strand.post([&]() { ++NumberOfRuns; });
+    try {
+      Future.get();
+    } catch (const std::runtime_error &) {
+      FutureRethrew = true;
+    }
+    //@NOTE: Destroying the strand waits for it to become idle, which hangs
+    //       if a throwing task left it scheduled
+  }
+  check(NumberOfRuns == 2, "strand runs the tasks after throwing ones");
+  check(FutureRethrew, "strand futures rethrow the task exceptions");
+}
+
+void testParallelAlgorithms() {
+  clsThreadPool ThreadPool(4);
+  stuParallelPolicy Policy(ThreadPool, 1);
+  std::mt19937 Random(36);
+
+  //@NOTE: Sizes around the chunk size cover single, partial and many chunks
+  for (size_t Size : {static_cast<size_t>(1), MIN_PARALLEL_CHUNK_SIZE - 1,
+                      2 * MIN_PARALLEL_CHUNK_SIZE + 3,
+                      40 * MIN_PARALLEL_CHUNK_SIZE + 17}) {
+    std::vector<int32_t> Values(Size);
+    //@NOTE: Few distinct values, so the extremes tie across chunks
+    for (auto &Value : Values) Value = static_cast<int32_t>(Random() % 7);
+    auto Identity = [](int32_t _value) { return _value; };
+    auto AsDouble = [](int32_t _value) { return static_cast<double>(_value); };
+    auto IsOdd = [](int32_t _value) { return _value % 2 == 1; };
+    std::string Suffix = " (" + std::to_string(Size) + " items)";
+
+    check(argmax(Policy, Values, Identity) == argmax(Values, Identity),
+          "parallel argmax picks the first maximum" + Suffix);
+    check(argmin(Policy, Values, Identity) == argmin(Values, Identity),
+          "parallel argmin picks the first minimum" + Suffix);
+    check(map(Policy, Values, IsOdd) == map(Values, IsOdd),
+          "parallel map to bool matches the serial one" + Suffix);
+    check(map(Policy, Values, AsDouble) == map(Values, AsDouble),
+          "parallel map matches the serial one" + Suffix);
+    check(filter(Policy, Values, IsOdd) == filter(Values, IsOdd),
+          "parallel filter keeps the serial order" + Suffix);
+    check(isClose(mean(Policy, Values, AsDouble), mean(Values, AsDouble),
+                  1e-9f) &&
+              isClose(var(Policy, Values, AsDouble), var(Values, AsDouble),
+                      1e-6f) &&
+              isClose(Targoman::Common::std(Policy, Values, AsDouble),
+                      Targoman::Common::std(Values, AsDouble), 1e-6f),
+          "parallel moments match the serial ones" + Suffix);
+  }
+
+  std::vector<int32_t> Values(40 * MIN_PARALLEL_CHUNK_SIZE, 1);
+  bool Rethrew = false;
+  try {
+    map(Policy, Values, [](int32_t _value) {
+      if (_value == 1) throw std::runtime_error("mapped");
+      return _value;
+    });
+  } catch (const std::runtime_error &) {
+    Rethrew = true;
+  }
+  check(Rethrew, "parallel map rethrows after all chunks are done");
+
+  //@NOTE: One item per chunk, as for whole pages
+  std::vector<int32_t> Pages{3, 1, 4, 1, 5, 9, 2, 6, 5};
+  std::set<std::thread::id> ThreadIds;
+  std::mutex ThreadIdsLock;
+  auto Squares = map(stuParallelPolicy(ThreadPool, 2, 1), Pages,
+                     [&](int32_t _value) {
+                       std::this_thread::sleep_for(
+                           std::chrono::milliseconds(20));
+                       std::lock_guard<std::mutex> Guard(ThreadIdsLock);
+                       ThreadIds.insert(std::this_thread::get_id());
+                       return _value * _value;
+                     });
+  check(Squares == map(Pages, [](int32_t _value) { return _value * _value; }),
+        "parallel map of single item chunks keeps the order");
+  check(ThreadIds.size() > 1, "single item chunks run concurrently");
+}
+
+void testCoverIndex() {
+  std::mt19937 Random(49);
+  std::uniform_real_distribution<float> Coordinate(0.f, 600.f);
+  std::uniform_real_distribution<float> Extent(0.f, 80.f);
+  auto randomBox = [&](float _maxHeight) {
+    float Left = Coordinate(Random), Top = Coordinate(Random);
+    float Height = std::uniform_real_distribution<float>(0.f, _maxHeight)(
+        Random);
+    return stuBoundingBox(Left, Top, Left + Extent(Random), Top + Height);
+  };
+
+  size_t Mismatches = 0;
+  for (size_t Round = 0; Round < 200; ++Round) {
+    float Margin = static_cast<float>(Round % 4) * 2.f;
+    BoundingBoxPtrVector_t Covers;
+    size_t NumberOfCovers = Random() % 60;
+    for (size_t i = 0; i < NumberOfCovers; ++i)
+      Covers.push_back(std::make_shared<stuBoundingBox>(
+          randomBox(Round % 2 ? 400.f : 3 * Margin + 1.f)));
+    clsCoverIndex Index(Covers, Margin);
+
+    //@NOTE: Short boxes, up to twice the margin tall, take another path
+    std::vector<stuBoundingBox> Boxes;
+    for (size_t i = 0; i < 100; ++i)
+      Boxes.push_back(randomBox(i % 2 ? 4 * Margin + 1.f : 200.f));
+    auto Batched = Index.crosses(Boxes);
+    for (size_t i = 0; i < Boxes.size(); ++i) {
+      bool Expected = false;
+      for (const auto &Cover : Covers)
+        Expected = Expected || (Cover->left() < Boxes[i].right() &&
+                                Cover->right() > Boxes[i].left() &&
+                                Cover->verticalOverlap(Boxes[i]) > Margin);
+      if (Index.crosses(Boxes[i]) != Expected || Batched[i] != Expected)
+        ++Mismatches;
+    }
+  }
+  check(Mismatches == 0, "cover index matches a linear scan of the covers");
+}
+
+void testRadixSort() {
+  std::mt19937_64 Random(48);
+  for (size_t Size : {0, 1, 2, 1000}) {
+    for (uint64_t Mask : {0xffULL, 0xffff0000ffULL, ~0ULL}) {
+      std::vector<uint64_t> Keys(Size);
+      for (auto &Key : Keys) Key = Random() & Mask;
+      std::vector<uint32_t> Expected(Size);
+      std::iota(Expected.begin(), Expected.end(), 0);
+      std::stable_sort(
+          Expected.begin(), Expected.end(),
+          [&](uint32_t a, uint32_t b) { return Keys[a] < Keys[b]; });
+      check(radixSortIndices(Keys) == Expected,
+            "radix sort matches a stable sort (" + std::to_string(Size) +
+                " keys)");
+    }
+  }
+
+  constexpr float QUANTUM = 0.25f;
+  std::uniform_real_distribution<float> Coordinate(-1000.f, 1000.f);
+  auto quantaOf = [&](float _value) {
+    return std::llround(static_cast<double>(_value) / QUANTUM);
+  };
+  size_t Misordered = 0;
+  for (size_t i = 0; i < 10000; ++i) {
+    //@NOTE: Coarse values, so equal quanta are common
+    float Major1 = std::round(Coordinate(Random)) / 8,
+          Minor1 = Coordinate(Random);
+    float Major2 = i % 3 ? Major1 : std::round(Coordinate(Random)) / 8,
+          Minor2 = Coordinate(Random);
+    bool Expected = std::make_pair(quantaOf(Major1), quantaOf(Minor1)) <
+                    std::make_pair(quantaOf(Major2), quantaOf(Minor2));
+    if ((packSortKey(Major1, Minor1, QUANTUM) <
+         packSortKey(Major2, Minor2, QUANTUM)) != Expected)
+      ++Misordered;
+  }
+  check(Misordered == 0, "sort keys order negative and positive coordinates");
+  check(packSortKey(NAN, 3.f, QUANTUM) == packSortKey(0.f, 3.f, QUANTUM) &&
+            packSortKey(3.f, NAN, QUANTUM) == packSortKey(3.f, 0.f, QUANTUM),
+        "sort keys place NaN at zero");
+  check(packSortKey(-INFINITY, 0.f, QUANTUM) ==
+                packSortKey(-1e30f, 0.f, QUANTUM) &&
+            packSortKey(-INFINITY, 0.f, QUANTUM) <
+                packSortKey(-1000.f, 0.f, QUANTUM) &&
+            packSortKey(1e30f, 0.f, QUANTUM) ==
+                packSortKey(INFINITY, 0.f, QUANTUM) &&
+            packSortKey(INFINITY, -INFINITY, QUANTUM) >
+                packSortKey(1000.f, 1000.f, QUANTUM),
+        "sort keys clamp out of range coordinates");
+}
+
+void testViews() {
+  std::mt19937 Random(35);
+  auto IsOdd = [](int32_t _value) { return _value % 2 != 0; };
+  auto Square = [](int32_t _value) { return _value * _value; };
+  auto collect = [](const auto &_view) {
+    std::vector<int32_t> Result;
+    for (auto Value : _view) Result.push_back(Value);
+    return Result;
+  };
+  for (size_t Round = 0; Round < 100; ++Round) {
+    std::vector<int32_t> First(Random() % 20), Second(Random() % 20);
+    for (auto &Value : First) Value = static_cast<int32_t>(Random() % 100);
+    for (auto &Value : Second) Value = static_cast<int32_t>(Random() % 100);
+    auto Both = cat(First, Second);
+
+    check(collect(filter_view(First, IsOdd)) == filter(First, IsOdd),
+          "filter view matches filter");
+    check(collect(map_view(First, Square)) == map(First, Square) &&
+              map_view(First, Square).size() == First.size(),
+          "map view matches map");
+    auto Concatenated = cat_view(First, Second);
+    check(collect(Concatenated) == Both && Concatenated.size() == Both.size(),
+          "cat view matches cat");
+    bool SameItems = true;
+    for (size_t i = 0; i < Both.size(); ++i)
+      SameItems = SameItems && Concatenated[i] == Both[i];
+    check(SameItems, "cat view indexes both vectors");
+    check(collect(map_view(filter_view(cat_view(First, Second), IsOdd),
+                           Square)) == map(filter(Both, IsOdd), Square),
+          "nested views match the eager algorithms");
+
+    auto InPlace = Both;
+    filter_inplace(InPlace, IsOdd);
+    check(InPlace == filter(Both, IsOdd) &&
+              filter(std::vector<int32_t>(Both), IsOdd) == InPlace,
+          "in place and consuming filters match filter");
+    auto [Odd, Even] = split(std::vector<int32_t>(Both), IsOdd);
+    check(Odd == filter(Both, IsOdd) &&
+              Even == filter(Both, [&](int32_t e) { return !IsOdd(e); }),
+          "consuming split keeps the order of both parts");
+  }
+}
+
+void testSharedRingBuffer() {
+  clsSharedRingBuffer Ring(100);
+  check(Ring.isValid() && Ring.capacity() == 128,
+        "ring capacity is rounded up to a power of two");
+  if (Ring.isValid() == false) return;
+
+  constexpr size_t STREAM_SIZE = 1 << 20;
+  auto byteAt = [](size_t _position) {
+    return static_cast<uint8_t>((_position * 2654435761u) >> 13);
+  };
+  std::thread Producer([&]() {
+    std::mt19937 Random(33);
+    uint8_t Chunk[300];
+    for (size_t Written = 0; Written < STREAM_SIZE;) {
+      size_t Size = std::min<size_t>(Random() % sizeof(Chunk) + 1,
+                                     STREAM_SIZE - Written);
+      for (size_t i = 0; i < Size; ++i) Chunk[i] = byteAt(Written + i);
+      size_t Done = 0;
+      while (Done < Size) {
+        Done += Ring.write(Chunk + Done, Size - Done);
+        if (Done < Size) std::this_thread::yield();
+      }
+      Written += Size;
+    }
+  });
+
+  std::mt19937 Random(34);
+  uint8_t Chunk[300];
+  size_t Corrupted = 0, Overreported = 0;
+  for (size_t Read = 0; Read < STREAM_SIZE;) {
+    size_t Readable = Ring.readable();
+    if (Readable == 0) {
+      std::this_thread::yield();
+      continue;
+    }
+    size_t Wanted = Random() % 2 ? Readable : Random() % sizeof(Chunk) + 1;
+    Wanted = std::min(Wanted, sizeof(Chunk));
+    size_t Size = Ring.read(Chunk, Wanted);
+    if (Readable > Ring.capacity() || Size < std::min(Wanted, Readable))
+      ++Overreported;
+    for (size_t i = 0; i < Size; ++i)
+      if (Chunk[i] != byteAt(Read + i)) ++Corrupted;
+    Read += Size;
+  }
+  Producer.join();
+  check(Corrupted == 0, "ring delivers the stream in order across wraps");
+  check(Overreported == 0, "ring reads all the bytes it reports readable");
+  check(Ring.readable() == 0 && Ring.read(Chunk, sizeof(Chunk)) == 0,
+        "drained ring is empty");
+}
+
+void testSerialization() {
+  std::mt19937 Random(38);
+  std::uniform_real_distribution<float> Coordinate(-50.f, 700.f);
+  auto randomBox = [&]() {
+    float Left = Coordinate(Random), Top = Coordinate(Random);
+    return stuBoundingBox(Left, Top, Left + 20.f, Top + 10.f);
+  };
+
+  for (size_t Round = 0; Round < 50; ++Round) {
+    DocItemPtrVector_t Items;
+    for (size_t i = 0; i < 30; ++i)
+      Items.push_back(std::make_shared<stuDocItem>(
+          randomBox(), i % 5 ? enuDocItemType::Char : enuDocItemType::Image,
+          i % 5 ? Coordinate(Random) : NAN, Coordinate(Random),
+          Coordinate(Random), static_cast<wchar_t>(L'a' + i)));
+    auto randomItems = [&]() {
+      DocItemPtrVector_t Result;
+      for (size_t i = Random() % 6; i > 0; --i)
+        Result.push_back(Items[Random() % Items.size()]);
+      return Result;
+    };
+    DocLinePtrVector_t Lines;
+    for (int32_t i = 0; i < 8; ++i)
+      Lines.push_back(std::make_shared<stuDocLine>(
+          stuDocLine{randomBox(), Coordinate(Random), i,
+                     static_cast<enuListType>(i % 3), Coordinate(Random),
+                     randomItems()}));
+
+    DocBlockPtrVector_t Blocks;
+    for (size_t i = 0; i < 12; ++i) {
+      clsDocBlockPtr Block;
+      switch (Random() % 4) {
+        case 0:
+          Block.reset(new stuDocTextBlock);
+          for (size_t j = Random() % 3; j > 0; --j)
+            Block.asText()->Lines.push_back(Lines[Random() % Lines.size()]);
+          Block.asText()->Association =
+              static_cast<enuDocTextBlockAssociation>(Random() % 3);
+          if (Blocks.size() && Random() % 2)
+            Block.asText()->AssociatedBlock = Blocks[Random() % Blocks.size()];
+          break;
+        case 1:
+          Block.reset(new stuDocFigureBlock);
+          if (Blocks.size()) Block.asFigure()->Caption = Blocks.back();
+          break;
+        case 2: {
+          Block.reset(new stuDocTableBlock);
+          clsDocBlockPtr Cell;
+          Cell.reset(new stuDocTextBlock);
+          Cell.asText()->Lines.push_back(Lines.front());
+          Block.asTable()->Cells.push_back({Cell, 1, 2, 3, 1});
+          break;
+        }
+        default:
+          Block.reset(new stuDocFormulaeBlock);
+          Block.asFormulae()->LatexSource = L"\\frac{a}{b}";
+      }
+      Block->BoundingBox = randomBox();
+      Block->Area = static_cast<enuDocArea>(Random() % 6);
+      Block->ReadingOrder = static_cast<int32_t>(i);
+      Block->Elements = randomItems();
+      Blocks.push_back(Block);
+    }
+
+    std::vector<uint8_t> Buffer, RoundTrip;
+    serializeBlocks(Blocks, Buffer);
+    DocBlockPtrVector_t Restored;
+    check(deserializeBlocks(Buffer.data(), Buffer.size(), Restored) &&
+              Restored.size() == Blocks.size(),
+          "serialized blocks are restored");
+    serializeBlocks(Restored, RoundTrip);
+    check(RoundTrip == Buffer, "restored blocks serialize to the same bytes");
+
+    //@NOTE: The first two lines of text blocks may be the same line, which
+    //       must still be a single object once restored
+    for (size_t i = 0; i < Blocks.size(); ++i) {
+      if (Blocks[i]->Type != enuDocBlockType::Text ||
+          Blocks[i].asText()->Lines.size() < 2)
+        continue;
+      auto &Original = Blocks[i].asText()->Lines;
+      auto &Copy = Restored[i].asText()->Lines;
+      check((Original[0] == Original[1]) == (Copy[0] == Copy[1]),
+            "restored blocks keep their shared lines");
+    }
+
+    size_t Accepted = 0;
+    for (size_t Size = 0; Size < Buffer.size(); ++Size) {
+      DocBlockPtrVector_t Truncated;
+      if (deserializeBlocks(Buffer.data(), Size, Truncated)) ++Accepted;
+    }
+    check(Accepted == 0, "truncated buffers are rejected");
+    //@NOTE: Corrupt buffers may decode to other blocks, but must never be
+    //       read out of bounds
+    for (size_t i = 0; i < 20; ++i) {
+      auto Corrupt = Buffer;
+      Corrupt[Random() % Corrupt.size()] ^= static_cast<uint8_t>(Random());
+      DocBlockPtrVector_t Ignored;
+      deserializeBlocks(Corrupt.data(), Corrupt.size(), Ignored);
+    }
+  }
+}
+
+void testTables() {
+  const std::vector<float> XS{100.f, 200.f, 300.f, 400.f};
+  const std::vector<float> YS{100.f, 130.f, 160.f, 190.f};
+  auto cellTextOf = [](const stuDocTableCell &_cell) {
+    std::wstring Text;
+    clsDocBlockPtr Block = _cell.Text;
+    if (Block.get() != nullptr)
+      for (const auto &Line : Block.asText()->Lines)
+        for (const auto &Item : Line->Items) Text.push_back(Item->Char);
+    return Text;
+  };
+
+  {
+    DocItemPtrVector_t Items;
+    for (auto Y : YS) Items.push_back(makeRuler(XS.front(), Y, XS.back(), Y));
+    for (auto X : XS) Items.push_back(makeRuler(X, YS.front(), X, YS.back()));
+    for (size_t Row = 0; Row < 3; ++Row)
+      for (size_t Col = 0; Col < 3; ++Col)
+        append(Items, makeChars(XS[Col] + 10.f, YS[Row] + 10.f,
+                                std::to_wstring(Row * 3 + Col)));
+    auto Image = std::make_shared<stuDocItem>(
+        stuBoundingBox(250.f, 135.f, 260.f, 145.f), enuDocItemType::Image,
+        NAN, NAN, NAN, 0);
+    Items.push_back(Image);
+    append(Items, makeChars(100.f, 300.f, L"After"));
+
+    auto Tables = extractPageTables(Items);
+    check(Tables.size() == 1 && Tables.front().asTable()->Cells.size() == 9,
+          "ruled grid is a table of 3x3 cells");
+    if (Tables.size() == 1 && Tables.front().asTable()->Cells.size() == 9) {
+      const auto &Cells = Tables.front().asTable()->Cells;
+      bool CellsMatch = true;
+      for (size_t i = 0; i < Cells.size(); ++i)
+        CellsMatch = CellsMatch &&
+                     Cells[i].Row == static_cast<int16_t>(i / 3) &&
+                     Cells[i].Col == static_cast<int16_t>(i % 3) &&
+                     Cells[i].RowSpan == 1 && Cells[i].ColSpan == 1 &&
+                     cellTextOf(Cells[i]) == std::to_wstring(i);
+      check(CellsMatch, "grid cells hold their own text");
+    }
+    check(Items.size() == 6 && Items.front() == Image,
+          "table consumes its rulers and chars but keeps images");
+  }
+
+  {
+    //@NOTE: A page frame with a header rule, and one with a column divider
+    DocItemPtrVector_t Frame{makeRuler(50.f, 50.f, 550.f, 50.f),
+                             makeRuler(50.f, 750.f, 550.f, 750.f),
+                             makeRuler(50.f, 50.f, 50.f, 750.f),
+                             makeRuler(550.f, 50.f, 550.f, 750.f)};
+    for (float Y = 120.f; Y < 700.f; Y += 14.f) {
+      append(Frame, makeChars(60.f, Y, L"Paragraph text in the left column"));
+      append(Frame, makeChars(310.f, Y, L"Paragraph text on the right"));
+    }
+    auto HeaderRuled = Frame;
+    HeaderRuled.push_back(makeRuler(50.f, 100.f, 550.f, 100.f));
+    auto Divided = Frame;
+    Divided.push_back(makeRuler(300.f, 50.f, 300.f, 750.f));
+    size_t Size = HeaderRuled.size();
+    check(extractPageTables(HeaderRuled).empty() &&
+              HeaderRuled.size() == Size,
+          "page frame with a header rule is not a table");
+    check(extractPageTables(Divided).empty() && Divided.size() == Size,
+          "page frame with a column divider is not a table");
+  }
+
+  {
+    //@NOTE: The header row has no inner vertical rulers, and the rule under
+    //       the middle row leaves out the first column
+    DocItemPtrVector_t Items{
+        makeRuler(XS[0], YS[0], XS[3], YS[0]),
+        makeRuler(XS[0], YS[1], XS[3], YS[1]),
+        makeRuler(XS[1], YS[2], XS[3], YS[2]),
+        makeRuler(XS[0], YS[3], XS[3], YS[3]),
+        makeRuler(XS[0], YS[0], XS[0], YS[3]),
+        makeRuler(XS[1], YS[1], XS[1], YS[3]),
+        makeRuler(XS[2], YS[1], XS[2], YS[3]),
+        makeRuler(XS[3], YS[0], XS[3], YS[3])};
+    append(Items, makeChars(220.f, 110.f, L"Header"));
+    append(Items, makeChars(110.f, 165.f, L"Tall"));
+
+    auto Tables = extractPageTables(Items);
+    check(Tables.size() == 1 && Tables.front().asTable()->Cells.size() == 6,
+          "grid with spanning cells is a table of 6 cells");
+    if (Tables.size() == 1 && Tables.front().asTable()->Cells.size() == 6) {
+      const auto &Cells = Tables.front().asTable()->Cells;
+      check(Cells[0].Row == 0 && Cells[0].Col == 0 &&
+                Cells[0].RowSpan == 1 && Cells[0].ColSpan == 3 &&
+                cellTextOf(Cells[0]) == L"Header",
+            "header cell spans all columns");
+      check(Cells[1].Row == 1 && Cells[1].Col == 0 &&
+                Cells[1].RowSpan == 2 && Cells[1].ColSpan == 1 &&
+                cellTextOf(Cells[1]) == L"Tall",
+            "first column cell spans two rows");
+    }
+    check(Items.empty(), "spanning table consumes all its items");
+  }
+}
+
+void testWordGapStatistics() {
+  constexpr float MULTIPLIER = 1.5f;
+  //@NOTE: Gaps cycle around the peak, as each gap also counts towards its
+  //       neighbouring ones
+  auto makeLine = [](float _top, float _fontSize, size_t _count,
+                     const std::vector<float> &_gaps) {
+    DocItemPtrVector_t Result;
+    float Left = 10.f;
+    for (size_t i = 0; i < _count; ++i) {
+      Result.push_back(std::make_shared<stuDocItem>(
+          stuBoundingBox(Left, _top, Left + _fontSize / 2, _top + _fontSize),
+          enuDocItemType::Char, _top + 0.8f * _fontSize, _top,
+          _top + _fontSize, L'x'));
+      Left += _fontSize / 2 + _gaps[i % _gaps.size()];
+    }
+    return Result;
+  };
+  auto charOfSize = [&](float _fontSize) {
+    return makeLine(0.f, _fontSize, 1, {0.f}).front();
+  };
+
+  DocItemPtrVector_t Chars;
+  append(Chars, makeLine(100.f, 10.f, 61, {3.f, 4.f, 5.f}));
+  append(Chars, makeLine(200.f, 20.f, 41, {7.f, 8.f, 9.f}));
+  append(Chars, makeLine(300.f, 30.f, 6, {20.f}));
+
+  clsWordGapStatistics Document(MULTIPLIER);
+  Document.addGaps(Chars);
+  Document.finalize();
+  check(isClose(Document.wordSeparationThreshold(charOfSize(10.f)),
+                MULTIPLIER * 4.f, 1e-4f) &&
+            isClose(Document.wordSeparationThreshold(charOfSize(20.f)),
+                    MULTIPLIER * 8.f, 1e-4f),
+        "dense font sizes take the peak of their own gaps");
+  //@NOTE: Scaled from the overall peak by the ratio to the dominant size
+  check(isClose(Document.wordSeparationThreshold(charOfSize(30.f)),
+                MULTIPLIER * 4.f * 3.f, 1e-4f) &&
+            isClose(Document.wordSeparationThreshold(charOfSize(15.f)),
+                    MULTIPLIER * 4.f * 1.5f, 1e-4f),
+        "sparse font sizes scale the threshold of the dominant one");
+
+  clsWordGapStatistics Page(MULTIPLIER, 600.f);
+  Page.addGaps(Chars);
+  Page.finalize();
+  check(isClose(Page.wordSeparationThreshold(charOfSize(10.f)),
+                MULTIPLIER * 4.f, 1e-4f) &&
+            isClose(Page.wordSeparationThreshold(charOfSize(30.f)),
+                    MULTIPLIER * 4.f, 1e-4f),
+        "page statistics share one threshold across font sizes");
+
+  //@NOTE: Gaps wider than the document histograms are still counted up to
+  //       the page width
+  DocItemPtrVector_t WideChars =
+      makeLine(100.f, 10.f, 41, {99.f, 100.f, 101.f});
+  append(WideChars, makeLine(200.f, 10.f, 22, {3.f, 4.f, 5.f}));
+  clsWordGapStatistics WidePage(MULTIPLIER, 600.f);
+  WidePage.addGaps(WideChars);
+  WidePage.finalize();
+  clsWordGapStatistics WideDocument(MULTIPLIER);
+  WideDocument.addGaps(WideChars);
+  WideDocument.finalize();
+  check(isClose(WidePage.wordSeparationThreshold(charOfSize(10.f)),
+                MULTIPLIER * 100.f, 1e-4f),
+        "page statistics count the gaps up to the page width");
+  check(isClose(WideDocument.wordSeparationThreshold(charOfSize(10.f)),
+                MULTIPLIER * 4.f, 1e-4f),
+        "document statistics skip the gaps wider than a word gap");
+}
+
+void testPageFurnitureIndex() {
+  constexpr size_t NUMBER_OF_PAGES = 5;
+  const stuSize PageSize(600.f, 800.f);
+  //@NOTE: The header jitters across a cell boundary on odd pages, the page
+  //       number grows a digit, and the watermarks are in the body area,
+  //       where DRAFT repeats on fewer pages than needed
+  auto pageItems = [](size_t _pageIndex) {
+    DocItemPtrVector_t Items;
+    append(Items, makeChars(_pageIndex % 2 ? 100.3f : 99.8f, 30.f,
+                            L"Annual Report"));
+    append(Items, makeChars(100.f, 200.f,
+                            L"Body of page " +
+                                std::wstring(1, L'a' + _pageIndex)));
+    if (_pageIndex < 2) append(Items, makeChars(250.f, 400.f, L"DRAFT"));
+    if (_pageIndex < 3) append(Items, makeChars(250.f, 500.f, L"COPY"));
+    append(Items, makeChars(280.f, 760.f,
+                            L"Page " + std::to_wstring(8 + _pageIndex)));
+    return Items;
+  };
+  auto textOf = [](const stuRepeatedElement &_element) {
+    std::wstring Text;
+    for (const auto &Item : _element.Items) Text.push_back(Item->Char);
+    return Text;
+  };
+
+  clsPageFurnitureIndex Index;
+  for (size_t PageIndex = 0; PageIndex < NUMBER_OF_PAGES; ++PageIndex)
+    Index.addPage(PageIndex, pageItems(PageIndex));
+
+  std::map<std::wstring, stuRepeatedElement> Elements;
+  for (auto &Element : Index.findRepeatedElements(1, pageItems(1), PageSize))
+    Elements.emplace(textOf(Element), Element);
+  auto Header = Elements.find(L"Annual Report");
+  check(Header != Elements.end() && Header->second.Area == enuDocArea::Header,
+        "running header is found across jittered pages");
+  auto Footer = Elements.find(L"Page 9");
+  check(Footer != Elements.end() && Footer->second.Area == enuDocArea::Footer,
+        "page number is found though its digits change");
+  check(Elements.count(L"DRAFT") == 0,
+        "text on two pages of the body is not a watermark");
+  auto Watermark = Elements.find(L"COPY");
+  check(Watermark != Elements.end() &&
+            Watermark->second.Area == enuDocArea::Watermark,
+        "text on three pages of the body is a watermark");
+  check(Elements.size() == 3, "page body is not furniture");
+  check(Header != Elements.end() &&
+            Header->second.RepetitionPageOffset == -1 &&
+            Header->second.Items.front()->RepetitionPageOffset == -1,
+        "repetitions point to the nearest page, the previous one on ties");
+
+  Elements.clear();
+  for (auto &Element : Index.findRepeatedElements(4, pageItems(4), PageSize))
+    Elements.emplace(textOf(Element), Element);
+  Footer = Elements.find(L"Page 12");
+  check(Elements.size() == 2 && Footer != Elements.end() &&
+            Footer->second.RepetitionPageOffset == -1,
+        "last page repeats the furniture of the previous one");
+}
+
+void testReadingOrder() {
+  auto makeBlock = [](float _left, float _top, float _right, float _bottom,
+                      enuDocArea _area = enuDocArea::Body) {
+    clsDocBlockPtr Block;
+    Block.reset(new stuDocTextBlock);
+    Block->BoundingBox = stuBoundingBox(_left, _top, _right, _bottom);
+    Block->Area = _area;
+    return Block;
+  };
+  //@NOTE: Blocks are given out of order, the result is checked as the input
+  //       positions of the sorted blocks
+  auto sortedPositions = [](const DocBlockPtrVector_t &_blocks) {
+    auto Sorted = _blocks;
+    sortBlocksInReadingOrder(Sorted);
+    std::vector<size_t> Result;
+    for (size_t i = 0; i < Sorted.size(); ++i) {
+      if (Sorted[i]->ReadingOrder != static_cast<int32_t>(i)) return Result;
+      Result.push_back(static_cast<size_t>(
+          std::find(_blocks.begin(), _blocks.end(), Sorted[i]) -
+          _blocks.begin()));
+    }
+    return Result;
+  };
+
+  //@NOTE: The blocks of each column share their left edge, and the right
+  //       column starts higher than the bottom of the first left block
+  DocBlockPtrVector_t Blocks{makeBlock(310.f, 260.f, 550.f, 400.f),
+                             makeBlock(50.f, 210.f, 290.f, 400.f),
+                             makeBlock(310.f, 100.f, 550.f, 250.f),
+                             makeBlock(50.f, 100.f, 290.f, 200.f)};
+  check(sortedPositions(Blocks) == std::vector<size_t>({3, 1, 2, 0}),
+        "columns are read one after the other");
+
+  //@NOTE: The right column is only below the header through the interval
+  //       the left column splits off at its right edge
+  Blocks = {makeBlock(50.f, 420.f, 550.f, 500.f),
+            makeBlock(310.f, 100.f, 550.f, 400.f),
+            makeBlock(50.f, 100.f, 290.f, 400.f),
+            makeBlock(50.f, 50.f, 550.f, 90.f)};
+  check(sortedPositions(Blocks) == std::vector<size_t>({3, 2, 1, 0}),
+        "full width blocks are read before and after the columns");
+
+  Blocks = {makeBlock(560.f, 750.f, 590.f, 770.f, enuDocArea::Footer),
+            makeBlock(100.f, 300.f, 500.f, 500.f, enuDocArea::Watermark),
+            makeBlock(5.f, 100.f, 45.f, 700.f, enuDocArea::LeftSidebar),
+            makeBlock(50.f, 100.f, 550.f, 700.f),
+            makeBlock(50.f, 20.f, 550.f, 40.f, enuDocArea::Header)};
+  check(sortedPositions(Blocks) == std::vector<size_t>({4, 3, 2, 0, 1}),
+        "header, body, sidebars and footer are read in turn, watermarks last");
+}
+
+void testConcurrentDocuments() {
+  constexpr size_t NUMBER_OF_PAGES = 8;
+  const stuSize RENDER_SIZE(153.f, 198.f);
+
+  //@NOTE: The async calls of both documents run on the shared executor at
+  //       once, so their PDFium calls overlap unless they are serialized
+  setAsyncConcurrency(4);
+  auto FirstPdf = makeTestPdf(NUMBER_OF_PAGES, "The first document");
+  auto SecondPdf = makeTestPdf(NUMBER_OF_PAGES, "The second document");
+  clsPdfLa First(FirstPdf.data(), FirstPdf.size());
+  clsPdfLa Second(SecondPdf.data(), SecondPdf.size());
+  check(First.pageCount() == NUMBER_OF_PAGES &&
+            Second.pageCount() == NUMBER_OF_PAGES,
+        "generated documents are loaded");
+
+  std::vector<std::future<DocBlockPtrVector_t>> FirstBlocks, SecondBlocks;
+  std::vector<std::future<std::vector<uint8_t>>> FirstImages, SecondImages;
+  for (size_t i = 0; i < NUMBER_OF_PAGES; ++i) {
+    FirstBlocks.push_back(First.getPageBlocksAsync(i));
+    SecondImages.push_back(Second.renderPageImageAsync(i, 0xffffffff,
+                                                       RENDER_SIZE));
+    SecondBlocks.push_back(Second.getPageBlocksAsync(i));
+    FirstImages.push_back(First.renderPageImageAsync(i, 0xffffffff,
+                                                     RENDER_SIZE));
+  }
+
+  bool BlocksMatch = true, ImagesMatch = true, HasBlocks = true;
+  for (size_t i = 0; i < NUMBER_OF_PAGES; ++i) {
+    auto Blocks = FirstBlocks[i].get();
+    HasBlocks = HasBlocks && Blocks.size() > 0;
+    BlocksMatch = BlocksMatch && serializedBlocks(Blocks) ==
+                                     serializedBlocks(First.getPageBlocks(i));
+    BlocksMatch = BlocksMatch &&
+                  serializedBlocks(SecondBlocks[i].get()) ==
+                      serializedBlocks(Second.getPageBlocks(i));
+    ImagesMatch = ImagesMatch &&
+                  FirstImages[i].get() ==
+                      First.renderPageImage(i, 0xffffffff, RENDER_SIZE);
+    ImagesMatch = ImagesMatch &&
+                  SecondImages[i].get() ==
+                      Second.renderPageImage(i, 0xffffffff, RENDER_SIZE);
+  }
+  check(HasBlocks, "generated pages have blocks");
+  check(BlocksMatch, "concurrent documents get the blocks of serial calls");
+  check(ImagesMatch, "concurrent documents render as serial calls do");
+}
+
+void testWorkerPoolRestart() {
+  auto Pdf = makeTestPdf(2, "A document analyzed by workers");
+  //@NOTE: Every (re)started worker reports its pid through the pipe
+  int PidPipe[2];
+  check(pipe(PidPipe) == 0, "pipe of the worker pids is created");
+  auto readWorkerPid = [&PidPipe]() {
+    pid_t Pid = -1;
+    if (read(PidPipe[0], &Pid, sizeof(Pid)) != sizeof(Pid)) return -1;
+    return Pid;
+  };
+  {
+    clsPdfLaWorkerPool Pool(Pdf.data(), Pdf.size(), 1,
+                            std::chrono::seconds(60),
+                            [&PidPipe](clsPdfLa &) {
+                              pid_t Pid = getpid();
+                              if (write(PidPipe[1], &Pid, sizeof(Pid)) < 0)
+                                _exit(1);
+                            });
+    check(Pool.pageCount() == 2, "worker reads the page count");
+    auto First = Pool.getPageBlocks(1);
+    pid_t FirstPid = readWorkerPid();
+    check(First.Status == enuPageJobStatus::Done && First.Blocks.size() > 0,
+          "worker analyzes a page");
+
+    kill(FirstPid, SIGKILL);
+    //@NOTE: A job sent before the worker is gone is reported as crashed, the
+    //       next one runs on the restarted worker
+    auto Second = Pool.getPageBlocks(1);
+    if (Second.Status == enuPageJobStatus::Crashed)
+      Second = Pool.getPageBlocks(1);
+    check(Second.Status == enuPageJobStatus::Done &&
+              serializedBlocks(Second.Blocks) ==
+                  serializedBlocks(First.Blocks),
+          "restarted worker analyzes the page again");
+    check(Pool.restartCount() >= 1 && readWorkerPid() != FirstPid,
+          "killed worker is replaced by a new one");
+    check(Pool.getPageBlocks(2).Status == enuPageJobStatus::Failed,
+          "worker rejects pages out of range");
+  }
+  close(PidPipe[0]);
+  close(PidPipe[1]);
+}
+
+int main(void) {
+  testCompactDocItems();
+  testStrandExceptions();
+  testParallelAlgorithms();
+  testCoverIndex();
+  testRadixSort();
+  testViews();
+  testSharedRingBuffer();
+  testSerialization();
+  testTables();
+  testWordGapStatistics();
+  testPageFurnitureIndex();
+  testReadingOrder();
+  testConcurrentDocuments();
+  testWorkerPoolRestart();
+
+  if (Failures > 0) {
+    std::cerr << Failures << " checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "All checks passed" << std::endl;
+  return 0;
+}